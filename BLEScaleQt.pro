@@ -1,21 +1,105 @@
-QT       += core gui bluetooth
+QT       += core gui bluetooth network
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
-CONFIG += c++17
+CONFIG += c++20
 
 # You can make your code fail to compile if it uses deprecated APIs.
 # In order to do so, uncomment the following line.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
+    allocationcounter.cpp \
+    calibration.cpp \
+    characteristicstats.cpp \
+    decoderpluginhost.cpp \
+    deviceregistry.cpp \
+    gattawait.cpp \
+    gattuuid.cpp \
+    httpserver.cpp \
+    ieee11073.cpp \
+    ingestmetrics.cpp \
+    latestvaluetable.cpp \
+    layoutprogram.cpp \
+    linkquality.cpp \
     main.cpp \
-    mainwindow.cpp
+    mainwindow.cpp \
+    memoryaccounting.cpp \
+    metrics.cpp \
+    mqttpublisher.cpp \
+    notificationwatchdog.cpp \
+    phasetimeline.cpp \
+    probes.cpp \
+    samplebus.cpp \
+    sampledecoder.cpp \
+    samplejson.cpp \
+    selftest.cpp \
+    soakharness.cpp \
+    stationconfig.cpp \
+    streamserver.cpp \
+    syntheticstream.cpp \
+    timingwheel.cpp \
+    tracer.cpp
 
 HEADERS += \
-    mainwindow.h
+    allocationcounter.h \
+    blescale_shm.h \
+    calibration.h \
+    characteristicstats.h \
+    decoderplugin.h \
+    decoderpluginhost.h \
+    deviceregistry.h \
+    gattawait.h \
+    gattuuid.h \
+    httpserver.h \
+    ieee11073.h \
+    ingestmetrics.h \
+    latestvaluetable.h \
+    layoutprogram.h \
+    linkquality.h \
+    mainwindow.h \
+    memoryaccounting.h \
+    metrics.h \
+    mqttpublisher.h \
+    notificationwatchdog.h \
+    phasetimeline.h \
+    probes.h \
+    sample.h \
+    samplebus.h \
+    sampledecoder.h \
+    samplejson.h \
+    selftest.h \
+    soakharness.h \
+    stationconfig.h \
+    streamserver.h \
+    syntheticstream.h \
+    timingwheel.h \
+    tracer.h
 
 FORMS += \
     mainwindow.ui
 
+# C reader library for other processes on the gateway; not linked into the app
+DISTFILES += \
+    blescale_layout_example.json \
+    blescale_probes.bt \
+    blescale_shm_reader.c
+
+# JavaScript characteristic decoders (scriptdecoder.h), only where QtQml is installed
+qtHaveModule(qml) {
+    QT += qml
+    DEFINES += BLESCALE_SCRIPTING
+    SOURCES += scriptdecoder.cpp
+    HEADERS += scriptdecoder.h
+}
+
+# USDT probes for perf/bpftrace (probes.h); needs <sys/sdt.h> from systemtap-sdt-dev
+usdt: DEFINES += BLESCALE_USDT
+
+# Counting global operator new (allocationcounter.h), for blescale_decode_allocations_total and
+# the --self-test allocation check
+alloccount: DEFINES += BLESCALE_COUNT_ALLOCATIONS
+
+unix:!android:!macx: LIBS += -lrt
+
 ANDROID_PACKAGE_SOURCE_DIR = $$PWD/android
@@ -0,0 +1,46 @@
+#include "allocationcounter.h"
+
+#ifdef BLESCALE_COUNT_ALLOCATIONS
+#include <cstdlib>
+#include <new>
+
+namespace {
+thread_local quint64 t_allocations = 0;
+
+void *allocate(std::size_t size)
+{
+    ++t_allocations;
+    return std::malloc(size ? size : 1);
+}
+}
+
+// Aligned (over-aligned type) allocations keep the library versions and are not counted
+void *operator new(std::size_t size)
+{
+    if (void *pointer = allocate(size))
+        return pointer;
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size)
+{
+    if (void *pointer = allocate(size))
+        return pointer;
+    throw std::bad_alloc();
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept { return allocate(size); }
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept { return allocate(size); }
+void operator delete(void *pointer) noexcept { std::free(pointer); }
+void operator delete[](void *pointer) noexcept { std::free(pointer); }
+void operator delete(void *pointer, std::size_t) noexcept { std::free(pointer); }
+void operator delete[](void *pointer, std::size_t) noexcept { std::free(pointer); }
+void operator delete(void *pointer, const std::nothrow_t &) noexcept { std::free(pointer); }
+void operator delete[](void *pointer, const std::nothrow_t &) noexcept { std::free(pointer); }
+
+bool AllocationCounter::isEnabled() { return true; }
+quint64 AllocationCounter::count() { return t_allocations; }
+#else
+bool AllocationCounter::isEnabled() { return false; }
+quint64 AllocationCounter::count() { return 0; }
+#endif
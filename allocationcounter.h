@@ -0,0 +1,17 @@
+#ifndef ALLOCATIONCOUNTER_H
+#define ALLOCATIONCOUNTER_H
+
+#include <QtGlobal>
+
+// Counts global heap allocations made by the calling thread, to check that a code path allocates
+// nothing in steady state. Only built with `qmake CONFIG+=alloccount`, which replaces the global
+// operator new/delete with counting versions over malloc/free; otherwise isEnabled() is false and
+// count() stays 0 at no cost.
+namespace AllocationCounter {
+
+bool isEnabled();
+quint64 count(); // operator new calls on this thread so far
+
+} // namespace AllocationCounter
+
+#endif // ALLOCATIONCOUNTER_H
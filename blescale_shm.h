@@ -0,0 +1,123 @@
+/*
+ * Shared-memory latest-value table published by BLEScaleQt.
+ *
+ * The segment is a POSIX shared-memory object (default name BLESCALE_SHM_DEFAULT_NAME)
+ * holding a fixed header followed by BLESCALE_SHM_SLOTS cache-line sized slots, one per scale.
+ * A slot holds the scale's latest weight: Weight Measurement or any characteristic in kg or lb.
+ * Each slot is guarded by a seqlock: the single writer makes `seq` odd while it updates the
+ * slot and even again when done, so readers never block the writer and never take a lock or
+ * make a syscall; they simply retry when they observe an odd or changed sequence.
+ *
+ * This header is plain C so it can be shared by the application (writer) and by the small
+ * reader library in blescale_shm_reader.c.
+ */
+#ifndef BLESCALE_SHM_H
+#define BLESCALE_SHM_H
+
+#include <errno.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BLESCALE_SHM_DEFAULT_NAME "/blescale-latest"
+#define BLESCALE_SHM_MAGIC 0x31534C42u /* "BLS1" */
+#define BLESCALE_SHM_VERSION 1u
+#define BLESCALE_SHM_SLOTS 64
+#define BLESCALE_SHM_READ_RETRIES 1024 /* Attempts before a read gives up with -EAGAIN */
+
+/* Mirrors Sample in sample.h; value = mantissa * 10^exponent in `unit` (Bluetooth SIG unit UUID). */
+typedef struct blescale_shm_value {
+    uint64_t device;            /* Bluetooth address as a 48-bit integer */
+    uint8_t characteristic[16]; /* UUID, RFC 4122 byte order */
+    int64_t timestamp_us;       /* Arrival time, microseconds since epoch */
+    int32_t mantissa;
+    int8_t exponent;
+    uint8_t flags;              /* Sample::Flag bits */
+    uint16_t unit;
+    uint32_t sequence;
+    uint32_t reserved;
+} blescale_shm_value;
+
+typedef struct blescale_shm_slot {
+    uint32_t seq;               /* Seqlock sequence, odd while being written */
+    uint32_t in_use;            /* Non-zero once the slot has been assigned to a device */
+    uint64_t update_count;
+    blescale_shm_value value;
+} __attribute__((aligned(64))) blescale_shm_slot;
+
+typedef struct blescale_shm_header {
+    uint32_t magic;             /* Written last during initialisation */
+    uint32_t version;
+    uint32_t slot_count;
+    uint32_t slot_size;
+    uint32_t used_slots;        /* Slots [0, used_slots) may be in use */
+    uint32_t writer_active;     /* Cleared when the application shuts down */
+    uint64_t writer_pid;
+} __attribute__((aligned(64))) blescale_shm_header;
+
+typedef struct blescale_shm_table {
+    blescale_shm_header header;
+    blescale_shm_slot slots[BLESCALE_SHM_SLOTS];
+} blescale_shm_table;
+
+/* --- Seqlock helpers (GCC/Clang atomics, usable from C and C++) --- */
+
+static inline void blescale_shm_write_begin(blescale_shm_slot *slot)
+{
+    uint32_t s = __atomic_load_n(&slot->seq, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->seq, s + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline void blescale_shm_write_end(blescale_shm_slot *slot)
+{
+    uint32_t s = __atomic_load_n(&slot->seq, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->seq, s + 1, __ATOMIC_RELEASE);
+}
+
+/* Copies a consistent snapshot of the slot. Returns 0 on success, -1 if the slot is unused, and
+ * -EAGAIN if no consistent snapshot was seen in BLESCALE_SHM_READ_RETRIES attempts: the writer
+ * is updating the slot unusually often, or died in the middle of an update and left `seq` odd.
+ * Callers may retry later; the slot stays unreadable until a writer completes an update. */
+static inline int blescale_shm_read_slot_value(const blescale_shm_slot *slot, blescale_shm_value *out)
+{
+    for (int attempt = 0; attempt < BLESCALE_SHM_READ_RETRIES; ++attempt) {
+        uint32_t s1 = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        if (s1 & 1u)
+            continue; /* Writer in progress */
+        if (!__atomic_load_n(&slot->in_use, __ATOMIC_RELAXED))
+            return -1;
+        __builtin_memcpy(out, (const void *)&slot->value, sizeof(*out));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) == s1)
+            return 0;
+    }
+    return -EAGAIN;
+}
+
+/* --- Reader library (blescale_shm_reader.c) --- */
+
+typedef struct blescale_shm_reader blescale_shm_reader;
+
+/* Maps the segment read-only. `name` may be NULL for the default. Returns NULL on failure. */
+blescale_shm_reader *blescale_shm_open(const char *name);
+void blescale_shm_close(blescale_shm_reader *reader);
+
+/* Non-zero while the publishing application is running. */
+int blescale_shm_writer_active(const blescale_shm_reader *reader);
+int blescale_shm_slot_count(const blescale_shm_reader *reader);
+
+/* Lock-free, syscall-free reads. Return 0 on success, -1 if the slot/device is unknown, -EAGAIN
+ * if a slot that might hold it could not be read consistently (see blescale_shm_read_slot_value). */
+int blescale_shm_read(const blescale_shm_reader *reader, int slot, blescale_shm_value *out);
+int blescale_shm_find(const blescale_shm_reader *reader, uint64_t device, blescale_shm_value *out);
+
+double blescale_shm_value_as_double(const blescale_shm_value *value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BLESCALE_SHM_H */
@@ -0,0 +1,97 @@
+/*
+ * Reader side of the BLEScaleQt shared-memory latest-value table.
+ * Build into any process that wants current weights, e.g.
+ *     cc -O2 -c blescale_shm_reader.c && cc app.o blescale_shm_reader.o -lrt
+ */
+#include "blescale_shm.h"
+
+#include <fcntl.h>
+#include <math.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+struct blescale_shm_reader {
+    const blescale_shm_table *table;
+    size_t size;
+};
+
+blescale_shm_reader *blescale_shm_open(const char *name)
+{
+    int fd = shm_open(name ? name : BLESCALE_SHM_DEFAULT_NAME, O_RDONLY, 0);
+    if (fd < 0)
+        return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(blescale_shm_table)) {
+        close(fd);
+        return NULL;
+    }
+
+    void *map = mmap(NULL, sizeof(blescale_shm_table), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return NULL;
+
+    const blescale_shm_table *table = (const blescale_shm_table *)map;
+    if (__atomic_load_n(&table->header.magic, __ATOMIC_ACQUIRE) != BLESCALE_SHM_MAGIC
+        || table->header.version != BLESCALE_SHM_VERSION
+        || table->header.slot_size != sizeof(blescale_shm_slot)) {
+        munmap(map, sizeof(blescale_shm_table));
+        return NULL;
+    }
+
+    blescale_shm_reader *reader = (blescale_shm_reader *)malloc(sizeof(*reader));
+    if (!reader) {
+        munmap(map, sizeof(blescale_shm_table));
+        return NULL;
+    }
+    reader->table = table;
+    reader->size = sizeof(blescale_shm_table);
+    return reader;
+}
+
+void blescale_shm_close(blescale_shm_reader *reader)
+{
+    if (!reader)
+        return;
+    munmap((void *)reader->table, reader->size);
+    free(reader);
+}
+
+int blescale_shm_writer_active(const blescale_shm_reader *reader)
+{
+    return (int)__atomic_load_n(&reader->table->header.writer_active, __ATOMIC_ACQUIRE);
+}
+
+int blescale_shm_slot_count(const blescale_shm_reader *reader)
+{
+    return (int)__atomic_load_n(&reader->table->header.used_slots, __ATOMIC_ACQUIRE);
+}
+
+int blescale_shm_read(const blescale_shm_reader *reader, int slot, blescale_shm_value *out)
+{
+    if (slot < 0 || slot >= blescale_shm_slot_count(reader))
+        return -1;
+    return blescale_shm_read_slot_value(&reader->table->slots[slot], out);
+}
+
+int blescale_shm_find(const blescale_shm_reader *reader, uint64_t device, blescale_shm_value *out)
+{
+    const int count = blescale_shm_slot_count(reader);
+    int result = -1;
+    for (int i = 0; i < count; ++i) {
+        const int read = blescale_shm_read_slot_value(&reader->table->slots[i], out);
+        if (read == 0 && out->device == device)
+            return 0;
+        if (read == -EAGAIN)
+            result = -EAGAIN; /* Might have been this device's slot */
+    }
+    return result;
+}
+
+double blescale_shm_value_as_double(const blescale_shm_value *value)
+{
+    return value->mantissa * pow(10.0, value->exponent);
+}
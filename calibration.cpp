@@ -0,0 +1,284 @@
+#include "calibration.h"
+#include "samplejson.h"
+#include <QtEndian>
+#include <algorithm>
+#include <limits>
+
+namespace {
+constexpr qint64 kMgPerPoundTimes100 = 45359237; // 1 lb = 453592.37 mg
+constexpr int kGainShift = 30;
+constexpr qint64 kMaxGainQ30 = (qint64(1) << 32) - 1; // |gain| < 4
+constexpr qint64 kMaxMg = qint64(1) << 46;            // ~70 t; keeps every product in range
+constexpr quint8 kBlobVersion = 1;
+
+constexpr qint64 kPow10[] = {
+    1LL, 10LL, 100LL, 1000LL, 10000LL, 100000LL, 1000000LL, 10000000LL, 100000000LL, 1000000000LL,
+    10000000000LL, 100000000000LL, 1000000000000LL, 10000000000000LL, 100000000000000LL,
+    1000000000000000LL, 10000000000000000LL, 100000000000000000LL, 1000000000000000000LL
+};
+
+// value * 10^exponent, rounded half away from zero; false if the result would not fit
+bool scalePow10(qint64 value, int exponent, qint64 &out)
+{
+    if (exponent >= 0) {
+        if (exponent > 18 || (value != 0 && qAbs(value) > std::numeric_limits<qint64>::max() / kPow10[exponent]))
+            return false;
+        out = value * kPow10[exponent];
+        return true;
+    }
+    out = -exponent > 18 ? 0 : Calibration::divRound(value, kPow10[-exponent]);
+    return true;
+}
+
+// dy / dx as Q30 (dx > 0), saturated at the gain limit
+qint64 gainQ30(qint64 dy, qint64 dx)
+{
+    if (qAbs(dy) >= 4 * dx)
+        return dy < 0 ? -kMaxGainQ30 : kMaxGainQ30;
+    int shift = 0; // Drop low bits of very long segments so dy * 2^30 fits
+    while (qAbs(dy >> shift) >= (qint64(1) << 32))
+        ++shift;
+    return qBound(-kMaxGainQ30, Calibration::divRound((dy >> shift) * (qint64(1) << kGainShift), qMax<qint64>(1, dx >> shift)), kMaxGainQ30);
+}
+
+// a * gain / 2^30 without overflowing for |a| < 2^48 and |gain| < 2^32
+qint64 mulQ30(qint64 a, qint64 gainQ30)
+{
+    const bool negative = (a < 0) != (gainQ30 < 0);
+    const quint64 ua = quint64(qAbs(a));
+    const quint64 ug = quint64(qAbs(gainQ30));
+    const quint64 lowMask = (quint64(1) << kGainShift) - 1;
+    const quint64 result = (ua >> kGainShift) * ug
+                           + (((ua & lowMask) * ug + (quint64(1) << (kGainShift - 1))) >> kGainShift);
+    return negative ? -qint64(result) : qint64(result);
+}
+
+void markOutOfRange(Sample &sample, bool negative)
+{
+    sample.flags = (sample.flags & ~Sample::HasValue) | Sample::Special;
+    sample.mantissa = negative ? Sample::NegativeInfinity : Sample::PositiveInfinity;
+    sample.exponent = 0;
+}
+}
+
+// --- Curve ---
+Calibration::Curve::Curve(QList<Point> points)
+{
+    std::stable_sort(points.begin(), points.end(), [](const Point &a, const Point &b) { return a.rawMg < b.rawMg; });
+    for (const Point &point : std::as_const(points)) {
+        if (qAbs(point.rawMg) > kMaxMg || qAbs(point.trueMg) > kMaxMg)
+            continue;
+        if (!m_points.isEmpty() && m_points.last().rawMg == point.rawMg)
+            continue; // A vertical segment has no gain
+        m_points.append(point);
+    }
+    for (int i = 0; i + 1 < m_points.size(); ++i) {
+        const qint64 dx = m_points.at(i + 1).rawMg - m_points.at(i).rawMg;
+        const qint64 dy = m_points.at(i + 1).trueMg - m_points.at(i).trueMg;
+        m_gainQ30.append(gainQ30(dy, dx));
+    }
+}
+
+qint64 Calibration::Curve::apply(qint64 rawMg) const
+{
+    if (m_points.isEmpty())
+        return rawMg;
+    rawMg = qBound(-kMaxMg, rawMg, kMaxMg);
+    if (m_points.size() == 1)
+        return qBound(-kMaxMg, rawMg + (m_points.first().trueMg - m_points.first().rawMg), kMaxMg);
+
+    // Segment containing rawMg; the end segments extend past the outer points
+    int segment = 0;
+    while (segment + 2 < m_points.size() && rawMg >= m_points.at(segment + 1).rawMg)
+        ++segment;
+    const Point &from = m_points.at(segment);
+    // |rawMg - from.rawMg| < 2^47 and |gain| < 4, so the sum stays far inside 64 bits before the clamp
+    return qBound(-kMaxMg, from.trueMg + mulQ30(rawMg - from.rawMg, m_gainQ30.at(segment)), kMaxMg);
+}
+
+QByteArray Calibration::Curve::toBlob() const
+{
+    if (m_points.isEmpty())
+        return QByteArray();
+    const int count = qMin<int>(m_points.size(), 255);
+    QByteArray blob(2 + count * 16, Qt::Uninitialized);
+    blob[0] = char(kBlobVersion);
+    blob[1] = char(count);
+    char *p = blob.data() + 2;
+    for (int i = 0; i < count; ++i, p += 16) {
+        qToLittleEndian<qint64>(m_points.at(i).rawMg, p);
+        qToLittleEndian<qint64>(m_points.at(i).trueMg, p + 8);
+    }
+    return blob;
+}
+
+Calibration::Curve Calibration::Curve::fromBlob(const QByteArray &blob)
+{
+    if (blob.size() < 2 || quint8(blob.at(0)) != kBlobVersion)
+        return Curve();
+    const int count = quint8(blob.at(1));
+    if (blob.size() < 2 + count * 16)
+        return Curve();
+    QList<Point> points;
+    points.reserve(count);
+    const char *p = blob.constData() + 2;
+    for (int i = 0; i < count; ++i, p += 16)
+        points.append({qFromLittleEndian<qint64>(p), qFromLittleEndian<qint64>(p + 8)});
+    return Curve(points);
+}
+
+// --- Calibration ---
+Calibration::Calibration(Unit unit)
+    : m_unit(unit)
+{
+}
+
+void Calibration::setCurve(quint64 device, const Curve &curve)
+{
+    if (curve.isEmpty())
+        m_curves.remove(device);
+    else
+        m_curves.insert(device, curve);
+}
+
+const Calibration::Curve *Calibration::curve(quint64 device) const
+{
+    auto it = m_curves.constFind(device);
+    return it == m_curves.constEnd() ? nullptr : &it.value();
+}
+
+void Calibration::apply(Sample *samples, int count) const
+{
+    if (m_unit == NativeUnit && m_curves.isEmpty())
+        return; // Nothing to do for anyone
+
+    quint64 device = 0;
+    const Curve *deviceCurve = nullptr;
+    bool looked = false;
+    for (int i = 0; i < count; ++i) {
+        Sample &sample = samples[i];
+        if (!looked || sample.device != device) {
+            device = sample.device;
+            deviceCurve = curve(device);
+            looked = true;
+        }
+        if (!deviceCurve && m_unit == NativeUnit)
+            continue;
+        if (!sample.hasValue() || (sample.unit != SigUnit::Kilogram && sample.unit != SigUnit::Pound))
+            continue; // Not a mass
+        qint64 mg = 0;
+        if (!toMilligrams(sample, mg)) {
+            markOutOfRange(sample, sample.mantissa < 0);
+            continue;
+        }
+        if (deviceCurve)
+            mg = deviceCurve->apply(mg);
+        if (!fromMilligrams(mg, m_unit, sample))
+            markOutOfRange(sample, mg < 0);
+    }
+}
+
+bool Calibration::toMilligrams(const Sample &sample, qint64 &mg)
+{
+    if (!sample.hasValue())
+        return false;
+    if (sample.unit == SigUnit::Kilogram)
+        return scalePow10(sample.mantissa, sample.exponent + 6, mg) && qAbs(mg) <= kMaxMg;
+    if (sample.unit == SigUnit::Pound) // |mantissa| * 45359237 < 2^57
+        return scalePow10(qint64(sample.mantissa) * kMgPerPoundTimes100, sample.exponent - 2, mg) && qAbs(mg) <= kMaxMg;
+    return false;
+}
+
+// Fixed output resolutions: kg 0.1 g (exponent -4), lb 0.001 lb. Native keeps the sample's own unit.
+bool Calibration::fromMilligrams(qint64 mg, Unit unit, Sample &sample)
+{
+    if (qAbs(mg) > kMaxMg)
+        return false; // Beyond every unit's mantissa, and would overflow the pound conversion
+    if (unit == NativeUnit)
+        unit = sample.unit == SigUnit::Pound ? Pound : Kilogram;
+
+    qint64 mantissa = 0;
+    qint8 exponent = 0;
+    switch (unit) {
+    case Kilogram:
+        mantissa = divRound(mg, 100);
+        exponent = -4;
+        break;
+    case Pound:
+        mantissa = divRound(mg * 100000, kMgPerPoundTimes100); // |mg| <= 2^46 keeps this in range
+        exponent = -3;
+        break;
+    case NativeUnit:
+        return false;
+    }
+    if (mantissa < std::numeric_limits<qint32>::min() || mantissa > std::numeric_limits<qint32>::max())
+        return false;
+
+    sample.mantissa = qint32(mantissa);
+    sample.exponent = exponent;
+    if (unit == Pound) {
+        sample.unit = SigUnit::Pound;
+        sample.flags |= Sample::Imperial;
+    } else {
+        sample.unit = SigUnit::Kilogram;
+        sample.flags &= ~Sample::Imperial;
+    }
+    return true;
+}
+
+qint64 Calibration::divRound(qint64 numerator, qint64 denominator)
+{
+    if (denominator < 0) {
+        numerator = -numerator;
+        denominator = -denominator;
+    }
+    const qint64 half = denominator / 2;
+    return numerator >= 0 ? (numerator + half) / denominator : -((-numerator + half) / denominator);
+}
+
+bool Calibration::parseUnit(const QString &text, Unit &unit)
+{
+    const QString name = text.trimmed().toLower();
+    if (name.isEmpty() || name == QLatin1String("native"))
+        unit = NativeUnit;
+    else if (name == QLatin1String("kg"))
+        unit = Kilogram;
+    else if (name == QLatin1String("lb"))
+        unit = Pound;
+    else
+        return false;
+    return true;
+}
+
+bool Calibration::parseMilligrams(const QString &kg, qint64 &mg)
+{
+    QString text = kg.trimmed();
+    const bool negative = text.startsWith(QLatin1Char('-'));
+    if (negative || text.startsWith(QLatin1Char('+')))
+        text.remove(0, 1);
+    const qsizetype dot = text.indexOf(QLatin1Char('.'));
+    const QString whole = dot < 0 ? text : text.left(dot);
+    const QString fraction = dot < 0 ? QString() : text.mid(dot + 1);
+    if ((whole.isEmpty() && fraction.isEmpty()) || whole.size() > 9 || fraction.size() > 6)
+        return false;
+
+    qint64 value = 0;
+    for (QChar c : whole) {
+        if (!c.isDigit())
+            return false;
+        value = value * 10 + c.digitValue();
+    }
+    for (int i = 0; i < 6; ++i) {
+        const QChar c = i < fraction.size() ? fraction.at(i) : QLatin1Char('0');
+        if (!c.isDigit())
+            return false;
+        value = value * 10 + c.digitValue();
+    }
+    mg = negative ? -value : value;
+    return true;
+}
+
+QByteArray Calibration::formatKg(qint64 mg)
+{
+    return SampleJson::formatDecimal(mg, -6);
+}
@@ -0,0 +1,77 @@
+#ifndef CALIBRATION_H
+#define CALIBRATION_H
+
+#include "sample.h"
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QString>
+
+// Per-scale weight correction and unit conversion, applied to decoded samples before any sink
+// sees them.
+//
+// All arithmetic is integer: weights are carried as milligrams in 64 bits, each curve segment
+// keeps its gain as a Q30 fixed-point factor, and every division rounds half away from zero.
+// A curve is a list of (raw, true) reference points, piecewise linear between them and
+// extrapolated with the end segments; a single point is a pure offset. Output is re-expressed
+// in the station unit with a fixed resolution (kg 0.1 g, lb 0.001 lb). There is no gram output:
+// SIG units have no gram, and every sink carries the SIG unit. A mass that cannot be expressed
+// in the station unit is reported as IEEE-11073 +INF or -INF instead of its unconverted value.
+class Calibration
+{
+public:
+    enum Unit { NativeUnit, Kilogram, Pound };
+
+    struct Point {
+        qint64 rawMg = 0;
+        qint64 trueMg = 0;
+    };
+
+    class Curve
+    {
+    public:
+        Curve() = default;
+        explicit Curve(QList<Point> points); // Sorted by raw weight; duplicates are dropped
+
+        bool isEmpty() const { return m_points.isEmpty(); }
+        const QList<Point> &points() const { return m_points; }
+        qint64 apply(qint64 rawMg) const; // Saturates at the supported range (about 70 t)
+
+        // Device registry blob: version u8, count u8, then (raw, true) int64 pairs, little endian
+        QByteArray toBlob() const;
+        static Curve fromBlob(const QByteArray &blob);
+
+    private:
+        QList<Point> m_points;
+        QList<qint64> m_gainQ30; // Segment i runs from point i to point i + 1
+    };
+
+    explicit Calibration(Unit unit = NativeUnit);
+
+    Unit unit() const { return m_unit; }
+    void setUnit(Unit unit) { m_unit = unit; }
+
+    void setCurve(quint64 device, const Curve &curve); // Empty curve = uncalibrated
+    const Curve *curve(quint64 device) const;
+    QList<quint64> devices() const { return m_curves.keys(); }
+
+    // Corrects and converts mass samples in place (out of range ones become +/-INF); other samples
+    // pass through untouched.
+    // Consecutive samples of one device share a single curve lookup.
+    void apply(Sample *samples, int count) const;
+
+    // --- Fixed-point helpers ---
+    static bool toMilligrams(const Sample &sample, qint64 &mg);
+    static bool fromMilligrams(qint64 mg, Unit unit, Sample &sample); // False if out of range
+    static qint64 divRound(qint64 numerator, qint64 denominator); // Half away from zero
+    static bool parseUnit(const QString &text, Unit &unit);
+    static bool parseMilligrams(const QString &kg, qint64 &mg); // "12.3456" kg, exactly
+    static QByteArray formatKg(qint64 mg);
+
+private:
+    Unit m_unit;
+    QHash<quint64, Curve> m_curves;
+};
+
+#endif // CALIBRATION_H
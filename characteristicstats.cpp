@@ -0,0 +1,49 @@
+#include "characteristicstats.h"
+#include <cmath>
+
+namespace {
+constexpr double MeanWeight = 1.0 / 8.0;
+constexpr double JitterWeight = 1.0 / 16.0;
+}
+
+void CharacteristicStats::recordArrival(qint64 arrivalUs)
+{
+    if (m_count > 0) {
+        const qint64 intervalUs = arrivalUs - m_lastArrivalUs;
+        m_longestGapUs = qMax(m_longestGapUs, intervalUs);
+
+        if (m_count == 1) {
+            m_meanIntervalUs = double(intervalUs);
+        } else {
+            m_meanIntervalUs += (intervalUs - m_meanIntervalUs) * MeanWeight;
+            m_jitterUs += (std::fabs(intervalUs - m_lastIntervalUs) - m_jitterUs) * JitterWeight;
+        }
+        m_lastIntervalUs = double(intervalUs);
+    }
+    m_lastArrivalUs = arrivalUs;
+    ++m_count;
+}
+
+void CharacteristicStats::recordSequence(quint32 sequence)
+{
+    if (m_haveSequence) {
+        const quint32 expected = m_lastSequence + 1;
+        if (sequence != expected) {
+            ++m_sequenceGaps;
+            // Unsigned distance handles counter wrap; anything huge is a device reset, not a loss
+            const quint32 missed = sequence - expected;
+            if (missed < 0x8000)
+                m_missedSequences += missed;
+        }
+    }
+    m_haveSequence = true;
+    m_lastSequence = sequence;
+}
+
+double CharacteristicStats::rateHz(qint64 nowUs) const
+{
+    if (m_count < 2 || m_meanIntervalUs <= 0.0)
+        return 0.0;
+    const double sinceLastUs = double(nowUs - m_lastArrivalUs);
+    return 1e6 / qMax(m_meanIntervalUs, sinceLastUs);
+}
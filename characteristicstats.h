@@ -0,0 +1,49 @@
+#ifndef CHARACTERISTICSTATS_H
+#define CHARACTERISTICSTATS_H
+
+#include <QtGlobal>
+#include <chrono>
+
+// Arrival statistics for one characteristic's notification stream, updated in O(1) per arrival:
+//  - rate from an exponentially weighted mean of the inter-arrival interval
+//  - jitter as the smoothed absolute change between consecutive intervals (RFC 3550 style)
+//  - longest gap between two arrivals
+//  - sequence gaps, for payloads that carry a counter
+class CharacteristicStats
+{
+public:
+    void recordArrival(qint64 arrivalUs);
+    void recordSequence(quint32 sequence);
+
+    quint64 count() const { return m_count; }
+    qint64 lastArrivalUs() const { return m_lastArrivalUs; }
+    double meanIntervalMs() const { return m_meanIntervalUs / 1000.0; }
+    double jitterMs() const { return m_jitterUs / 1000.0; }
+    double longestGapMs() const { return m_longestGapUs / 1000.0; }
+    quint64 sequenceGaps() const { return m_sequenceGaps; }
+    quint64 missedSequences() const { return m_missedSequences; }
+
+    // Rate as of `nowUs`; decays while no notifications arrive so a stalled stream reads as slow.
+    double rateHz(qint64 nowUs) const;
+
+    static qint64 monotonicUs()
+    {
+        using namespace std::chrono;
+        return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+    }
+
+private:
+    quint64 m_count = 0;
+    qint64 m_lastArrivalUs = 0;
+    double m_lastIntervalUs = 0.0;
+    double m_meanIntervalUs = 0.0;
+    double m_jitterUs = 0.0;
+    qint64 m_longestGapUs = 0;
+
+    bool m_haveSequence = false;
+    quint32 m_lastSequence = 0;
+    quint64 m_sequenceGaps = 0;
+    quint64 m_missedSequences = 0;
+};
+
+#endif // CHARACTERISTICSTATS_H
@@ -0,0 +1,47 @@
+#ifndef DECODERPLUGIN_H
+#define DECODERPLUGIN_H
+
+#include "sample.h"
+
+#include <QtPlugin>
+#include <QBluetoothUuid>
+#include <QByteArray>
+#include <QList>
+#include <QString>
+
+// Interface for vendor decoders shipped as Qt plugins, so one binary serves every site.
+//
+// A plugin is a shared library built against this header and sample.h, exporting a QObject that
+// implements DecoderPlugin (Q_PLUGIN_METADATA(IID DecoderPlugin_iid) + Q_INTERFACES). The IID
+// carries the interface version; any change to this class or to Sample's layout bumps it, and
+// plugins built for another version are refused at load time.
+//
+// decode() receives samples with device, characteristic and timestamp already set and fills in
+// value, unit, flags and sequence. Notifications are decoded once per event loop pass, and each
+// run of consecutive notifications of a claimed characteristic is passed to decodeBatch(); the
+// default implementation calls decode() for each. Both run on the UI thread, so they must not block.
+class DecoderPlugin
+{
+public:
+    virtual ~DecoderPlugin() = default;
+
+    virtual QString name() const = 0;
+    virtual QList<QBluetoothUuid> characteristics() const = 0; // Characteristics this plugin decodes
+
+    virtual bool decode(const QBluetoothUuid &characteristic, const QByteArray &payload, Sample &out) = 0;
+
+    // Optional batch entry point; returns how many payloads it handled from the front of the run,
+    // with `ok[i]` telling which ones produced a sample. The rest go through decode().
+    virtual int decodeBatch(const QBluetoothUuid &characteristic, const QByteArray *payloads, int count,
+                            Sample *out, bool *ok)
+    {
+        for (int i = 0; i < count; ++i)
+            ok[i] = decode(characteristic, payloads[i], out[i]);
+        return count;
+    }
+};
+
+#define DecoderPlugin_iid "io.github.blescale.DecoderPlugin/1.0"
+Q_DECLARE_INTERFACE(DecoderPlugin, DecoderPlugin_iid)
+
+#endif // DECODERPLUGIN_H
@@ -0,0 +1,55 @@
+#include "decoderpluginhost.h"
+#include "decoderplugin.h"
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QLibrary>
+#include <QPluginLoader>
+
+int DecoderPluginHost::loadDirectory(const QString &path)
+{
+    int loaded = 0;
+    const QFileInfoList files = QDir(path).entryInfoList(QDir::Files, QDir::Name);
+    for (const QFileInfo &info : files) {
+        if (!QLibrary::isLibrary(info.fileName()))
+            continue;
+
+        QElapsedTimer timer;
+        timer.start();
+        QPluginLoader loader(info.filePath());
+        QObject *root = loader.instance(); // Stays loaded; the loader object itself can go
+        DecoderPlugin *decoder = qobject_cast<DecoderPlugin *>(root);
+        const double loadMs = timer.nsecsElapsed() / 1e6;
+
+        if (!root) {
+            qWarning() << "Cannot load decoder plugin" << info.filePath() << ":" << loader.errorString();
+            continue;
+        }
+        if (!decoder) {
+            qWarning() << "Skipping plugin" << info.filePath() << ": not a" << DecoderPlugin_iid << "decoder";
+            loader.unload();
+            continue;
+        }
+
+        m_plugins.append({info.fileName(), decoder, loadMs});
+        ++loaded;
+        qDebug().noquote() << QString("Loaded decoder plugin %1 (%2) in %3 ms for %4 characteristic(s)")
+                                  .arg(decoder->name(), info.fileName())
+                                  .arg(loadMs, 0, 'f', 2)
+                                  .arg(decoder->characteristics().size());
+    }
+    return loaded;
+}
+
+void DecoderPluginHost::appendMetrics(QByteArray &out) const
+{
+    if (m_plugins.isEmpty())
+        return;
+    out += "# HELP blescale_decoder_plugin_load_seconds Time taken to load each decoder plugin.\n"
+           "# TYPE blescale_decoder_plugin_load_seconds gauge\n";
+    for (const Plugin &plugin : m_plugins) {
+        out += "blescale_decoder_plugin_load_seconds{plugin=\"" + plugin.fileName.toUtf8() + "\"} "
+               + QByteArray::number(plugin.loadMs / 1000.0, 'g', 12) + '\n';
+    }
+}
@@ -0,0 +1,30 @@
+#ifndef DECODERPLUGINHOST_H
+#define DECODERPLUGINHOST_H
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+
+class DecoderPlugin;
+
+// Loads every DecoderPlugin in a directory at startup and keeps it loaded for the process
+// lifetime. Load time is measured per plugin, logged and exported as a metric.
+class DecoderPluginHost
+{
+public:
+    struct Plugin {
+        QString fileName;
+        DecoderPlugin *decoder = nullptr; // Owned by the plugin's root object
+        double loadMs = 0.0;
+    };
+
+    int loadDirectory(const QString &path); // Returns the number of plugins loaded
+    const QList<Plugin> &plugins() const { return m_plugins; }
+
+    void appendMetrics(QByteArray &out) const;
+
+private:
+    QList<Plugin> m_plugins;
+};
+
+#endif // DECODERPLUGINHOST_H
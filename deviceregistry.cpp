@@ -0,0 +1,278 @@
+#include "deviceregistry.h"
+#include "memoryaccounting.h"
+#include <QBluetoothAddress>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QtEndian>
+#include <algorithm>
+
+namespace {
+constexpr quint32 Magic = 0x52534C42; // "BLSR"
+constexpr quint16 FormatVersion = 1;
+constexpr int HeaderSize = 8;         // magic u32, version u16, reserved u16 (little endian)
+constexpr int RecordHeaderSize = 5;   // payload length u32, record type u8
+constexpr quint32 MaxRecordSize = 64 * 1024;
+constexpr QDataStream::Version StreamVersion = QDataStream::Qt_6_0;
+
+void writeUuids(QDataStream &out, const QList<QBluetoothUuid> &uuids)
+{
+    out << quint32(uuids.size());
+    for (const QBluetoothUuid &uuid : uuids)
+        out << static_cast<const QUuid &>(uuid);
+}
+
+void readUuids(QDataStream &in, QList<QBluetoothUuid> &uuids)
+{
+    quint32 count = 0;
+    in >> count;
+    uuids.clear();
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        QUuid uuid;
+        in >> uuid;
+        uuids.append(QBluetoothUuid(uuid));
+    }
+}
+
+QByteArray record(quint8 type, const QByteArray &payload)
+{
+    QByteArray out(RecordHeaderSize, Qt::Uninitialized);
+    qToLittleEndian<quint32>(quint32(payload.size()), out.data());
+    out[4] = char(type);
+    return out + payload;
+}
+}
+
+// --- Entry ---
+QString DeviceRegistry::Entry::displayName() const
+{
+    if (!alias.isEmpty())
+        return alias;
+    return name.isEmpty() ? QStringLiteral("(Unknown BLE Device)") : name;
+}
+
+QBluetoothDeviceInfo DeviceRegistry::Entry::toDeviceInfo() const
+{
+    QBluetoothDeviceInfo info(QBluetoothAddress(address), name, 0);
+    info.setCoreConfigurations(coreConfigurations
+                                   ? QBluetoothDeviceInfo::CoreConfigurations::fromInt(int(coreConfigurations))
+                                   : QBluetoothDeviceInfo::LowEnergyCoreConfiguration);
+    info.setRssi(rssi);
+    info.setServiceUuids(serviceUuids);
+    return info;
+}
+
+// --- Registry ---
+DeviceRegistry::DeviceRegistry()
+    : m_records(0)
+    , m_rewrite(false)
+{
+}
+
+QByteArray DeviceRegistry::header()
+{
+    QByteArray out(HeaderSize, '\0');
+    qToLittleEndian<quint32>(Magic, out.data());
+    qToLittleEndian<quint16>(FormatVersion, out.data() + 4);
+    return out;
+}
+
+// Fields are only ever appended, so a reader ignores whatever a newer writer added at the end
+void DeviceRegistry::writeEntry(QDataStream &out, const Entry &entry)
+{
+    out << entry.address << entry.alias << entry.model << entry.decoder;
+    writeUuids(out, entry.subscriptions);
+    out << entry.calibration << entry.lastSeenMs << entry.name << entry.rssi << entry.coreConfigurations;
+    writeUuids(out, entry.serviceUuids);
+}
+
+bool DeviceRegistry::readEntry(QDataStream &in, Entry &entry)
+{
+    in >> entry.address >> entry.alias >> entry.model >> entry.decoder;
+    readUuids(in, entry.subscriptions);
+    in >> entry.calibration >> entry.lastSeenMs >> entry.name >> entry.rssi >> entry.coreConfigurations;
+    readUuids(in, entry.serviceUuids);
+    return in.status() == QDataStream::Ok && entry.address != 0;
+}
+
+bool DeviceRegistry::load(const QString &path)
+{
+    m_path = path.isEmpty()
+        ? QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + QStringLiteral("/devices.bin")
+        : path;
+    m_entries.clear();
+    m_records = 0;
+    m_rewrite = false;
+
+    QFile file(m_path);
+    if (!file.open(QIODevice::ReadOnly))
+        return !file.exists(); // No registry yet is not an error
+    const QByteArray data = file.readAll(); // The whole registry in one read
+    file.close();
+
+    if (data.size() < HeaderSize || qFromLittleEndian<quint32>(data.constData()) != Magic
+        || qFromLittleEndian<quint16>(data.constData() + 4) != FormatVersion) {
+        qWarning() << "Device registry has an unknown format, starting empty:" << m_path;
+        m_rewrite = true;
+        return false;
+    }
+
+    qsizetype pos = HeaderSize;
+    while (pos + RecordHeaderSize <= data.size()) {
+        const quint32 length = qFromLittleEndian<quint32>(data.constData() + pos);
+        const quint8 type = quint8(data.at(pos + 4));
+        if (length > MaxRecordSize || pos + RecordHeaderSize + qsizetype(length) > data.size())
+            break; // Torn append
+        const QByteArray payload = QByteArray::fromRawData(data.constData() + pos + RecordHeaderSize, length);
+        pos += RecordHeaderSize + length;
+        ++m_records;
+
+        if (type == UpsertRecord) {
+            QDataStream in(payload);
+            in.setVersion(StreamVersion);
+            Entry entry;
+            if (readEntry(in, entry))
+                m_entries.insert(entry.address, entry);
+            else
+                m_rewrite = true;
+        } else if (type == RemoveRecord && length == sizeof(quint64)) {
+            m_entries.remove(qFromLittleEndian<quint64>(payload.constData()));
+        } else {
+            m_rewrite = true;
+        }
+    }
+    if (pos != data.size()) {
+        qWarning() << "Device registry has a damaged tail of" << (data.size() - pos) << "bytes; it will be rewritten";
+        m_rewrite = true;
+    }
+    qDebug() << "Loaded" << m_entries.size() << "known devices from" << m_path;
+    return true;
+}
+
+const DeviceRegistry::Entry *DeviceRegistry::find(quint64 address) const
+{
+    auto it = m_entries.constFind(address);
+    return it == m_entries.constEnd() ? nullptr : &it.value();
+}
+
+QList<DeviceRegistry::Entry> DeviceRegistry::entries() const
+{
+    QList<Entry> list = m_entries.values();
+    std::sort(list.begin(), list.end(), [](const Entry &a, const Entry &b) { return a.lastSeenMs > b.lastSeenMs; });
+    return list;
+}
+
+void DeviceRegistry::upsert(const Entry &entry)
+{
+    m_entries.insert(entry.address, entry);
+
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out.setVersion(StreamVersion);
+    writeEntry(out, entry);
+    append(UpsertRecord, payload);
+}
+
+void DeviceRegistry::remove(quint64 address)
+{
+    if (m_entries.remove(address) == 0)
+        return;
+    QByteArray payload(sizeof(quint64), Qt::Uninitialized);
+    qToLittleEndian<quint64>(address, payload.data());
+    append(RemoveRecord, payload);
+}
+
+void DeviceRegistry::noteSeen(const QBluetoothDeviceInfo &device)
+{
+    const quint64 address = device.address().toUInt64();
+    const Entry *known = find(address);
+    Entry entry = known ? *known : Entry();
+    entry.address = address;
+    if (!device.name().isEmpty())
+        entry.name = device.name();
+    if (device.rssi() != 0)
+        entry.rssi = device.rssi();
+    entry.coreConfigurations = quint32(device.coreConfigurations().toInt());
+    if (!device.serviceUuids().isEmpty())
+        entry.serviceUuids = device.serviceUuids();
+    entry.lastSeenMs = QDateTime::currentMSecsSinceEpoch();
+    upsert(entry);
+}
+
+void DeviceRegistry::setProfile(quint64 address, const QString &alias, const QString &decoder,
+                                const QList<QBluetoothUuid> &subscriptions)
+{
+    const Entry *known = find(address);
+    if (known && known->alias == alias && known->decoder == decoder && known->subscriptions == subscriptions)
+        return;
+    Entry entry = known ? *known : Entry();
+    entry.address = address;
+    entry.alias = alias;
+    entry.decoder = decoder;
+    entry.subscriptions = subscriptions;
+    upsert(entry);
+}
+
+void DeviceRegistry::append(RecordType type, const QByteArray &payload)
+{
+    if (m_path.isEmpty())
+        return; // Not loaded; in-memory only
+    ++m_records;
+    if (m_rewrite || m_records > 2 * m_entries.size() + 32 || !QFileInfo::exists(m_path)) {
+        compact();
+        return;
+    }
+
+    QFile file(m_path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qWarning() << "Cannot append to device registry" << m_path << ":" << file.errorString();
+        return;
+    }
+    const QByteArray out = record(type, payload);
+    if (file.write(out) != out.size())
+        m_rewrite = true; // Possibly torn; rewrite from memory next time
+}
+
+bool DeviceRegistry::compact()
+{
+    QDir().mkpath(QFileInfo(m_path).absolutePath());
+    QSaveFile file(m_path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Cannot write device registry" << m_path << ":" << file.errorString();
+        return false;
+    }
+
+    QByteArray out = header();
+    for (const Entry &entry : std::as_const(m_entries)) {
+        QByteArray payload;
+        QDataStream stream(&payload, QIODevice::WriteOnly);
+        stream.setVersion(StreamVersion);
+        writeEntry(stream, entry);
+        out += record(UpsertRecord, payload);
+    }
+    file.write(out);
+    if (!file.commit()) {
+        qWarning() << "Cannot write device registry" << m_path << ":" << file.errorString();
+        return false;
+    }
+    m_records = m_entries.size();
+    m_rewrite = false;
+    return true;
+}
+
+qint64 DeviceRegistry::memoryUsage() const
+{
+    qint64 bytes = MemoryAccounting::containerBytes(m_entries) + MemoryAccounting::bytes(m_path);
+    for (const Entry &entry : m_entries) {
+        bytes += MemoryAccounting::bytes(entry.alias) + MemoryAccounting::bytes(entry.model)
+                 + MemoryAccounting::bytes(entry.decoder) + MemoryAccounting::bytes(entry.name)
+                 + MemoryAccounting::bytes(entry.calibration)
+                 + MemoryAccounting::containerBytes(entry.subscriptions) + MemoryAccounting::containerBytes(entry.serviceUuids);
+    }
+    return bytes;
+}
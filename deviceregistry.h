@@ -0,0 +1,78 @@
+#ifndef DEVICEREGISTRY_H
+#define DEVICEREGISTRY_H
+
+#include <QBluetoothDeviceInfo>
+#include <QBluetoothUuid>
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QString>
+
+class QDataStream;
+
+// Known scales, remembered across runs.
+//
+// The registry is one small binary file: a header (magic, format version) followed by a log of
+// length-prefixed records, each either a complete entry or a removal. load() reads the file in a
+// single read and replays the log; every change appends one record, so updates cost one small
+// write. When the log has grown well past the number of live entries it is compacted by rewriting
+// the file atomically. A truncated or corrupt tail (power loss mid-append) is ignored and dropped
+// at the next compaction.
+class DeviceRegistry
+{
+public:
+    struct Entry {
+        quint64 address = 0;
+        QString alias;                        // Operator-chosen display name
+        QString model;                        // Device Information Model Number
+        QString decoder;                      // Decoder choice; empty = automatic
+        QList<QBluetoothUuid> subscriptions;  // Characteristics to subscribe; empty = station default
+        QByteArray calibration;               // Owned and serialised by the calibration stage
+        qint64 lastSeenMs = 0;                // Epoch ms
+
+        // Cached QBluetoothDeviceInfo fields, enough to connect without scanning first
+        QString name;
+        qint16 rssi = 0;
+        quint32 coreConfigurations = 0;
+        QList<QBluetoothUuid> serviceUuids;
+
+        QString displayName() const;
+        QBluetoothDeviceInfo toDeviceInfo() const;
+    };
+
+    DeviceRegistry();
+
+    bool load(const QString &path = QString()); // Default: AppDataLocation/devices.bin
+    QString path() const { return m_path; }
+
+    const Entry *find(quint64 address) const;
+    QList<Entry> entries() const; // Most recently seen first
+    int count() const { return m_entries.size(); }
+    qint64 memoryUsage() const; // Estimated heap bytes, see MemoryAccounting
+
+    void upsert(const Entry &entry);
+    void remove(quint64 address);
+
+    // Refreshes the cached device info and last-seen time, creating the entry if needed
+    void noteSeen(const QBluetoothDeviceInfo &device);
+    // Operator settings for a device (config file [devices]); appends a record only if they changed
+    void setProfile(quint64 address, const QString &alias, const QString &decoder,
+                    const QList<QBluetoothUuid> &subscriptions);
+
+private:
+    enum RecordType : quint8 { UpsertRecord = 1, RemoveRecord = 2 };
+
+    static void writeEntry(QDataStream &out, const Entry &entry);
+    static bool readEntry(QDataStream &in, Entry &entry);
+    static QByteArray header();
+
+    void append(RecordType type, const QByteArray &payload);
+    bool compact();
+
+    QString m_path;
+    QHash<quint64, Entry> m_entries;
+    int m_records; // Records in the log, live or superseded
+    bool m_rewrite; // File is damaged or foreign; rewrite it whole on the next change
+};
+
+#endif // DEVICEREGISTRY_H
@@ -0,0 +1,314 @@
+#include "gattawait.h"
+#include <QCoreApplication>
+
+namespace Gatt {
+
+const char *errorName(Error error)
+{
+    switch (error) {
+    case NoError: return "ok";
+    case Failed: return "failed";
+    case TimedOut: return "timed out";
+    case Cancelled: return "cancelled";
+    case Gone: return "gone";
+    }
+    return "unknown";
+}
+
+// --- Cancel ---
+Cancel::Cancel()
+    : d(std::make_shared<State>())
+{
+}
+
+void Cancel::cancel()
+{
+    if (d->cancelled)
+        return;
+    d->cancelled = true;
+    const QHash<int, std::function<void()>> callbacks = std::exchange(d->callbacks, {});
+    for (const std::function<void()> &callback : callbacks)
+        callback();
+}
+
+int Cancel::onCancel(std::function<void()> callback)
+{
+    if (d->cancelled)
+        return 0;
+    const int id = d->nextId++;
+    d->callbacks.insert(id, std::move(callback));
+    return id;
+}
+
+void Cancel::remove(int id)
+{
+    d->callbacks.remove(id);
+}
+
+namespace {
+
+// --- Pending operation ---
+// One GATT request: the signal connections, timeout and cancel registration that can finish it,
+// and the coroutine waiting for it. Only the awaiter owns it; the callbacks hold weak references,
+// so an operation nobody waits for anymore is simply dropped.
+template<typename T>
+struct Operation {
+    Context context;
+    std::optional<Result<T>> result;
+    std::coroutine_handle<> waiter;
+    QList<QMetaObject::Connection> connections;
+    TimingWheel::TimerId timeout = 0;
+    int cancelId = 0;
+
+    void complete(Result<T> value)
+    {
+        if (result)
+            return; // First completion wins
+        result = std::move(value);
+        for (const QMetaObject::Connection &connection : std::as_const(connections))
+            QObject::disconnect(connection);
+        connections.clear();
+        if (context.timers)
+            context.timers->cancel(timeout);
+        context.cancel.remove(cancelId);
+        if (waiter) {
+            // Not from inside the signal: the workflow may well delete the sender
+            QMetaObject::invokeMethod(QCoreApplication::instance(), [handle = std::exchange(waiter, {})]() {
+                handle.resume();
+            }, Qt::QueuedConnection);
+        }
+    }
+
+    void succeed(T value)
+    {
+        Result<T> done;
+        done.value = std::move(value);
+        complete(std::move(done));
+    }
+
+    void fail(Error error, const QString &errorString)
+    {
+        Result<T> failed;
+        failed.error = error;
+        failed.errorString = errorString;
+        complete(std::move(failed));
+    }
+};
+
+template<typename T>
+using OperationPtr = std::shared_ptr<Operation<T>>;
+
+// Arms the timeout, the cancel token and the object's destruction
+template<typename T>
+OperationPtr<T> start(const Context &context, QObject *object)
+{
+    OperationPtr<T> operation = std::make_shared<Operation<T>>();
+    operation->context = context;
+    if (!object) {
+        operation->fail(Gone, QStringLiteral("No object"));
+        return operation;
+    }
+    if (context.cancel.isCancelled()) {
+        operation->fail(Cancelled, QStringLiteral("Cancelled"));
+        return operation;
+    }
+
+    const std::weak_ptr<Operation<T>> weak = operation;
+    operation->cancelId = operation->context.cancel.onCancel([weak]() {
+        if (OperationPtr<T> live = weak.lock())
+            live->fail(Cancelled, QStringLiteral("Cancelled"));
+    });
+    if (context.timers && context.timeoutMs > 0) {
+        operation->timeout = context.timers->schedule(context.timeoutMs, [weak]() {
+            if (OperationPtr<T> live = weak.lock())
+                live->fail(TimedOut, QStringLiteral("Timed out"));
+        });
+    }
+    operation->connections.append(QObject::connect(object, &QObject::destroyed, [weak]() {
+        if (OperationPtr<T> live = weak.lock())
+            live->fail(Gone, QStringLiteral("Object deleted"));
+    }));
+    return operation;
+}
+
+template<typename T>
+class Awaiter
+{
+public:
+    explicit Awaiter(OperationPtr<T> operation) : m_operation(std::move(operation)) {}
+
+    bool await_ready() const noexcept { return m_operation->result.has_value(); }
+    void await_suspend(std::coroutine_handle<> handle) noexcept { m_operation->waiter = handle; }
+    Result<T> await_resume() { return std::move(*m_operation->result); }
+
+private:
+    OperationPtr<T> m_operation;
+};
+
+bool isLinkError(QLowEnergyController::Error error)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(6, 5, 0)
+    if (error == QLowEnergyController::RssiReadError)
+        return false; // Not fatal to the link
+#endif
+    return error != QLowEnergyController::NoError;
+}
+
+// Controller errors and disconnects fail controller-level operations
+template<typename T>
+void watchController(const OperationPtr<T> &operation, QLowEnergyController *controller)
+{
+    const std::weak_ptr<Operation<T>> weak = operation;
+    operation->connections.append(QObject::connect(controller, QOverload<QLowEnergyController::Error>::of(&QLowEnergyController::errorOccurred),
+                                                   [weak, controller](QLowEnergyController::Error error) {
+        if (!isLinkError(error))
+            return;
+        if (OperationPtr<T> live = weak.lock())
+            live->fail(Failed, controller->errorString());
+    }));
+    operation->connections.append(QObject::connect(controller, &QLowEnergyController::disconnected, [weak]() {
+        if (OperationPtr<T> live = weak.lock())
+            live->fail(Failed, QStringLiteral("Disconnected"));
+    }));
+}
+
+template<typename T>
+void watchService(const OperationPtr<T> &operation, QLowEnergyService *service)
+{
+    const std::weak_ptr<Operation<T>> weak = operation;
+    operation->connections.append(QObject::connect(service, QOverload<QLowEnergyService::ServiceError>::of(&QLowEnergyService::errorOccurred),
+                                                   [weak](QLowEnergyService::ServiceError error) {
+        if (OperationPtr<T> live = weak.lock())
+            live->fail(Failed, QStringLiteral("Service error %1").arg(int(error)));
+    }));
+}
+}
+
+// --- Operations ---
+Task<Result<>> connect(QLowEnergyController *controller, Context context)
+{
+    OperationPtr<Done> operation = start<Done>(context, controller);
+    if (!operation->result) {
+        if (controller->state() == QLowEnergyController::ConnectedState
+            || controller->state() == QLowEnergyController::DiscoveringState
+            || controller->state() == QLowEnergyController::DiscoveredState) {
+            operation->succeed({});
+        } else {
+            const std::weak_ptr<Operation<Done>> weak = operation;
+            watchController(operation, controller);
+            operation->connections.append(QObject::connect(controller, &QLowEnergyController::connected, [weak]() {
+                if (OperationPtr<Done> live = weak.lock())
+                    live->succeed({});
+            }));
+            if (controller->state() == QLowEnergyController::UnconnectedState)
+                controller->connectToDevice();
+        }
+    }
+    co_return co_await Awaiter<Done>(operation);
+}
+
+Task<Result<QList<QBluetoothUuid>>> discoverServices(QLowEnergyController *controller, Context context)
+{
+    OperationPtr<QList<QBluetoothUuid>> operation = start<QList<QBluetoothUuid>>(context, controller);
+    if (!operation->result) {
+        if (controller->state() == QLowEnergyController::DiscoveredState) {
+            operation->succeed(controller->services());
+        } else {
+            const std::weak_ptr<Operation<QList<QBluetoothUuid>>> weak = operation;
+            watchController(operation, controller);
+            operation->connections.append(QObject::connect(controller, &QLowEnergyController::discoveryFinished,
+                                                           [weak, controller]() {
+                if (OperationPtr<QList<QBluetoothUuid>> live = weak.lock())
+                    live->succeed(controller->services());
+            }));
+            if (controller->state() == QLowEnergyController::ConnectedState)
+                controller->discoverServices();
+        }
+    }
+    co_return co_await Awaiter<QList<QBluetoothUuid>>(operation);
+}
+
+Task<Result<>> discoverDetails(QLowEnergyService *service, Context context)
+{
+    OperationPtr<Done> operation = start<Done>(context, service);
+    if (!operation->result) {
+        if (service->state() == QLowEnergyService::RemoteServiceDiscovered) {
+            operation->succeed({});
+        } else {
+            const std::weak_ptr<Operation<Done>> weak = operation;
+            watchService(operation, service);
+            operation->connections.append(QObject::connect(service, &QLowEnergyService::stateChanged,
+                                                           [weak](QLowEnergyService::ServiceState state) {
+                if (state != QLowEnergyService::RemoteServiceDiscovered)
+                    return;
+                if (OperationPtr<Done> live = weak.lock())
+                    live->succeed({});
+            }));
+            if (service->state() == QLowEnergyService::RemoteService)
+                service->discoverDetails(); // Otherwise already under way
+        }
+    }
+    co_return co_await Awaiter<Done>(operation);
+}
+
+Task<Result<QByteArray>> read(QLowEnergyService *service, QLowEnergyCharacteristic characteristic, Context context)
+{
+    OperationPtr<QByteArray> operation = start<QByteArray>(context, service);
+    if (!operation->result) {
+        if (!(characteristic.properties() & QLowEnergyCharacteristic::Read)) {
+            operation->fail(Failed, QStringLiteral("Characteristic is not readable"));
+        } else {
+            const std::weak_ptr<Operation<QByteArray>> weak = operation;
+            const QBluetoothUuid uuid = characteristic.uuid();
+            watchService(operation, service);
+            operation->connections.append(QObject::connect(service, &QLowEnergyService::characteristicRead,
+                                                           [weak, uuid](const QLowEnergyCharacteristic &read, const QByteArray &value) {
+                if (read.uuid() != uuid)
+                    return;
+                if (OperationPtr<QByteArray> live = weak.lock())
+                    live->succeed(value);
+            }));
+            service->readCharacteristic(characteristic);
+        }
+    }
+    co_return co_await Awaiter<QByteArray>(operation);
+}
+
+Task<Result<QByteArray>> readDescriptor(QLowEnergyService *service, QLowEnergyDescriptor descriptor, Context context)
+{
+    OperationPtr<QByteArray> operation = start<QByteArray>(context, service);
+    if (!operation->result) {
+        const std::weak_ptr<Operation<QByteArray>> weak = operation;
+        watchService(operation, service);
+        operation->connections.append(QObject::connect(service, &QLowEnergyService::descriptorRead,
+                                                       [weak, descriptor](const QLowEnergyDescriptor &read, const QByteArray &value) {
+            if (read != descriptor)
+                return;
+            if (OperationPtr<QByteArray> live = weak.lock())
+                live->succeed(value);
+        }));
+        service->readDescriptor(descriptor);
+    }
+    co_return co_await Awaiter<QByteArray>(operation);
+}
+
+Task<Result<>> writeDescriptor(QLowEnergyService *service, QLowEnergyDescriptor descriptor, QByteArray value,
+                               Context context)
+{
+    OperationPtr<Done> operation = start<Done>(context, service);
+    if (!operation->result) {
+        const std::weak_ptr<Operation<Done>> weak = operation;
+        watchService(operation, service);
+        operation->connections.append(QObject::connect(service, &QLowEnergyService::descriptorWritten,
+                                                       [weak, descriptor](const QLowEnergyDescriptor &written, const QByteArray &) {
+            if (written != descriptor)
+                return;
+            if (OperationPtr<Done> live = weak.lock())
+                live->succeed({});
+        }));
+        service->writeDescriptor(descriptor, value);
+    }
+    co_return co_await Awaiter<Done>(operation);
+}
+
+} // namespace Gatt
@@ -0,0 +1,199 @@
+#ifndef GATTAWAIT_H
+#define GATTAWAIT_H
+
+#include "timingwheel.h"
+
+#include <QBluetoothUuid>
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QLowEnergyCharacteristic>
+#include <QLowEnergyController>
+#include <QLowEnergyDescriptor>
+#include <QLowEnergyService>
+#include <QMetaObject>
+#include <QString>
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+// Awaitable GATT operations (C++20 coroutines) on top of the QLowEnergyController and
+// QLowEnergyService signals, for workflows that would otherwise be a chain of slots:
+//
+//   Gatt::Task<> Station::open(QLowEnergyService *scale, QLowEnergyService *info)
+//   {
+//       std::vector<Gatt::Task<Gatt::Result<>>> details;
+//       details.push_back(Gatt::discoverDetails(scale, m_context));   // Both discoveries are
+//       details.push_back(Gatt::discoverDetails(info, m_context));    // in flight from here on
+//       for (const Gatt::Result<> &result : co_await Gatt::whenAll(std::move(details)))
+//           if (!result) co_return;
+//       const Gatt::Result<QByteArray> model = co_await Gatt::read(info, modelNumber, m_context);
+//       ...
+//   }
+//
+// Tasks start eagerly and run up to their first co_await, so operations started before any of
+// them is awaited run concurrently; whenAll() collects their results in order. Every operation
+// ends in a Result carrying the value or why there is none (Failed, TimedOut, Cancelled, or Gone
+// when the controller or service was deleted); nothing throws. Completions resume the waiting
+// coroutine from the event loop, never from inside the Qt signal, so a workflow may delete the
+// object that completed it.
+//
+// A Context carries the TimerService for timeouts and a Cancel token. Cancelling completes every
+// operation still pending under that token with Cancelled; a workflow must check each Result
+// before touching state that the cancelling code may have torn down.
+namespace Gatt {
+
+enum Error { NoError, Failed, TimedOut, Cancelled, Gone };
+const char *errorName(Error error);
+
+struct Done {}; // Value of operations that only succeed or fail
+
+template<typename T = Done>
+struct Result {
+    T value{};
+    Error error = NoError;
+    QString errorString;
+
+    explicit operator bool() const { return error == NoError; }
+};
+
+// Shared cancellation flag: copies observe and cancel the same state. Assign a fresh Cancel to
+// start over; tokens already handed out stay cancelled.
+class Cancel
+{
+public:
+    Cancel();
+
+    void cancel(); // Runs and drops the registered callbacks
+    bool isCancelled() const { return d->cancelled; }
+
+    int onCancel(std::function<void()> callback); // Not registered (returns 0) if already cancelled
+    void remove(int id);
+
+private:
+    struct State {
+        bool cancelled = false;
+        int nextId = 1;
+        QHash<int, std::function<void()>> callbacks;
+    };
+    std::shared_ptr<State> d;
+};
+
+struct Context {
+    TimerService *timers = nullptr; // Null: no timeouts
+    qint64 timeoutMs = 10000;       // Per operation
+    Cancel cancel;
+};
+
+// --- Task ---
+namespace Detail {
+template<typename T>
+struct ReturnValue {
+    std::optional<T> value;
+    void return_value(T result) { value.emplace(std::move(result)); }
+    T take() { return std::move(*value); }
+};
+
+template<>
+struct ReturnValue<void> {
+    void return_void() {}
+    void take() {}
+};
+} // namespace Detail
+
+// Coroutine result, awaitable once. Destroying a Task that has not finished detaches it: the
+// coroutine keeps running and frees itself when done (fire and forget).
+template<typename T = void>
+class Task
+{
+public:
+    struct promise_type : Detail::ReturnValue<T> {
+        std::coroutine_handle<> continuation;
+        bool detached = false;
+
+        struct FinalAwaiter {
+            bool await_ready() const noexcept { return false; }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept
+            {
+                promise_type &promise = handle.promise();
+                if (promise.continuation)
+                    return promise.continuation;
+                if (promise.detached)
+                    handle.destroy();
+                return std::noop_coroutine();
+            }
+            void await_resume() const noexcept {}
+        };
+
+        Task get_return_object() { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_never initial_suspend() const noexcept { return {}; }
+        FinalAwaiter final_suspend() const noexcept { return {}; }
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    Task(Task &&other) noexcept : m_handle(std::exchange(other.m_handle, {})) {}
+    Task &operator=(Task &&other) noexcept
+    {
+        if (this != &other) {
+            release();
+            m_handle = std::exchange(other.m_handle, {});
+        }
+        return *this;
+    }
+    Task(const Task &) = delete;
+    Task &operator=(const Task &) = delete;
+    ~Task() { release(); }
+
+    bool isDone() const { return !m_handle || m_handle.done(); }
+
+    bool await_ready() const noexcept { return m_handle.done(); }
+    void await_suspend(std::coroutine_handle<> awaiting) noexcept { m_handle.promise().continuation = awaiting; }
+    T await_resume() { return m_handle.promise().take(); }
+
+private:
+    explicit Task(std::coroutine_handle<promise_type> handle) : m_handle(handle) {}
+
+    void release()
+    {
+        if (!m_handle)
+            return;
+        if (m_handle.done())
+            m_handle.destroy();
+        else
+            m_handle.promise().detached = true;
+        m_handle = {};
+    }
+
+    std::coroutine_handle<promise_type> m_handle;
+};
+
+// Awaits every task in order; as they were all started before, they run concurrently
+template<typename T>
+Task<std::vector<T>> whenAll(std::vector<Task<T>> tasks)
+{
+    std::vector<T> results;
+    results.reserve(tasks.size());
+    for (Task<T> &task : tasks)
+        results.push_back(co_await task);
+    co_return results;
+}
+
+// --- Operations ---
+Task<Result<>> connect(QLowEnergyController *controller, Context context);
+Task<Result<QList<QBluetoothUuid>>> discoverServices(QLowEnergyController *controller, Context context);
+Task<Result<>> discoverDetails(QLowEnergyService *service, Context context);
+
+// Concurrent reads on one service are matched to their completions by characteristic UUID. A
+// service error cannot be attributed to one request, so it fails every read pending on it.
+Task<Result<QByteArray>> read(QLowEnergyService *service, QLowEnergyCharacteristic characteristic, Context context);
+Task<Result<QByteArray>> readDescriptor(QLowEnergyService *service, QLowEnergyDescriptor descriptor, Context context);
+Task<Result<>> writeDescriptor(QLowEnergyService *service, QLowEnergyDescriptor descriptor, QByteArray value,
+                               Context context);
+
+} // namespace Gatt
+
+#endif // GATTAWAIT_H
@@ -0,0 +1,19 @@
+#include "gattuuid.h"
+
+namespace GattUuid {
+
+bool parse(QString text, QBluetoothUuid &uuid)
+{
+    text = text.trimmed();
+    if (text.startsWith(QLatin1String("0x"), Qt::CaseInsensitive))
+        text = text.mid(2);
+    if (text.size() <= 4) {
+        bool ok = false;
+        uuid = QBluetoothUuid(quint16(text.toUShort(&ok, 16)));
+        return ok;
+    }
+    uuid = QBluetoothUuid(text);
+    return !uuid.isNull();
+}
+
+} // namespace GattUuid
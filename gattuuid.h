@@ -0,0 +1,15 @@
+#ifndef GATTUUID_H
+#define GATTUUID_H
+
+#include <QBluetoothUuid>
+#include <QString>
+
+// UUIDs as written by people: config files, layout specs, script file names.
+namespace GattUuid {
+
+// Full UUIDs as well as 16-bit SIG short forms ("181d", "0x181D"); surrounding space is ignored
+bool parse(QString text, QBluetoothUuid &uuid);
+
+} // namespace GattUuid
+
+#endif // GATTUUID_H
@@ -0,0 +1,464 @@
+#include "httpserver.h"
+#include "memoryaccounting.h"
+#include "samplejson.h"
+#include <QDebug>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QUrl>
+
+namespace {
+constexpr int MaxRequestHeaderSize = 8 * 1024;
+constexpr int MaxRequestBodySize = 64 * 1024;
+
+QByteArray statusText(int status)
+{
+    switch (status) {
+    case 200: return "OK";
+    case 400: return "Bad Request";
+    case 403: return "Forbidden";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 413: return "Payload Too Large";
+    case 415: return "Unsupported Media Type";
+    case 431: return "Request Header Fields Too Large";
+    default: return "Error";
+    }
+}
+
+// Host and Origin may only name this machine: the server is bound to localhost, so anything else
+// is a page elsewhere reaching it through the browser (or a rebound DNS name)
+bool isLocalHost(QByteArray host)
+{
+    if (host.startsWith('[')) {
+        host = host.left(host.indexOf(']') + 1);
+    } else {
+        const qsizetype colon = host.indexOf(':');
+        if (colon >= 0)
+            host.truncate(colon);
+    }
+    host = host.toLower();
+    return host == "localhost" || host == "127.0.0.1" || host == "[::1]";
+}
+
+bool isLocalOrigin(const QByteArray &origin)
+{
+    return origin.startsWith("http://") && isLocalHost(origin.mid(7));
+}
+
+QByteArray jsonString(const QString &text)
+{
+    QByteArray out = "\"";
+    for (QChar c : text) {
+        switch (c.unicode()) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (c.unicode() < 0x20)
+                out += "\\u" + QByteArray::number(c.unicode(), 16).rightJustified(4, '0');
+            else
+                out += QString(c).toUtf8();
+        }
+    }
+    out += '"';
+    return out;
+}
+}
+
+HttpServer::HttpServer(QObject *parent)
+    : QObject(parent)
+    , m_server(nullptr)
+    , m_maxStreamRate(20.0)
+    , m_maxBacklogBytes(512 * 1024)
+    , m_droppedBatches(0)
+    , m_startedAt(QDateTime::currentDateTimeUtc())
+    , m_samplesPublished(0)
+{
+    m_clock.start();
+
+    m_flushTimer.setInterval(50);
+    m_flushTimer.setSingleShot(true);
+    connect(&m_flushTimer, &QTimer::timeout, this, &HttpServer::flushStream);
+
+    m_keepAliveTimer.setInterval(15000);
+    connect(&m_keepAliveTimer, &QTimer::timeout, this, &HttpServer::sendKeepAlive);
+
+    addRoute("/api/devices", [this](const Request &) { return devicesResponse(); });
+    addRoute("/api/latest", [this](const Request &) { return latestResponse(); });
+    addRoute("/api/session", [this](const Request &) { return sessionResponse(); });
+}
+
+HttpServer::~HttpServer()
+{
+    if (m_server)
+        m_server->close();
+}
+
+bool HttpServer::listen(quint16 port)
+{
+    if (!m_server) {
+        m_server = new QTcpServer(this);
+        connect(m_server, &QTcpServer::newConnection, this, &HttpServer::onNewConnection);
+    }
+    if (!m_server->listen(QHostAddress::LocalHost, port)) {
+        qWarning() << "HTTP server: listen failed:" << m_server->errorString();
+        return false;
+    }
+    qDebug() << "HTTP server listening on http://127.0.0.1:" << m_server->serverPort();
+    return true;
+}
+
+quint16 HttpServer::serverPort() const
+{
+    return m_server ? m_server->serverPort() : 0;
+}
+
+void HttpServer::addRoute(const QByteArray &path, Handler handler, const QByteArray &method)
+{
+    m_routes.insert(method + ' ' + path, std::move(handler));
+}
+
+// --- REST state ---
+void HttpServer::updateDevice(const QBluetoothDeviceInfo &device)
+{
+    DeviceEntry &entry = m_devices[device.address().toUInt64()];
+    entry.name = device.name();
+    entry.rssi = device.rssi();
+    entry.lastSeenMs = QDateTime::currentMSecsSinceEpoch();
+}
+
+void HttpServer::clearDevices()
+{
+    m_devices.clear();
+}
+
+void HttpServer::setConnectedDevice(const QBluetoothDeviceInfo &device)
+{
+    m_connectedDevice = device;
+}
+
+void HttpServer::publish(const Sample &sample)
+{
+    ++m_samplesPublished;
+    m_latest.insert(qMakePair(sample.device, sample.characteristic), sample);
+
+    if (m_streamClients.isEmpty())
+        return;
+
+    if (!m_batch.isEmpty())
+        m_batch += ',';
+    SampleJson::append(m_batch, sample);
+    if (!m_flushTimer.isActive())
+        m_flushTimer.start();
+}
+
+HttpServer::Response HttpServer::devicesResponse() const
+{
+    Response response;
+    response.body = "[";
+    for (auto it = m_devices.constBegin(); it != m_devices.constEnd(); ++it) {
+        if (it != m_devices.constBegin())
+            response.body += ',';
+        response.body += "{\"address\":\"" + QBluetoothAddress(it.key()).toString().toLatin1()
+                         + "\",\"name\":" + jsonString(it->name)
+                         + ",\"rssi\":" + QByteArray::number(it->rssi)
+                         + ",\"lastSeen\":" + QByteArray::number(it->lastSeenMs) + '}';
+    }
+    response.body += ']';
+    return response;
+}
+
+HttpServer::Response HttpServer::latestResponse() const
+{
+    Response response;
+    response.body = "[";
+    bool first = true;
+    for (const Sample &sample : m_latest) {
+        if (!first)
+            response.body += ',';
+        first = false;
+        SampleJson::append(response.body, sample);
+    }
+    response.body += ']';
+    return response;
+}
+
+HttpServer::Response HttpServer::sessionResponse() const
+{
+    Response response;
+    response.body = "{\"startedAt\":" + jsonString(m_startedAt.toString(Qt::ISODateWithMs))
+                    + ",\"uptimeMs\":" + QByteArray::number(m_clock.elapsed())
+                    + ",\"connectedDevice\":";
+    if (m_connectedDevice.isValid()) {
+        response.body += "{\"address\":\"" + m_connectedDevice.address().toString().toLatin1()
+                         + "\",\"name\":" + jsonString(m_connectedDevice.name()) + '}';
+    } else {
+        response.body += "null";
+    }
+    response.body += ",\"samplesPublished\":" + QByteArray::number(m_samplesPublished)
+                     + ",\"streamClients\":" + QByteArray::number(m_streamClients.size())
+                     + ",\"droppedStreamBatches\":" + QByteArray::number(m_droppedBatches) + '}';
+    return response;
+}
+
+// --- Connection handling ---
+void HttpServer::onNewConnection()
+{
+    while (QTcpSocket *socket = m_server->nextPendingConnection()) {
+        m_requestBuffers.insert(socket, QByteArray());
+        connect(socket, &QTcpSocket::readyRead, this, [this, socket]() { onReadyRead(socket); });
+        connect(socket, &QTcpSocket::disconnected, this, [this, socket]() {
+            m_requestBuffers.remove(socket);
+            removeStreamClient(socket);
+            socket->deleteLater();
+        });
+    }
+}
+
+void HttpServer::onReadyRead(QTcpSocket *socket)
+{
+    auto it = m_requestBuffers.find(socket);
+    if (it == m_requestBuffers.end()) {
+        socket->readAll(); // Already answered (or streaming); ignore further input
+        return;
+    }
+
+    it.value() += socket->readAll();
+    const qsizetype end = it.value().indexOf("\r\n\r\n");
+    if (end < 0) {
+        if (it.value().size() > MaxRequestHeaderSize) {
+            m_requestBuffers.erase(it);
+            Response response;
+            response.status = 431;
+            response.body = "{\"error\":\"request header too large\"}";
+            sendResponse(socket, response);
+        }
+        return;
+    }
+
+    // A body follows only when Content-Length says so; wait until all of it is buffered
+    const QByteArray header = it.value().left(end);
+    qint64 bodySize = 0;
+    const QList<QByteArray> lines = header.split('\n');
+    for (const QByteArray &line : lines) {
+        const qsizetype colon = line.indexOf(':');
+        if (colon > 0 && line.left(colon).trimmed().toLower() == "content-length") {
+            bool ok = false;
+            bodySize = line.mid(colon + 1).trimmed().toLongLong(&ok);
+            if (!ok || bodySize < 0)
+                bodySize = -1;
+        }
+    }
+    if (bodySize < 0 || bodySize > MaxRequestBodySize) {
+        m_requestBuffers.erase(it);
+        Response response;
+        response.status = bodySize < 0 ? 400 : 413;
+        response.body = bodySize < 0 ? "{\"error\":\"malformed Content-Length\"}" : "{\"error\":\"request body too large\"}";
+        sendResponse(socket, response);
+        return;
+    }
+    if (it.value().size() < end + 4 + bodySize)
+        return;
+
+    const QByteArray body = it.value().mid(end + 4, bodySize);
+    m_requestBuffers.erase(it);
+    handleRequest(socket, header, body);
+}
+
+void HttpServer::handleRequest(QTcpSocket *socket, const QByteArray &header, const QByteArray &body)
+{
+    const QByteArray requestLine = header.left(header.indexOf("\r\n"));
+    const QList<QByteArray> parts = requestLine.split(' ');
+    if (parts.size() != 3) {
+        Response response;
+        response.status = 400;
+        response.body = "{\"error\":\"malformed request line\"}";
+        sendResponse(socket, response);
+        return;
+    }
+
+    Request request;
+    request.method = parts.at(0);
+    const QUrl url(QString::fromLatin1(parts.at(1)));
+    request.path = url.path().toLatin1();
+    request.query = QUrlQuery(url);
+    request.body = body;
+    const QList<QByteArray> lines = header.split('\n');
+    for (qsizetype i = 1; i < lines.size(); ++i) {
+        const qsizetype colon = lines.at(i).indexOf(':');
+        if (colon > 0)
+            request.headers.insert(lines.at(i).left(colon).trimmed().toLower(), lines.at(i).mid(colon + 1).trimmed());
+    }
+
+    if (request.headers.contains("host") && !isLocalHost(request.headers.value("host"))) {
+        Response response;
+        response.status = 403;
+        response.body = "{\"error\":\"host not allowed\"}";
+        sendResponse(socket, response);
+        return;
+    }
+
+    if (request.method == "GET" && request.path == "/api/stream") {
+        startStream(socket, request);
+        return;
+    }
+
+    auto route = m_routes.constFind(request.method + ' ' + request.path);
+    if (route == m_routes.constEnd()) {
+        Response response;
+        if (request.path == "/api/stream" || m_routes.contains("GET " + request.path) || m_routes.contains("POST " + request.path)) {
+            response.status = 405;
+            response.body = "{\"error\":\"method not allowed\"}";
+        } else {
+            response.status = 404;
+            response.body = "{\"error\":\"not found\"}";
+        }
+        sendResponse(socket, response);
+        return;
+    }
+
+    // Only GET is readable from other origins. Anything that changes state must come from a local
+    // page (or no browser at all) and carry a JSON body, which a cross-site form or a CORS "simple
+    // request" cannot send without a preflight that is never answered.
+    if (request.method != "GET") {
+        Response response;
+        if (request.headers.contains("origin") && !isLocalOrigin(request.headers.value("origin"))) {
+            response.status = 403;
+            response.body = "{\"error\":\"origin not allowed\"}";
+            sendResponse(socket, response);
+            return;
+        }
+        if (!request.headers.value("content-type").startsWith("application/json")) {
+            response.status = 415;
+            response.body = "{\"error\":\"expected Content-Type: application/json\"}";
+            sendResponse(socket, response);
+            return;
+        }
+    }
+    sendResponse(socket, route.value()(request), request.method == "GET");
+}
+
+void HttpServer::sendResponse(QTcpSocket *socket, const Response &response, bool crossOrigin)
+{
+    QByteArray out;
+    out.reserve(128 + response.body.size());
+    out += "HTTP/1.1 " + QByteArray::number(response.status) + ' ' + statusText(response.status) + "\r\n";
+    out += "Content-Type: " + response.contentType + "\r\n";
+    out += "Content-Length: " + QByteArray::number(response.body.size()) + "\r\n";
+    if (crossOrigin)
+        out += "Access-Control-Allow-Origin: *\r\n";
+    out += "Connection: close\r\n\r\n";
+    out += response.body;
+    socket->write(out);
+    socket->disconnectFromHost(); // Closes once the write buffer has drained
+}
+
+// --- Server-Sent Events ---
+void HttpServer::startStream(QTcpSocket *socket, const Request &request)
+{
+    StreamClient client;
+    client.socket = socket;
+    double hz = m_maxStreamRate;
+    bool ok = false;
+    const double requested = request.query.queryItemValue("maxHz").toDouble(&ok);
+    if (ok && requested > 0.0)
+        hz = qMin(hz, requested);
+    client.minIntervalMs = hz > 0.0 ? qint64(1000.0 / hz) : 0;
+    client.lastSendMs = 0;
+    m_streamClients.append(client);
+
+    socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+    socket->write("HTTP/1.1 200 OK\r\n"
+                  "Content-Type: text/event-stream\r\n"
+                  "Cache-Control: no-cache\r\n"
+                  "Access-Control-Allow-Origin: *\r\n"
+                  "Connection: keep-alive\r\n\r\n"
+                  "retry: 2000\n\n");
+    if (!m_keepAliveTimer.isActive())
+        m_keepAliveTimer.start();
+    qDebug() << "SSE client connected, clients:" << m_streamClients.size();
+}
+
+void HttpServer::removeStreamClient(QTcpSocket *socket)
+{
+    for (int i = 0; i < m_streamClients.size(); ++i) {
+        if (m_streamClients.at(i).socket == socket) {
+            m_streamClients.removeAt(i);
+            qDebug() << "SSE client disconnected, clients:" << m_streamClients.size();
+            break;
+        }
+    }
+    if (m_streamClients.isEmpty())
+        m_keepAliveTimer.stop();
+}
+
+void HttpServer::flushStream()
+{
+    const qint64 now = m_clock.elapsed();
+    const bool haveBatch = !m_batch.isEmpty();
+    QByteArray event;
+    if (haveBatch)
+        event = "event: samples\ndata: [" + m_batch + "]\n\n";
+    bool backlogPending = false;
+
+    for (StreamClient &client : m_streamClients) {
+        const bool due = now - client.lastSendMs >= client.minIntervalMs;
+        // Nothing more is written to a socket that is not draining; meanwhile only the newest
+        // batch is kept, so neither its buffer nor its backlog grows without bound
+        const bool stalled = client.socket->bytesToWrite() > m_maxBacklogBytes;
+
+        if (haveBatch) {
+            if (client.backlog.isEmpty() && due && !stalled) {
+                client.socket->write(event); // Common case: shared, pre-serialised event
+                client.lastSendMs = now;
+                continue;
+            }
+            if (!client.backlog.isEmpty())
+                client.backlog += ',';
+            client.backlog += m_batch;
+            if (client.backlog.size() > m_batch.size() && (stalled || client.backlog.size() > m_maxBacklogBytes)) {
+                client.backlog = m_batch; // Slow consumer: keep only the newest batch
+                ++m_droppedBatches;
+            }
+        }
+
+        if (client.backlog.isEmpty())
+            continue;
+        if (due && !stalled) {
+            client.socket->write("event: samples\ndata: [" + client.backlog + "]\n\n");
+            client.backlog.clear();
+            client.lastSendMs = now;
+        } else {
+            backlogPending = true;
+        }
+    }
+    m_batch.clear();
+
+    // Rate capped clients with a backlog need another flush even if no new samples arrive
+    if (backlogPending)
+        m_flushTimer.start();
+}
+
+void HttpServer::sendKeepAlive()
+{
+    for (const StreamClient &client : std::as_const(m_streamClients)) {
+        if (client.socket->bytesToWrite() == 0) // Data still queued keeps the connection alive anyway
+            client.socket->write(": keep-alive\n\n");
+    }
+}
+
+qint64 HttpServer::memoryUsage() const
+{
+    qint64 bytes = MemoryAccounting::bytes(m_batch) + MemoryAccounting::containerBytes(m_requestBuffers)
+                   + MemoryAccounting::containerBytes(m_streamClients) + MemoryAccounting::containerBytes(m_devices)
+                   + MemoryAccounting::containerBytes(m_latest);
+    for (const QByteArray &buffer : m_requestBuffers)
+        bytes += MemoryAccounting::bytes(buffer);
+    for (const StreamClient &client : m_streamClients)
+        bytes += MemoryAccounting::bytes(client.backlog) + client.socket->bytesToWrite();
+    for (const DeviceEntry &device : m_devices)
+        bytes += MemoryAccounting::bytes(device.name);
+    return bytes;
+}
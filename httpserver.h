@@ -0,0 +1,131 @@
+#ifndef HTTPSERVER_H
+#define HTTPSERVER_H
+
+#include "sample.h"
+
+#include <QObject>
+#include <QBluetoothDeviceInfo>
+#include <QByteArray>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QPair>
+#include <QTimer>
+#include <QUrlQuery>
+#include <functional>
+
+class QTcpServer;
+class QTcpSocket;
+
+// Minimal in-tree HTTP/1.1 server bound to localhost.
+//
+//   GET /api/devices   devices seen by the current scan
+//   GET /api/latest    latest sample per device and characteristic
+//   GET /api/session   session metadata (start time, connected device, counters)
+//   GET /api/stream    Server-Sent Events; each event carries a JSON array of samples.
+//                      Optional ?maxHz=N lowers the per-connection event rate.
+//
+// Routes answer GET unless registered for another method; a POST body (up to 64 KiB, sized by
+// Content-Length) is handed to the handler as is. GET must not change state: only GET responses
+// are shared with other origins. Other methods need Content-Type: application/json and, from a
+// browser, a localhost Origin. Requests naming another Host are refused (DNS rebinding).
+//
+// Samples are batched per flush interval and serialised once for all stream clients. A client
+// that is rate capped accumulates batches until its next send slot; if that backlog or its socket
+// buffer grows past the configured bound the backlog is dropped in favour of the newest batch.
+// Nothing is written to a socket holding more than the bound, so a stalled client costs at most
+// the bound plus one event.
+// Additional endpoints can be registered with addRoute().
+class HttpServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Request {
+        QByteArray method;
+        QByteArray path;
+        QUrlQuery query;
+        QByteArray body;
+        QHash<QByteArray, QByteArray> headers; // Names in lower case
+    };
+    struct Response {
+        int status = 200;
+        QByteArray contentType = "application/json";
+        QByteArray body;
+    };
+    using Handler = std::function<Response(const Request &)>;
+
+    explicit HttpServer(QObject *parent = nullptr);
+    ~HttpServer();
+
+    bool listen(quint16 port);
+    quint16 serverPort() const; // The port actually bound, after listen(0)
+    void addRoute(const QByteArray &path, Handler handler, const QByteArray &method = "GET");
+
+    // --- State exposed by the REST endpoints ---
+    void updateDevice(const QBluetoothDeviceInfo &device);
+    void removeDevice(quint64 address) { m_devices.remove(address); }
+    void clearDevices();
+    void setConnectedDevice(const QBluetoothDeviceInfo &device); // Invalid info = disconnected
+
+    void publish(const Sample &sample);
+
+    void setFlushInterval(int msec) { m_flushTimer.setInterval(qMax(1, msec)); }
+    void setMaxStreamRate(double hz) { m_maxStreamRate = hz; }
+    void setMaxStreamBacklog(qint64 bytes) { m_maxBacklogBytes = bytes; }
+
+    int streamClientCount() const { return m_streamClients.size(); }
+    quint64 droppedStreamBatches() const { return m_droppedBatches; }
+    qint64 memoryUsage() const; // Buffers, stream backlogs and the device/latest tables, see MemoryAccounting
+
+private slots:
+    void onNewConnection();
+    void flushStream();
+    void sendKeepAlive();
+
+private:
+    struct StreamClient {
+        QTcpSocket *socket;
+        qint64 minIntervalMs;
+        qint64 lastSendMs;
+        QByteArray backlog;      // Comma separated JSON objects not yet sent
+    };
+    struct DeviceEntry {
+        QString name;
+        qint16 rssi;
+        qint64 lastSeenMs;
+    };
+
+    void onReadyRead(QTcpSocket *socket);
+    void handleRequest(QTcpSocket *socket, const QByteArray &header, const QByteArray &body);
+    void sendResponse(QTcpSocket *socket, const Response &response, bool crossOrigin = false);
+    void startStream(QTcpSocket *socket, const Request &request);
+    void removeStreamClient(QTcpSocket *socket);
+
+    Response devicesResponse() const;
+    Response latestResponse() const;
+    Response sessionResponse() const;
+
+    QTcpServer *m_server;
+    QHash<QByteArray, Handler> m_routes; // Keyed by "METHOD /path"
+    QHash<QTcpSocket *, QByteArray> m_requestBuffers;
+    QList<StreamClient> m_streamClients;
+
+    QElapsedTimer m_clock;
+    QTimer m_flushTimer;
+    QTimer m_keepAliveTimer;
+    QByteArray m_batch;          // Comma separated JSON objects since the last flush
+    double m_maxStreamRate;
+    qint64 m_maxBacklogBytes;
+    quint64 m_droppedBatches;
+
+    QMap<quint64, DeviceEntry> m_devices;
+    QMap<QPair<quint64, QBluetoothUuid>, Sample> m_latest;
+    QBluetoothDeviceInfo m_connectedDevice;
+    QDateTime m_startedAt;
+    quint64 m_samplesPublished;
+};
+
+#endif // HTTPSERVER_H
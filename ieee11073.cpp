@@ -0,0 +1,54 @@
+#include "ieee11073.h"
+
+namespace {
+// Special value for each mantissa from +INF upwards, when the exponent is 0
+constexpr quint8 kSpecials[5] = {
+    Sample::PositiveInfinity, // 0x7FE / 0x7FFFFE
+    Sample::NotANumber,       // 0x7FF / 0x7FFFFF
+    Sample::NotAtResolution,  // 0x800 / 0x800000
+    Sample::ReservedValue,    // 0x801 / 0x800001
+    Sample::NegativeInfinity, // 0x802 / 0x800002
+};
+}
+
+namespace Ieee11073 {
+
+void decodeSFloat(const uchar *data, int count, qint32 *mantissa, qint8 *exponent, quint8 *special)
+{
+    for (int i = 0; i < count; ++i) {
+        const quint32 raw = quint32(data[2 * i]) | (quint32(data[2 * i + 1]) << 8);
+        const quint32 bits = raw & 0x0FFF;
+        const quint32 exponentBits = raw >> 12;
+        mantissa[i] = qint32(bits ^ 0x800) - 0x800;
+        exponent[i] = qint8(qint32(exponentBits ^ 0x8) - 0x8);
+        const quint32 slot = bits - 0x7FE; // Wraps for anything below +INF
+        special[i] = (exponentBits == 0 && slot < 5) ? kSpecials[slot < 5 ? slot : 0] : quint8(Sample::NoSpecial);
+    }
+}
+
+void decodeFloat(const uchar *data, int count, qint32 *mantissa, qint8 *exponent, quint8 *special)
+{
+    for (int i = 0; i < count; ++i) {
+        const uchar *p = data + 4 * i;
+        const quint32 bits = quint32(p[0]) | (quint32(p[1]) << 8) | (quint32(p[2]) << 16);
+        mantissa[i] = qint32(bits ^ 0x800000) - 0x800000;
+        exponent[i] = qint8(p[3]);
+        const quint32 slot = bits - 0x7FFFFE;
+        special[i] = (p[3] == 0 && slot < 5) ? kSpecials[slot < 5 ? slot : 0] : quint8(Sample::NoSpecial);
+    }
+}
+
+void toSample(qint32 mantissa, qint8 exponent, quint8 special, Sample &out)
+{
+    if (special != Sample::NoSpecial) {
+        out.mantissa = special;
+        out.exponent = 0;
+        out.flags = (out.flags & ~Sample::HasValue) | Sample::Special;
+        return;
+    }
+    out.mantissa = mantissa;
+    out.exponent = exponent;
+    out.flags = (out.flags & ~Sample::Special) | Sample::HasValue;
+}
+
+} // namespace Ieee11073
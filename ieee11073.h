@@ -0,0 +1,30 @@
+#ifndef IEEE11073_H
+#define IEEE11073_H
+
+#include "sample.h"
+
+#include <QtGlobal>
+
+// IEEE-11073-20601 medical floats, as used by the health and scale profiles.
+//
+//   SFLOAT  16 bit: 4-bit signed exponent, 12-bit signed mantissa
+//   FLOAT   32 bit: 8-bit signed exponent, 24-bit signed mantissa
+//
+// value = mantissa * 10^exponent. A handful of mantissas with exponent 0 are reserved for NaN,
+// NRes (not at this resolution), +INF, -INF and a reserved code.
+//
+// The kernels decode arrays of little-endian values into separate mantissa / exponent / special
+// arrays. They are written as straight-line loops without data-dependent branches so the
+// compiler can vectorise them for whatever the target has (SSE/AVX, NEON); there is no
+// hand-written SIMD to maintain per platform.
+namespace Ieee11073 {
+
+void decodeSFloat(const uchar *data, int count, qint32 *mantissa, qint8 *exponent, quint8 *special);
+void decodeFloat(const uchar *data, int count, qint32 *mantissa, qint8 *exponent, quint8 *special);
+
+// Single values into a Sample: HasValue, or Special with the Sample::SpecialValue in mantissa
+void toSample(qint32 mantissa, qint8 exponent, quint8 special, Sample &out);
+
+} // namespace Ieee11073
+
+#endif // IEEE11073_H
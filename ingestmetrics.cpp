@@ -0,0 +1,117 @@
+#include "ingestmetrics.h"
+#include "probes.h"
+#include "tracer.h"
+#include <QFile>
+
+#ifdef Q_OS_LINUX
+#include <unistd.h>
+#endif
+
+namespace {
+const char *const kOpNames[IngestMetrics::GattOpCount] = {
+    "connect", "discover_services", "discover_details", "read_characteristic", "write_descriptor"
+};
+
+// Resident and virtual size from /proc/self/statm (Linux); nothing elsewhere
+void collectMemory(QByteArray &out)
+{
+#ifdef Q_OS_LINUX
+    QFile statm(QStringLiteral("/proc/self/statm"));
+    if (!statm.open(QIODevice::ReadOnly))
+        return;
+    const QList<QByteArray> fields = statm.readAll().simplified().split(' ');
+    if (fields.size() < 2)
+        return;
+    const double pageSize = double(sysconf(_SC_PAGESIZE));
+    MetricsRegistry::appendMetric(out, "process_virtual_memory_bytes", "gauge",
+                                  "Virtual memory size in bytes.", fields.at(0).toDouble() * pageSize);
+    MetricsRegistry::appendMetric(out, "process_resident_memory_bytes", "gauge",
+                                  "Resident memory size in bytes.", fields.at(1).toDouble() * pageSize);
+#else
+    Q_UNUSED(out);
+#endif
+}
+}
+
+IngestMetrics::IngestMetrics()
+    : m_lastAddress(0)
+{
+    MetricsRegistry &registry = MetricsRegistry::instance();
+    m_adverts = registry.counter("blescale_scan_adverts_total", "Advertisements received while scanning.");
+    m_decodeErrors = registry.counter("blescale_decode_errors_total", "Payloads of known characteristics that failed to decode.");
+    m_connects = registry.counter("blescale_connects_total", "Successful BLE connections.");
+    m_reconnects = registry.counter("blescale_reconnects_total", "Connections to the same device as the previous connection.");
+    m_disconnects = registry.counter("blescale_disconnects_total", "BLE disconnections.");
+    for (int op = 0; op < GattOpCount; ++op) {
+        m_opLatency[op] = registry.histogram("blescale_gatt_operation_seconds", "GATT operation latency.",
+                                             QByteArray("op=\"") + kOpNames[op] + '"');
+    }
+    registry.addCollector(this, collectMemory);
+    m_clock.start();
+}
+
+IngestMetrics::~IngestMetrics()
+{
+    MetricsRegistry::instance().removeCollectors(this);
+}
+
+Counter *IngestMetrics::notificationCounter(const QBluetoothUuid &characteristic)
+{
+    auto it = m_notifications.constFind(characteristic);
+    if (it != m_notifications.constEnd())
+        return it.value();
+
+    Counter *counter = MetricsRegistry::instance().counter(
+        "blescale_notifications_total", "Notifications received per characteristic.",
+        "characteristic=\"" + characteristic.toByteArray(QUuid::WithoutBraces) + '"');
+    m_notifications.insert(characteristic, counter);
+    return counter;
+}
+
+void IngestMetrics::connected(quint64 address)
+{
+    m_connects->inc();
+    if (address == m_lastAddress)
+        m_reconnects->inc();
+    m_lastAddress = address;
+}
+
+void IngestMetrics::opStarted(GattOp op, quint64 key)
+{
+    m_pending[op][key].append({m_clock.nsecsElapsed() / 1000, Tracer::instance().asyncBegin(kOpNames[op])});
+    BLESCALE_PROBE2(gatt_op_start, int(op), key);
+}
+
+void IngestMetrics::opFinished(GattOp op, quint64 key)
+{
+    auto it = m_pending[op].find(key);
+    if (it == m_pending[op].end())
+        return;
+    const PendingOp pending = it.value().takeFirst();
+    const quint64 latencyUs = quint64(m_clock.nsecsElapsed() / 1000 - pending.startUs);
+    m_opLatency[op]->observeUs(latencyUs);
+    if (it.value().isEmpty())
+        m_pending[op].erase(it);
+    Tracer::instance().asyncEnd(kOpNames[op], pending.traceId);
+    BLESCALE_PROBE3(gatt_op_done, int(op), key, latencyUs);
+}
+
+void IngestMetrics::opFailed(GattOp op, quint64 key)
+{
+    auto it = m_pending[op].find(key);
+    if (it == m_pending[op].end())
+        return;
+    const PendingOp pending = it.value().takeFirst();
+    if (it.value().isEmpty())
+        m_pending[op].erase(it);
+    Tracer::instance().asyncEnd(kOpNames[op], pending.traceId);
+}
+
+void IngestMetrics::opAborted(GattOp op)
+{
+    for (const QList<PendingOp> &pending : std::as_const(m_pending[op])) {
+        for (const PendingOp &entry : pending)
+            Tracer::instance().asyncEnd(kOpNames[op], entry.traceId);
+    }
+    m_pending[op].clear();
+}
@@ -0,0 +1,64 @@
+#ifndef INGESTMETRICS_H
+#define INGESTMETRICS_H
+
+#include "metrics.h"
+
+#include <QBluetoothUuid>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+
+// Ingestion health metrics for the BLE side of the app: notification counts per characteristic,
+// advertisement and decode error counts, reconnects and GATT operation latencies.
+// Also registers process memory usage with the metrics registry.
+class IngestMetrics
+{
+public:
+    enum GattOp {
+        Connect,
+        DiscoverServices,
+        DiscoverDetails,
+        ReadCharacteristic,
+        WriteDescriptor,
+        GattOpCount
+    };
+
+    IngestMetrics();
+    ~IngestMetrics();
+
+    void notificationReceived(const QBluetoothUuid &characteristic) { notificationCounter(characteristic)->inc(); }
+    void advertReceived() { m_adverts->inc(); }
+    void decodeError() { m_decodeErrors->inc(); }
+    void connected(quint64 address);
+    void disconnected() { m_disconnects->inc(); }
+
+    // GATT operation latency, also traced as async spans when the Tracer is enabled. `key`
+    // distinguishes concurrent operations of the same kind (characteristic uuid hash); operations
+    // sharing a key complete in issue order since Qt queues GATT requests, so they are matched
+    // first in, first out, so every request issued must be started here and must end in
+    // opFinished() or opFailed(). Finishing an op that was never started is a no-op.
+    void opStarted(GattOp op, quint64 key = 0);
+    void opFinished(GattOp op, quint64 key = 0);
+    void opFailed(GattOp op, quint64 key = 0); // Drops the oldest pending start, not observed
+    void opAborted(GattOp op);
+
+private:
+    Counter *notificationCounter(const QBluetoothUuid &characteristic);
+
+    QHash<QBluetoothUuid, Counter *> m_notifications;
+    Counter *m_adverts;
+    Counter *m_decodeErrors;
+    Counter *m_connects;
+    Counter *m_reconnects;
+    Counter *m_disconnects;
+    Histogram *m_opLatency[GattOpCount];
+    struct PendingOp {
+        qint64 startUs;
+        quint64 traceId; // Tracer async span
+    };
+    QHash<quint64, QList<PendingOp>> m_pending[GattOpCount]; // key -> started ops, oldest first
+    QElapsedTimer m_clock;
+    quint64 m_lastAddress;
+};
+
+#endif // INGESTMETRICS_H
@@ -0,0 +1,144 @@
+#include "latestvaluetable.h"
+#include <QDebug>
+#include <QtEndian>
+#include <cerrno>
+#include <cstring>
+
+#if defined(Q_OS_UNIX) && !defined(Q_OS_ANDROID)
+#include "blescale_shm.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#define BLESCALE_HAVE_SHM 1
+#endif
+
+LatestValueTable::LatestValueTable()
+    : m_table(nullptr)
+{
+}
+
+LatestValueTable::~LatestValueTable()
+{
+    close();
+}
+
+bool LatestValueTable::open(const QString &name)
+{
+#ifdef BLESCALE_HAVE_SHM
+    close();
+    m_name = name.isEmpty() ? QString::fromLatin1(BLESCALE_SHM_DEFAULT_NAME) : name;
+    const QByteArray nativeName = m_name.toLocal8Bit();
+
+    int fd = shm_open(nativeName.constData(), O_CREAT | O_RDWR, 0644);
+    if (fd < 0) {
+        qWarning() << "Shared memory: shm_open failed for" << m_name << strerror(errno);
+        return false;
+    }
+    if (ftruncate(fd, sizeof(blescale_shm_table)) != 0) {
+        qWarning() << "Shared memory: ftruncate failed:" << strerror(errno);
+        ::close(fd);
+        return false;
+    }
+    void *map = mmap(nullptr, sizeof(blescale_shm_table), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        qWarning() << "Shared memory: mmap failed:" << strerror(errno);
+        return false;
+    }
+
+    m_table = static_cast<blescale_shm_table *>(map);
+
+    // Invalidate the header first so readers don't trust slots while they are being reset
+    __atomic_store_n(&m_table->header.magic, 0u, __ATOMIC_RELEASE);
+    for (blescale_shm_slot &slot : m_table->slots) {
+        blescale_shm_write_begin(&slot);
+        __atomic_store_n(&slot.in_use, 0u, __ATOMIC_RELAXED);
+        slot.update_count = 0;
+        std::memset(&slot.value, 0, sizeof(slot.value));
+        blescale_shm_write_end(&slot);
+    }
+    m_table->header.version = BLESCALE_SHM_VERSION;
+    m_table->header.slot_count = BLESCALE_SHM_SLOTS;
+    m_table->header.slot_size = sizeof(blescale_shm_slot);
+    m_table->header.writer_pid = quint64(getpid());
+    __atomic_store_n(&m_table->header.used_slots, 0u, __ATOMIC_RELAXED);
+    __atomic_store_n(&m_table->header.writer_active, 1u, __ATOMIC_RELAXED);
+    __atomic_store_n(&m_table->header.magic, BLESCALE_SHM_MAGIC, __ATOMIC_RELEASE);
+    m_slots.clear();
+
+    qDebug() << "Shared memory latest-value table at" << m_name;
+    return true;
+#else
+    Q_UNUSED(name);
+    return false;
+#endif
+}
+
+void LatestValueTable::close()
+{
+#ifdef BLESCALE_HAVE_SHM
+    if (!m_table)
+        return;
+    // Leave the segment in place so readers keep a valid mapping; just tell them we're gone
+    __atomic_store_n(&m_table->header.writer_active, 0u, __ATOMIC_RELEASE);
+    munmap(m_table, sizeof(blescale_shm_table));
+    m_table = nullptr;
+    m_slots.clear();
+#endif
+}
+
+int LatestValueTable::slotFor(quint64 device)
+{
+#ifdef BLESCALE_HAVE_SHM
+    auto it = m_slots.constFind(device);
+    if (it != m_slots.constEnd())
+        return it.value();
+
+    const int slot = m_slots.size();
+    if (slot >= BLESCALE_SHM_SLOTS) {
+        qWarning() << "Shared memory table full, dropping device" << Qt::hex << device;
+        return -1;
+    }
+    m_slots.insert(device, slot);
+    __atomic_store_n(&m_table->header.used_slots, quint32(slot + 1), __ATOMIC_RELEASE);
+    return slot;
+#else
+    Q_UNUSED(device);
+    return -1;
+#endif
+}
+
+void LatestValueTable::update(const Sample &sample)
+{
+#ifdef BLESCALE_HAVE_SHM
+    if (!m_table || !sample.isWeight())
+        return; // One slot per scale: other characteristics would overwrite its weight
+
+    const int index = slotFor(sample.device);
+    if (index < 0)
+        return;
+
+    blescale_shm_value value;
+    value.device = sample.device;
+    qToBigEndian<quint32>(sample.characteristic.data1, value.characteristic);
+    qToBigEndian<quint16>(sample.characteristic.data2, value.characteristic + 4);
+    qToBigEndian<quint16>(sample.characteristic.data3, value.characteristic + 6);
+    std::memcpy(value.characteristic + 8, sample.characteristic.data4, 8);
+    value.timestamp_us = sample.timestampUs;
+    value.mantissa = sample.mantissa;
+    value.exponent = sample.exponent;
+    value.flags = sample.flags;
+    value.unit = sample.unit;
+    value.sequence = sample.sequence;
+    value.reserved = 0;
+
+    blescale_shm_slot &slot = m_table->slots[index];
+    blescale_shm_write_begin(&slot);
+    std::memcpy(&slot.value, &value, sizeof(value));
+    slot.update_count++;
+    __atomic_store_n(&slot.in_use, 1u, __ATOMIC_RELAXED);
+    blescale_shm_write_end(&slot);
+#else
+    Q_UNUSED(sample);
+#endif
+}
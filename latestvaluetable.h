@@ -0,0 +1,37 @@
+#ifndef LATESTVALUETABLE_H
+#define LATESTVALUETABLE_H
+
+#include "sample.h"
+
+#include <QHash>
+#include <QString>
+
+struct blescale_shm_table;
+
+// Writer side of the shared-memory latest-value table (see blescale_shm.h).
+// One slot per scale holding its latest weight; samples of other characteristics are ignored.
+// update() is a seqlocked memcpy into mapped memory, no syscalls.
+// Only available on desktop Unix; open() returns false elsewhere.
+class LatestValueTable
+{
+public:
+    LatestValueTable();
+    ~LatestValueTable();
+
+    bool open(const QString &name = QString());
+    void close();
+    bool isOpen() const { return m_table != nullptr; }
+
+    void update(const Sample &sample);
+
+private:
+    int slotFor(quint64 device);
+
+    blescale_shm_table *m_table;
+    QHash<quint64, int> m_slots; // device -> slot index
+    QString m_name;
+
+    Q_DISABLE_COPY(LatestValueTable)
+};
+
+#endif // LATESTVALUETABLE_H
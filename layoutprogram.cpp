@@ -0,0 +1,276 @@
+#include "layoutprogram.h"
+#include "gattuuid.h"
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <limits>
+
+namespace {
+bool parseType(const QString &type, quint8 &width, bool &isSigned)
+{
+    static const QHash<QString, int> widths = {
+        {"u8", 1}, {"u16", 2}, {"u24", 3}, {"u32", 4}, {"s8", -1}, {"s16", -2}, {"s24", -3}, {"s32", -4},
+    };
+    const int signedWidth = widths.value(type, 0);
+    if (signedWidth == 0)
+        return false;
+    width = quint8(qAbs(signedWidth));
+    isSigned = signedWidth < 0;
+    return true;
+}
+
+bool parseUnit(const QJsonValue &value, quint16 &unit)
+{
+    if (value.isUndefined())
+        return true;
+    if (value.isDouble()) {
+        unit = quint16(value.toInt());
+        return true;
+    }
+    const QString name = value.toString().toLower();
+    if (name == QLatin1String("kg"))
+        unit = SigUnit::Kilogram;
+    else if (name == QLatin1String("lb"))
+        unit = SigUnit::Pound;
+    else if (name.startsWith(QLatin1String("0x")))
+        unit = quint16(name.mid(2).toUShort(nullptr, 16));
+    else
+        return false;
+    return true;
+}
+}
+
+bool LayoutProgram::compile(const QByteArray &json, LayoutProgram &program, QString &error)
+{
+    QJsonParseError parseError;
+    const QJsonDocument document = QJsonDocument::fromJson(json, &parseError);
+    if (!document.isObject()) {
+        error = QString("Invalid JSON: %1").arg(parseError.errorString());
+        return false;
+    }
+    const QJsonObject spec = document.object();
+
+    program = LayoutProgram();
+    program.m_name = spec.value("name").toString();
+    if (!GattUuid::parse(spec.value("characteristic").toString(), program.m_characteristic)) {
+        error = QStringLiteral("Missing or invalid \"characteristic\"");
+        return false;
+    }
+
+    int minLength = spec.value("minLength").toInt(0);
+    QList<Instruction> body;
+
+    if (spec.contains("checksum")) {
+        const QJsonObject checksum = spec.value("checksum").toObject();
+        Instruction instruction;
+        instruction.op = VerifyChecksum;
+        const QString type = checksum.value("type").toString("sum8");
+        if (type == QLatin1String("sum8"))
+            instruction.checksumType = Sum8;
+        else if (type == QLatin1String("xor8"))
+            instruction.checksumType = Xor8;
+        else {
+            error = QString("Unknown checksum type: %1").arg(type);
+            return false;
+        }
+        instruction.offset = checksum.value("at").toInt(-1);
+        instruction.from = checksum.value("from").toInt(0);
+        instruction.to = checksum.value("to").toInt(instruction.offset);
+        body.append(instruction);
+    }
+
+    QHash<QString, quint8> registers;
+    const QJsonArray fields = spec.value("fields").toArray();
+    for (const QJsonValue &fieldValue : fields) {
+        const QJsonObject field = fieldValue.toObject();
+        const QString name = field.value("name").toString();
+        if (name.isEmpty()) {
+            error = QStringLiteral("Every field needs a \"name\"");
+            return false;
+        }
+
+        Instruction load;
+        load.op = Load;
+        if (!parseType(field.value("type").toString(), load.width, load.isSigned)) {
+            error = QString("Field %1: unknown type %2").arg(name, field.value("type").toString());
+            return false;
+        }
+        load.offset = field.value("offset").toInt(-1);
+        if (load.offset < 0) {
+            error = QString("Field %1: missing \"offset\"").arg(name);
+            return false;
+        }
+        load.bigEndian = field.value("endian").toString() == QLatin1String("big");
+        load.shift = quint8(field.value("shift").toInt(0));
+        load.bits = quint8(field.value("bits").toInt(0));
+        if (load.shift + load.bits > load.width * 8) {
+            error = QString("Field %1: bit field outside the value").arg(name);
+            return false;
+        }
+        if (!registers.contains(name)) {
+            if (registers.size() == MaxRegisters) {
+                error = QString("More than %1 distinct field names").arg(int(MaxRegisters));
+                return false;
+            }
+            registers.insert(name, quint8(registers.size()));
+        }
+        load.reg = registers.value(name);
+
+        QList<Instruction> ops{load};
+        const QString role = field.value("role").toString();
+        if (role == QLatin1String("value")) {
+            Instruction output;
+            output.op = EmitValue;
+            output.reg = load.reg;
+            output.multiplier = field.value("multiplier").toInt(1);
+            output.exponent = qint8(field.value("exponent").toInt(0));
+            if (!parseUnit(field.value("unit"), output.unit)) {
+                error = QString("Field %1: unknown unit").arg(name);
+                return false;
+            }
+            ops.append(output);
+        } else if (role == QLatin1String("sequence")) {
+            Instruction output;
+            output.op = EmitSequence;
+            output.reg = load.reg;
+            ops.append(output);
+        } else if (!role.isEmpty()) {
+            error = QString("Field %1: unknown role %2").arg(name, role);
+            return false;
+        }
+
+        if (field.contains("when")) {
+            const QJsonObject when = field.value("when").toObject();
+            const QString condition = when.value("field").toString();
+            if (!registers.contains(condition) || condition == name) {
+                error = QString("Field %1: condition on %2, which is not an earlier field").arg(name, condition);
+                return false;
+            }
+            Instruction skip;
+            skip.op = SkipUnless;
+            skip.reg = registers.value(condition);
+            skip.mask = quint32(when.value("mask").toDouble(double(std::numeric_limits<quint32>::max())));
+            skip.equals = quint32(when.value("equals").toDouble(0));
+            skip.skip = ops.size();
+            body.append(skip);
+        } else {
+            minLength = qMax(minLength, load.offset + load.width); // Always present
+        }
+        body += ops;
+    }
+
+    if (body.isEmpty()) {
+        error = QStringLiteral("Layout has no fields");
+        return false;
+    }
+    Instruction require;
+    require.op = RequireLength;
+    require.offset = minLength;
+    program.m_code.append(require);
+    program.m_code += body;
+    return true;
+}
+
+QList<LayoutProgram> LayoutProgram::loadDirectory(const QString &path)
+{
+    QList<LayoutProgram> programs;
+    const QFileInfoList files = QDir(path).entryInfoList({QStringLiteral("*.json")}, QDir::Files, QDir::Name);
+    for (const QFileInfo &info : files) {
+        QFile file(info.filePath());
+        QString error;
+        LayoutProgram program;
+        if (!file.open(QIODevice::ReadOnly))
+            error = file.errorString();
+        else if (compile(file.readAll(), program, error)) {
+            if (program.m_name.isEmpty())
+                program.m_name = info.completeBaseName();
+            programs.append(program);
+            qDebug() << "Loaded layout" << program.m_name << "for" << program.m_characteristic.toString();
+            continue;
+        }
+        qWarning() << "Skipping layout" << info.filePath() << ":" << error;
+    }
+    return programs;
+}
+
+bool LayoutProgram::run(const QByteArray &payload, Sample &out) const
+{
+    const uchar *data = reinterpret_cast<const uchar *>(payload.constData());
+    const qint32 size = qint32(payload.size());
+    qint64 registers[MaxRegisters] = {};
+    bool emitted = false;
+
+    const Instruction *code = m_code.constData();
+    const qsizetype count = m_code.size();
+    for (qsizetype pc = 0; pc < count; ++pc) {
+        const Instruction &in = code[pc];
+        switch (in.op) {
+        case RequireLength:
+            if (size < in.offset)
+                return false;
+            break;
+        case VerifyChecksum: {
+            const qint32 at = in.offset < 0 ? size + in.offset : in.offset;
+            const qint32 from = in.from < 0 ? size + in.from : in.from;
+            const qint32 to = in.to < 0 ? size + in.to : in.to;
+            if (at < 0 || at >= size || from < 0 || to > size || from > to)
+                return false;
+            quint8 sum = 0;
+            for (qint32 i = from; i < to; ++i)
+                sum = in.checksumType == Xor8 ? quint8(sum ^ data[i]) : quint8(sum + data[i]);
+            if (sum != data[at])
+                return false;
+            break;
+        }
+        case Load: {
+            if (in.offset + in.width > size)
+                return false; // Conditional field missing from a short payload
+            quint64 raw = 0;
+            for (int i = 0; i < in.width; ++i) {
+                const int byte = in.bigEndian ? i : in.width - 1 - i;
+                raw = (raw << 8) | data[in.offset + byte];
+            }
+            int bits = in.width * 8;
+            if (in.bits) {
+                raw = (raw >> in.shift) & ((quint64(1) << in.bits) - 1);
+                bits = in.bits;
+            }
+            qint64 value = qint64(raw);
+            if (in.isSigned && bits < 64) {
+                const quint64 sign = quint64(1) << (bits - 1);
+                value = qint64((raw ^ sign) - sign);
+            }
+            registers[in.reg] = value;
+            break;
+        }
+        case SkipUnless:
+            if ((quint64(registers[in.reg]) & in.mask) != in.equals)
+                pc += in.skip;
+            break;
+        case EmitValue: {
+            const qint64 mantissa = registers[in.reg] * in.multiplier;
+            if (mantissa < std::numeric_limits<qint32>::min() || mantissa > std::numeric_limits<qint32>::max())
+                return false;
+            out.mantissa = qint32(mantissa);
+            out.exponent = in.exponent;
+            out.unit = in.unit;
+            out.flags |= Sample::HasValue;
+            if (in.unit == SigUnit::Pound)
+                out.flags |= Sample::Imperial;
+            emitted = true;
+            break;
+        }
+        case EmitSequence:
+            out.sequence = quint32(registers[in.reg]);
+            out.flags |= Sample::HasSequence;
+            emitted = true;
+            break;
+        }
+    }
+    return emitted;
+}
@@ -0,0 +1,76 @@
+#ifndef LAYOUTPROGRAM_H
+#define LAYOUTPROGRAM_H
+
+#include "sample.h"
+
+#include <QBluetoothUuid>
+#include <QByteArray>
+#include <QList>
+#include <QString>
+
+// Decoder for a vendor characteristic described in JSON instead of C++.
+//
+//   {
+//     "name": "Acme X100",
+//     "characteristic": "fff4",                      // 16-bit or full UUID
+//     "minLength": 7,
+//     "checksum": {"type": "sum8", "at": -1, "from": 0, "to": -1},  // sum8 or xor8; negative = from the end
+//     "fields": [
+//       {"name": "flags", "offset": 0, "type": "u8"},
+//       {"name": "stable", "offset": 0, "type": "u8", "shift": 7, "bits": 1},
+//       {"name": "kg", "offset": 1, "type": "u16", "endian": "big", "multiplier": 5, "exponent": -3,
+//        "unit": "kg", "role": "value", "when": {"field": "flags", "mask": 1, "equals": 0}},
+//       {"name": "lb", "offset": 1, "type": "u16", "endian": "big", "exponent": -2,
+//        "unit": "lb", "role": "value", "when": {"field": "flags", "mask": 1, "equals": 1}},
+//       {"name": "seq", "offset": 5, "type": "u8", "role": "sequence"}
+//     ]
+//   }
+//
+// Types are u8/s8 through u32/s32 (including 24 bit); endianness defaults to little. Fields
+// without a role only load a register for later "when" conditions. The spec is compiled once
+// into a flat list of fixed-size instructions over a small register file, and run() is a
+// single switch loop with no allocations or lookups by name.
+class LayoutProgram
+{
+public:
+    static bool compile(const QByteArray &json, LayoutProgram &program, QString &error);
+    static QList<LayoutProgram> loadDirectory(const QString &path); // *.json; bad files are logged and skipped
+
+    QString name() const { return m_name; }
+    QBluetoothUuid characteristic() const { return m_characteristic; }
+    bool isValid() const { return !m_code.isEmpty(); }
+
+    // False if the payload is too short, fails its checksum or yields neither value nor sequence
+    bool run(const QByteArray &payload, Sample &out) const;
+
+private:
+    enum OpCode : quint8 { RequireLength, VerifyChecksum, Load, SkipUnless, EmitValue, EmitSequence };
+    enum ChecksumType : quint8 { Sum8, Xor8 };
+    enum { MaxRegisters = 32 };
+
+    struct Instruction {
+        OpCode op = Load;
+        quint8 reg = 0;
+        quint8 width = 0;       // Load: bytes
+        bool bigEndian = false;
+        bool isSigned = false;
+        quint8 shift = 0;       // Load: bit field
+        quint8 bits = 0;        // Load: bit field width, 0 = whole value
+        quint8 checksumType = Sum8;
+        qint8 exponent = 0;
+        quint16 unit = 0;
+        qint32 offset = 0;      // Load/RequireLength: byte offset; VerifyChecksum: checksum byte
+        qint32 from = 0;        // VerifyChecksum: summed range [from, to); negative = from the end
+        qint32 to = 0;
+        qint32 multiplier = 1;
+        quint32 mask = 0;       // SkipUnless
+        quint32 equals = 0;
+        qint32 skip = 0;
+    };
+
+    QString m_name;
+    QBluetoothUuid m_characteristic;
+    QList<Instruction> m_code;
+};
+
+#endif // LAYOUTPROGRAM_H
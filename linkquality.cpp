@@ -0,0 +1,236 @@
+#include "linkquality.h"
+#include "characteristicstats.h"
+#include "metrics.h"
+#include <QBluetoothAddress>
+#include <QDebug>
+
+namespace {
+constexpr qint64 BaseIntervalMs = 2000;
+constexpr qint64 MinIntervalMs = 1000;  // Degraded link: watch closely
+constexpr qint64 MaxIntervalMs = 10000; // Stable link: stay out of the way
+constexpr qint64 ReadTimeoutMs = 5000;
+constexpr qint64 MinIdleWaitMs = 250;
+constexpr quint64 MinSamplesForCadence = 8;
+constexpr double RssiAlpha = 0.3;
+constexpr double RssiFloorDbm = -95.0; // Scores 0
+constexpr double RssiGoodDbm = -55.0;  // Scores 1
+constexpr int GoodScore = 80;
+constexpr int PoorScore = 50;
+}
+
+LinkQualityMonitor::LinkQualityMonitor(TimerService *timers, QObject *parent)
+    : QObject(parent)
+    , m_timers(timers)
+    , m_readTimer(0)
+    , m_idleFallback(0)
+    , m_readDue(false)
+    , m_readPending(false)
+    , m_goodStreak(0)
+    , m_haveRssi(false)
+    , m_rssiDbm(0.0)
+    , m_count(0)
+    , m_meanIntervalMs(0.0)
+    , m_jitterMs(0.0)
+    , m_missed(0)
+    , m_lastArrivalUs(0)
+    , m_score(-1)
+{
+    m_reads = MetricsRegistry::instance().counter("blescale_rssi_reads_total", "RSSI reads issued on the connected link.");
+    // Per-device series only while that device is connected, so they do not pile up per scale seen
+    MetricsRegistry::instance().addCollector(this, [this](QByteArray &out) {
+        if (m_deviceLabels.isEmpty())
+            return;
+        if (m_haveRssi) {
+            MetricsRegistry::appendMetric(out, "blescale_link_rssi_dbm", "gauge", "Smoothed RSSI of the connected scale.",
+                                          rssiDbm(), m_deviceLabels);
+        }
+        if (m_score >= 0) {
+            MetricsRegistry::appendMetric(out, "blescale_link_quality_score", "gauge",
+                                          "Link quality of the connected scale (0-100).", m_score, m_deviceLabels);
+        }
+    });
+}
+
+LinkQualityMonitor::~LinkQualityMonitor()
+{
+    MetricsRegistry::instance().removeCollectors(this);
+    m_timers->cancel(m_readTimer);
+    m_timers->cancel(m_idleFallback);
+}
+
+bool LinkQualityMonitor::rssiSupported()
+{
+#if QT_VERSION >= QT_VERSION_CHECK(6, 5, 0)
+    return true;
+#else
+    return false;
+#endif
+}
+
+void LinkQualityMonitor::start(QLowEnergyController *controller, quint64 address)
+{
+    stop();
+    m_controller = controller;
+
+    m_deviceLabels = "device=\"" + QBluetoothAddress(address).toString().toLatin1() + '"';
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 5, 0)
+    m_rssiConnection = connect(controller, &QLowEnergyController::rssiRead, this, &LinkQualityMonitor::rssiRead);
+    m_errorConnection = connect(controller, QOverload<QLowEnergyController::Error>::of(&QLowEnergyController::errorOccurred), this, &LinkQualityMonitor::controllerError);
+#endif
+    scheduleRead(BaseIntervalMs); // Let service discovery and subscription traffic settle first
+}
+
+void LinkQualityMonitor::stop()
+{
+    disconnect(m_rssiConnection);
+    disconnect(m_errorConnection);
+    m_timers->cancel(m_readTimer);
+    m_timers->cancel(m_idleFallback);
+    m_readTimer = m_idleFallback = 0;
+    m_controller = nullptr;
+    m_readDue = m_readPending = false;
+    m_goodStreak = 0;
+    m_haveRssi = false;
+    m_stream = QBluetoothUuid();
+    m_count = m_missed = 0;
+    m_meanIntervalMs = m_jitterMs = 0.0;
+    m_lastArrivalUs = 0;
+    m_deviceLabels.clear(); // Drops the device's series
+
+    if (m_score != -1) {
+        m_score = -1;
+        emit qualityChanged(m_score, 0);
+    }
+}
+
+void LinkQualityMonitor::notified(const QBluetoothUuid &characteristic, const CharacteristicStats &stats, qint64 arrivalUs)
+{
+    // Follow the busiest stream; that is the one the weight comes from
+    if (characteristic != m_stream && stats.count() <= m_count)
+        return;
+    m_stream = characteristic;
+    m_count = stats.count();
+    m_meanIntervalMs = stats.meanIntervalMs();
+    m_jitterMs = stats.jitterMs();
+    m_missed = stats.missedSequences();
+    m_lastArrivalUs = arrivalUs;
+
+    if (m_readDue)
+        issueRead(); // Right behind a notification, the link has the most headroom
+}
+
+void LinkQualityMonitor::scheduleRead(qint64 delayMs)
+{
+    m_timers->cancel(m_readTimer);
+    m_readTimer = m_timers->schedule(delayMs, [this]() { readDue(); });
+}
+
+void LinkQualityMonitor::readDue()
+{
+    m_readTimer = 0;
+    if (!m_controller)
+        return;
+
+    if (m_count < MinSamplesForCadence) {
+        issueRead(); // No known cadence to stay clear of
+        return;
+    }
+
+    // Wait for the next notification; if the stream has gone quiet there is nothing to compete with
+    m_readDue = true;
+    const qint64 idleMs = qMax<qint64>(MinIdleWaitMs, qint64(2 * m_meanIntervalMs + 4 * m_jitterMs));
+    m_idleFallback = m_timers->schedule(idleMs, [this]() {
+        m_idleFallback = 0;
+        issueRead();
+    });
+}
+
+void LinkQualityMonitor::issueRead()
+{
+    m_readDue = false;
+    m_timers->cancel(m_idleFallback);
+    m_idleFallback = 0;
+    if (!m_controller || m_readPending)
+        return;
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 5, 0)
+    const QLowEnergyController::ControllerState state = m_controller->state();
+    if (state == QLowEnergyController::ConnectedState || state == QLowEnergyController::DiscoveredState) {
+        m_readPending = true;
+        m_reads->inc();
+        m_controller->readRssi();
+        m_readTimer = m_timers->schedule(ReadTimeoutMs, [this]() {
+            m_readTimer = 0;
+            qWarning() << "RSSI read timed out";
+            m_readPending = false;
+            scheduleRead(nextIntervalMs());
+        });
+        return;
+    }
+#endif
+    // Without RSSI the score still tracks the notification stream
+    updateScore(CharacteristicStats::monotonicUs());
+    scheduleRead(nextIntervalMs());
+}
+
+void LinkQualityMonitor::rssiRead(qint16 rssi)
+{
+    if (!m_readPending)
+        return;
+    m_readPending = false;
+    m_rssiDbm = m_haveRssi ? m_rssiDbm + RssiAlpha * (rssi - m_rssiDbm) : rssi;
+    m_haveRssi = true;
+    updateScore(CharacteristicStats::monotonicUs());
+    scheduleRead(nextIntervalMs());
+}
+
+void LinkQualityMonitor::controllerError(QLowEnergyController::Error error)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(6, 5, 0)
+    if (error != QLowEnergyController::RssiReadError || !m_readPending)
+        return;
+    qWarning() << "RSSI read failed";
+    m_readPending = false;
+    updateScore(CharacteristicStats::monotonicUs());
+    scheduleRead(nextIntervalMs());
+#else
+    Q_UNUSED(error);
+#endif
+}
+
+void LinkQualityMonitor::updateScore(qint64 nowUs)
+{
+    double rssiScore = -1.0;
+    if (m_haveRssi)
+        rssiScore = qBound(0.0, (m_rssiDbm - RssiFloorDbm) / (RssiGoodDbm - RssiFloorDbm), 1.0);
+
+    double notifyScore = -1.0;
+    if (m_count >= MinSamplesForCadence && m_meanIntervalMs > 0.0) {
+        // Silence up to two intervals is normal; at ten the stream is as good as stalled
+        const double silentIntervals = (nowUs - m_lastArrivalUs) / 1000.0 / m_meanIntervalMs;
+        const double staleScore = qBound(0.0, 1.0 - (silentIntervals - 2.0) / 8.0, 1.0);
+        const double lossScore = 1.0 - qMin(1.0, 10.0 * m_missed / double(m_count + m_missed));
+        const double jitterScore = 1.0 - qMin(1.0, m_jitterMs / m_meanIntervalMs);
+        notifyScore = qMin(staleScore, lossScore) * (0.75 + 0.25 * jitterScore);
+    }
+
+    int score = -1;
+    if (rssiScore >= 0.0 && notifyScore >= 0.0)
+        score = qRound(100.0 * (0.4 * rssiScore + 0.6 * notifyScore));
+    else if (rssiScore >= 0.0)
+        score = qRound(100.0 * rssiScore);
+    else if (notifyScore >= 0.0)
+        score = qRound(100.0 * notifyScore);
+
+    m_goodStreak = score >= GoodScore ? m_goodStreak + 1 : 0;
+    m_score = score;
+    emit qualityChanged(m_score, rssiDbm());
+}
+
+qint64 LinkQualityMonitor::nextIntervalMs() const
+{
+    if (m_score >= 0 && m_score < PoorScore)
+        return MinIntervalMs;
+    return qMin(MaxIntervalMs, BaseIntervalMs << qMin(m_goodStreak, 3));
+}
@@ -0,0 +1,81 @@
+#ifndef LINKQUALITY_H
+#define LINKQUALITY_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QBluetoothUuid>
+#include <QLowEnergyController>
+#include <QPointer>
+
+#include "timingwheel.h"
+
+class CharacteristicStats;
+class Counter;
+
+// Tracks link quality of the connected scale.
+//
+// RSSI is sampled with QLowEnergyController::readRssi() (Qt 6.5+) and smoothed, then combined with
+// the notification stream's own health (staleness against its cadence, jitter, lost sequence
+// numbers) into a 0..100 score. Reads are paced so they never compete with weight notifications:
+// when a read falls due it is issued right after the next notification, in the quiet part of the
+// connection interval, or once the stream has been idle long enough that nothing is competing.
+// The read interval stretches while the link is good and tightens when it degrades.
+class LinkQualityMonitor : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit LinkQualityMonitor(TimerService *timers, QObject *parent = nullptr);
+    ~LinkQualityMonitor();
+
+    void start(QLowEnergyController *controller, quint64 address);
+    void stop();
+
+    // Called from the notification path after the characteristic's stats were updated
+    void notified(const QBluetoothUuid &characteristic, const CharacteristicStats &stats, qint64 arrivalUs);
+
+    bool hasRssi() const { return m_haveRssi; }
+    int rssiDbm() const { return qRound(m_rssiDbm); }
+    int score() const { return m_score; } // -1 until anything is known
+
+    static bool rssiSupported();
+
+signals:
+    void qualityChanged(int score, int rssiDbm);
+
+private:
+    void scheduleRead(qint64 delayMs);
+    void readDue();
+    void issueRead();
+    void rssiRead(qint16 rssi);
+    void controllerError(QLowEnergyController::Error error);
+    void updateScore(qint64 nowUs);
+    qint64 nextIntervalMs() const;
+
+    TimerService *m_timers;
+    QPointer<QLowEnergyController> m_controller;
+    QMetaObject::Connection m_rssiConnection;
+    QMetaObject::Connection m_errorConnection;
+    TimingWheel::TimerId m_readTimer;
+    TimingWheel::TimerId m_idleFallback;
+    bool m_readDue;
+    bool m_readPending;
+    int m_goodStreak; // Consecutive reads with a good score; stretches the interval
+
+    bool m_haveRssi;
+    double m_rssiDbm; // EWMA
+
+    // Snapshot of the busiest notification stream
+    QBluetoothUuid m_stream;
+    quint64 m_count;
+    double m_meanIntervalMs;
+    double m_jitterMs;
+    quint64 m_missed;
+    qint64 m_lastArrivalUs;
+
+    int m_score;
+    QByteArray m_deviceLabels; // Metric labels of the connected device; empty when stopped
+    Counter *m_reads;
+};
+
+#endif // LINKQUALITY_H
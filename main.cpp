@@ -1,11 +1,60 @@
 #include "mainwindow.h"
+#include "phasetimeline.h"
+#include "selftest.h"
+#include "stationconfig.h"
 
 #include <QApplication>
+#include <QDebug>
+#include <cstdio>
 
 int main(int argc, char *argv[])
 {
+    PhaseTimeline::instance().mark(PhaseTimeline::AppLaunched);
     QApplication a(argc, argv);
-    MainWindow w;
+
+    StationConfig config;
+    QString error;
+    if (!StationConfig::fromCommandLine(a, config, error)) {
+        qCritical().noquote() << error;
+        return 1;
+    }
+
+    // --self-test and --benchmark need neither Bluetooth nor the window
+    if (config.selfTest && !SelfTest::run())
+        return 3;
+    if (config.throughputBenchmark) {
+        std::fputs(SelfTest::benchmark().append('\n').constData(), stdout);
+        std::fflush(stdout);
+    }
+    if (config.selfTest || config.throughputBenchmark)
+        return 0;
+
+    MainWindow w(config);
+
+    // --startup-benchmark: print the startup phases as JSON and exit once scanning is possible,
+    // or exit 2 if Bluetooth cannot be started
+    if (config.startupBenchmark) {
+        QObject::connect(&w, &MainWindow::bluetoothReady, &a, [&a]() {
+            std::fputs(PhaseTimeline::instance().toJson().append('\n').constData(), stdout);
+            std::fflush(stdout);
+            a.quit();
+        });
+        QObject::connect(&w, &MainWindow::bluetoothUnavailable, &a, [&a](const QString &reason) {
+            qCritical().noquote() << "Startup benchmark failed:" << reason;
+            a.exit(2);
+        });
+    }
+
+    // --memory-check: exit once the run is over, 3 if memory grew past the threshold
+    if (config.memoryCheckMb > 0) {
+        QObject::connect(&w, &MainWindow::memoryCheckFinished, &a, [&a](bool passed) { a.exit(passed ? 0 : 3); });
+    }
+
+    // --soak: the same, after the last lifecycle cycle
+    if (config.soakCycles > 0) {
+        QObject::connect(&w, &MainWindow::soakFinished, &a, [&a](bool passed) { a.exit(passed ? 0 : 3); });
+    }
+
     w.show();
     return a.exec();
 }
@@ -4,24 +4,113 @@
 #include <QBluetoothPermission>
 #include <QLowEnergyDescriptor>
 #include <QApplication>
+#include <QDialog>
+#include <QBluetoothHostInfo>
+#include <QBluetoothLocalDevice>
+#include <QEvent>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSet>
+#include <QSignalBlocker>
+#include <QStandardPaths>
+#include <QLoggingCategory>
+#include <QThread>
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <memory_resource>
 #include <QComboBox> // Add this include for QComboBox
+#include <QCheckBox>
+#include "allocationcounter.h"
+#include "decoderplugin.h"
+#include "httpserver.h"
+#include "linkquality.h"
+#include "mqttpublisher.h"
+#include "metrics.h"
+#include "notificationwatchdog.h"
+#include "phasetimeline.h"
+#include "probes.h"
+#include "samplebus.h"
+#include "samplejson.h"
+#ifdef BLESCALE_SCRIPTING
+#include "scriptdecoder.h"
+#endif
+#include "soakharness.h"
+#include "streamserver.h"
+#include "syntheticstream.h"
+#include "tracer.h"
+
+Q_LOGGING_CATEGORY(lcNotifications, "blescale.notifications", QtInfoMsg) // Per-notification debug output, off by default
+
+namespace {
+const int kDecodeArenaBytes = 16 * 1024; // Stack arena for one decode batch's temporaries
+const int kValueRefreshMs = 100; // Raw value column repaint pace
+const qint64 kAutostartRetryMs = 5000; // Unattended stations retry scanning/connecting at this pace
+const qint64 kDeviceExpiryMs = 120000; // Discovered devices not re-seen for this long are dropped
+const qint64 kGattTimeoutMs = 10000; // Per discovery/read in coroutine workflows
 
-MainWindow::MainWindow(QWidget *parent)
+QString decodedText(const Sample &sample)
+{
+    if (sample.flags & Sample::Special)
+        return QString::fromLatin1(SampleJson::specialName(sample.mantissa));
+    QString text = QString::fromLatin1(SampleJson::formatDecimal(sample.mantissa, sample.exponent));
+    if (sample.unit == SigUnit::Kilogram)
+        text += " kg";
+    else if (sample.unit == SigUnit::Pound)
+        text += " lb";
+    else if (sample.unit != 0)
+        text += QString(" (unit 0x%1)").arg(sample.unit, 4, 16, QLatin1Char('0'));
+    return text;
+}
+}
+
+MainWindow::MainWindow(const StationConfig &config, QWidget *parent)
     : QMainWindow(parent)
     , ui(nullptr)
+    , discoveryAgent(nullptr)
     , leController(nullptr)
     , m_currentService(nullptr)
+    , m_scriptDecoder(nullptr)
+    , m_streamServer(nullptr)
+    , m_httpServer(nullptr)
+    , m_mqttPublisher(nullptr)
+    , m_sampleBus(nullptr)
+    , m_memoryCheck(nullptr)
+    , m_statsRefreshTimer(nullptr)
+    , m_valueRefreshTimer(nullptr)
+    , m_decodeScheduled(false)
+    , m_decodeBatches(0)
+    , m_decodeAllocations(0)
+    , m_watchdog(nullptr)
+    , m_reconnectAfterDisconnect(false)
+    , m_timers(nullptr)
+    , m_scanTraceId(0)
+    , m_linkQuality(nullptr)
+    , m_config(config)
+    , m_autostartDirect(false)
+    , m_autostartRetry(0)
+    , m_soak(nullptr)
 {
     // --- UI Setup ---
     // Change from QListWidget to QComboBox
     deviceComboBox = new QComboBox(this); // New: QComboBox for devices/services
-    characteristicListWidget = new QListWidget(this); // Remains a QListWidget
+    characteristicTreeWidget = new QTreeWidget(this); // Characteristics with value and arrival statistics columns
+    characteristicTreeWidget->setRootIsDecorated(false);
+    characteristicTreeWidget->setHeaderLabels({"Characteristic", "Properties", "Value", "Decoded", "Rate (Hz)",
+                                               "Jitter (ms)", "Longest Gap (ms)", "Seq Gaps"});
     scanButton = new QPushButton("Start Bluetooth Scan", this);
     connectButton = new QPushButton("Connect to Selected Device", this);
     connectButton->setEnabled(false);
+    fastConnectCheckBox = new QCheckBox("Fast connect", this);
+    fastConnectCheckBox->setChecked(m_config.fastConnect);
+    fastConnectCheckBox->setToolTip("Connect to the first scale advertising the Weight Scale service while the scan "
+                                    "continues, open only that service and subscribe before reading.");
     readCharButton = new QPushButton("Read Selected Characteristic", this);
     readCharButton->setEnabled(false);
+    memoryButton = new QPushButton("Memory Usage...", this);
     statusLabel = new QLabel("Status: Idle", this);
+    linkQualityLabel = new QLabel(this);
 
     // Create a main layout to hold two vertical sub-layouts (one for devices/services, one for characteristics)
     QHBoxLayout *mainHorizontalLayout = new QHBoxLayout();
@@ -30,12 +119,15 @@ MainWindow::MainWindow(QWidget *parent)
     QVBoxLayout *leftLayout = new QVBoxLayout();
     leftLayout->addWidget(scanButton);
     leftLayout->addWidget(connectButton);
+    leftLayout->addWidget(fastConnectCheckBox);
     leftLayout->addWidget(deviceComboBox); // Use deviceComboBox here
+    leftLayout->addStretch();
+    leftLayout->addWidget(memoryButton);
 
-    // Right side: Characteristic List and Read Button
+    // Right side: Characteristic Table and Read Button
     QVBoxLayout *rightLayout = new QVBoxLayout();
     rightLayout->addWidget(readCharButton);
-    rightLayout->addWidget(characteristicListWidget);
+    rightLayout->addWidget(characteristicTreeWidget);
 
     mainHorizontalLayout->addLayout(leftLayout);
     mainHorizontalLayout->addLayout(rightLayout);
@@ -43,21 +135,25 @@ MainWindow::MainWindow(QWidget *parent)
     // Main vertical layout for status label and the combined horizontal layout
     QVBoxLayout *mainLayout = new QVBoxLayout();
     mainLayout->addLayout(mainHorizontalLayout);
-    mainLayout->addWidget(statusLabel);
+    QHBoxLayout *statusLayout = new QHBoxLayout();
+    statusLayout->addWidget(statusLabel, 1);
+    statusLayout->addWidget(linkQualityLabel);
+    mainLayout->addLayout(statusLayout);
 
     QWidget *centralWidget = new QWidget(this);
     centralWidget->setLayout(mainLayout);
     setCentralWidget(centralWidget);
 
+    // One timing wheel for all per-device deadlines (discovery aging, stall watchdog, ...)
+    m_timers = new TimerService(10, this);
+
     // --- Bluetooth Scan Setup ---
-    discoveryAgent = new QBluetoothDeviceDiscoveryAgent(this);
+    // The discovery agent, adapter query and permission check are deferred until the window has
+    // painted once (see eventFilter() and initBluetooth()); scanning is enabled when they are done.
     connect(scanButton, &QPushButton::clicked, this, &MainWindow::startScan);
-    connect(discoveryAgent, &QBluetoothDeviceDiscoveryAgent::deviceDiscovered,
-            this, &MainWindow::deviceDiscovered);
-    connect(discoveryAgent, &QBluetoothDeviceDiscoveryAgent::finished,
-            this, &MainWindow::scanFinished);
-    connect(discoveryAgent, &QBluetoothDeviceDiscoveryAgent::errorOccurred,
-            this, &MainWindow::scanError);
+    scanButton->setEnabled(false);
+    statusLabel->setText("Status: Starting Bluetooth...");
+    centralWidget->installEventFilter(this);
 
     // --- Connect Button Logic ---
     // Change signal from itemSelectionChanged to currentIndexChanged
@@ -69,14 +165,14 @@ MainWindow::MainWindow(QWidget *parent)
                              !deviceComboBox->currentText().contains("--- Discovered Services ---"); // Exclude separator
         connectButton->setEnabled(enableConnect);
         readCharButton->setEnabled(false); // Disable read button until char is selected
-        characteristicListWidget->clear();
+        characteristicTreeWidget->clear();
 
         // If the selected item is a service (after service discovery is complete)
         // This logic needs to be adjusted slightly, as currentIndexChanged fires
         // when the combobox is populated, not necessarily when a service is selected *after* discovery.
         // It's better to trigger onServiceSelected only when connectToDevice is done and services are ready.
         // For now, keep the existing logic and we'll refine if issues arise.
-        if (leController && leController->state() == QLowEnergyController::DiscoveredState) {
+        if (servicesReady()) {
             onServiceSelected(); // This will now be called when a service is selected from the combobox
         }
     });
@@ -84,15 +180,16 @@ MainWindow::MainWindow(QWidget *parent)
 
     // --- New: Read Characteristic Button Logic (remains same) ---
     connect(readCharButton, &QPushButton::clicked, this, [this]() {
-        if (characteristicListWidget->selectedItems().isEmpty()) {
+        if (characteristicTreeWidget->selectedItems().isEmpty()) {
             QMessageBox::warning(this, "No Characteristic Selected", "Please select a characteristic to read.");
             return;
         }
-        QListWidgetItem *selectedItem = characteristicListWidget->currentItem();
+        QTreeWidgetItem *selectedItem = characteristicTreeWidget->currentItem();
         for (auto it = std::as_const(m_characteristicItems).begin(); it != std::as_const(m_characteristicItems).end(); ++it) {
             if (it.value() == selectedItem) {
                 if (it.key().properties() & QLowEnergyCharacteristic::Read) {
                     if (m_currentService) {
+                        m_ingestMetrics.opStarted(IngestMetrics::ReadCharacteristic, qHash(it.key().uuid()));
                         m_currentService->readCharacteristic(it.key());
                         statusLabel->setText(QString("Status: Reading characteristic %1").arg(it.key().uuid().toString()));
                     } else {
@@ -107,39 +204,228 @@ MainWindow::MainWindow(QWidget *parent)
     });
 
     // Enable read button only when a characteristic item is selected
-    connect(characteristicListWidget, &QListWidget::itemSelectionChanged, this, [this]() {
-        readCharButton->setEnabled(characteristicListWidget->selectedItems().count() > 0);
+    connect(characteristicTreeWidget, &QTreeWidget::itemSelectionChanged, this, [this]() {
+        readCharButton->setEnabled(characteristicTreeWidget->selectedItems().count() > 0);
+    });
+
+    // --- Sample Streaming ---
+    // Test modes on the manual clock must not reach the plant or a station running alongside: no
+    // broker and no shared table, and the local servers on private endpoints. Their in-process
+    // batching still runs and is still accounted.
+    if (simulated()) {
+        m_config.mqttEnabled = false;
+        m_config.shmEnabled = false;
+        m_config.streamTcpPort = 0; // Local socket only
+        if (!m_config.streamLocalName.isEmpty())
+            m_config.streamLocalName = QString("blescale-stream-test-%1").arg(QCoreApplication::applicationPid());
+        m_config.httpPort = 0; // Any free port
+        PhaseTimeline::instance().setEnabled(false); // No radio: see PhaseTimeline
+    }
+    // Disabled sinks are still created but never listen/start, and only enabled ones subscribe to the sample bus
+    m_streamServer = new StreamServer(this);
+    if (m_config.streamEnabled)
+        m_streamServer->listen(m_config.streamTcpPort, m_config.streamLocalName);
+    if (m_config.shmEnabled)
+        m_latestTable.open(m_config.shmName);
+    m_httpServer = new HttpServer(this);
+    if (m_config.httpEnabled)
+        m_httpServer->listen(m_config.httpPort);
+    m_mqttPublisher = new MqttPublisher(this);
+    m_mqttPublisher->setSettings(m_config.mqtt);
+    if (m_config.mqttEnabled)
+        m_mqttPublisher->start();
+
+    // --- Sample Bus ---
+    // Each consumer subscribes with its own rate; the sinks batch and bound their own output,
+    // the characteristic table only needs the newest value a few times a second
+    m_sampleBus = new SampleBus(m_timers, this);
+    if (m_config.shmEnabled)
+        m_sampleBus->subscribe("shm", {}, [this](const SampleRef &ref) { m_latestTable.update(ref.sample()); });
+    if (m_config.streamEnabled)
+        m_sampleBus->subscribe("stream", {}, [this](const SampleRef &ref) { m_streamServer->publish(ref.sample()); });
+    if (m_config.httpEnabled)
+        m_sampleBus->subscribe("http", {}, [this](const SampleRef &ref) { m_httpServer->publish(ref.sample()); });
+    if (m_config.mqttEnabled)
+        m_sampleBus->subscribe("mqtt", {}, [this](const SampleRef &ref) { m_mqttPublisher->publish(ref.sample()); });
+    SampleBus::Options uiOptions;
+    uiOptions.rate = SampleBus::LatestOnly;
+    uiOptions.maxHz = 10.0;
+    m_sampleBus->subscribe("ui", uiOptions, [this](const SampleRef &ref) {
+        if (QTreeWidgetItem *item = characteristicItem(ref.sample().characteristic))
+            item->setText(DecodedColumn, decodedText(ref.sample()));
+    });
+    setupMetrics();
+
+    // --- Notification Stall Watchdog ---
+    m_watchdog = new NotificationWatchdog(m_timers, this);
+    connect(m_watchdog, &NotificationWatchdog::escalationRequested, this, &MainWindow::recoverStalledConnection);
+    connect(m_watchdog, &NotificationWatchdog::descriptorWriteStarted, this, [this]() {
+        m_ingestMetrics.opStarted(IngestMetrics::WriteDescriptor);
+    });
+    connect(m_watchdog, &NotificationWatchdog::recovered, this, [this](const QBluetoothUuid &uuid, double recoveryMs) {
+        statusLabel->setText(QString("Status: Notifications recovered for %1 after %2 ms").arg(uuid.toString()).arg(recoveryMs, 0, 'f', 0));
     });
 
-    // --- Android Permissions (remains same) ---
+    // --- Link Quality ---
+    m_linkQuality = new LinkQualityMonitor(m_timers, this);
+    connect(m_linkQuality, &LinkQualityMonitor::qualityChanged, this, &MainWindow::showLinkQuality);
+    showLinkQuality(-1, 0);
+
+    m_statsRefreshTimer = new QTimer(this);
+    connect(m_statsRefreshTimer, &QTimer::timeout, this, &MainWindow::refreshCharacteristicStats);
+    m_statsRefreshTimer->start(1000);
+    m_valueRefreshTimer = new QTimer(this);
+    m_valueRefreshTimer->setSingleShot(true);
+    m_valueRefreshTimer->setInterval(kValueRefreshMs);
+    connect(m_valueRefreshTimer, &QTimer::timeout, this, &MainWindow::refreshCharacteristicValues);
+    m_pendingNotifications.reserve(64);
+
+    // --- Known Devices ---
+    // One small read; the combo box lists remembered scales before Bluetooth is even up
+    m_registry.load();
+    for (const StationConfig::DeviceProfile &profile : std::as_const(m_config.devices))
+        m_registry.setProfile(profile.address.toUInt64(), profile.alias, profile.decoder, profile.subscriptions);
+    showKnownDevices();
+    setupCalibration();
+
+    // --- Vendor Decoders ---
+    m_decoderPlugins.loadDirectory(m_config.pluginDir.isEmpty()
+        ? QCoreApplication::applicationDirPath() + QStringLiteral("/decoders")
+        : m_config.pluginDir);
+    MetricsRegistry::instance().addCollector(this, [this](QByteArray &out) { m_decoderPlugins.appendMetrics(out); });
+    m_layouts = LayoutProgram::loadDirectory(m_config.layoutDir.isEmpty()
+        ? QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + QStringLiteral("/layouts")
+        : m_config.layoutDir);
+#ifdef BLESCALE_SCRIPTING
+    m_scriptDecoder = new ScriptDecoder(this);
+    connect(m_scriptDecoder, &ScriptDecoder::decoded, this, &MainWindow::scriptDecoded);
+    m_scriptDecoder->loadDirectory(m_config.scriptDir.isEmpty()
+        ? QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + QStringLiteral("/scripts")
+        : m_config.scriptDir);
+    MetricsRegistry::instance().addCollector(this, [this](QByteArray &out) {
+        MetricsRegistry::appendMetric(out, "blescale_script_timeouts_total", "counter",
+                                      "Decoder script calls interrupted for exceeding the time budget.", m_scriptDecoder->timeouts());
+        MetricsRegistry::appendMetric(out, "blescale_script_errors_total", "counter",
+                                      "Decoder scripts that failed to compile or threw.", m_scriptDecoder->errors());
+        MetricsRegistry::appendMetric(out, "blescale_script_dropped_total", "counter",
+                                      "Payloads dropped while the script worker was behind.", m_scriptDecoder->dropped());
+    });
+#endif
+
+    setupMemoryAccounting();
+
+    // --soak: as soon as the event loop runs; Bluetooth is not initialised in this mode
+    if (m_config.soakCycles > 0) {
+        m_soak = new SoakHarness(this, m_config.soakCycles, qint64(m_config.soakThresholdMb * 1024 * 1024), this);
+        connect(m_soak, &SoakHarness::finished, this, [this](bool passed) { emit soakFinished(passed); });
+        QTimer::singleShot(0, m_soak, &SoakHarness::start);
+    }
+}
+
+// --- Deferred Bluetooth Startup ---
+bool MainWindow::eventFilter(QObject *watched, QEvent *event)
+{
+    if (event->type() == QEvent::Paint && watched == centralWidget()) {
+        centralWidget()->removeEventFilter(this);
+        PhaseTimeline::instance().mark(PhaseTimeline::FirstPaint);
+        if (!simulated()) // Test modes on the manual clock keep the adapter out of the run
+            QTimer::singleShot(0, this, &MainWindow::initBluetooth); // After this paint has been flushed
+    }
+    return QMainWindow::eventFilter(watched, event);
+}
+
+void MainWindow::initBluetooth()
+{
 #if QT_CONFIG(permissions) && defined(Q_OS_ANDROID)
     QBluetoothPermission bluetoothPermission;
     bluetoothPermission.setCommunicationModes(QBluetoothPermission::Access);
 
     switch (qApp->checkPermission(bluetoothPermission)) {
     case Qt::PermissionStatus::Undetermined:
-        qApp->requestPermission(bluetoothPermission, [this, bluetoothPermission]() {
-            if (qApp->checkPermission(bluetoothPermission) == Qt::PermissionStatus::Granted) {
+        qApp->requestPermission(bluetoothPermission, this, [this](const QPermission &permission) {
+            if (permission.status() == Qt::PermissionStatus::Granted) {
                 qDebug() << "Bluetooth permission granted after request.";
+                initBluetooth();
             } else {
                 qWarning() << "Bluetooth permission denied.";
-                QMessageBox::warning(this, "Permission Denied", "Bluetooth access is required for this app.");
+                statusLabel->setText("Status: Bluetooth permission denied.");
+                emit bluetoothUnavailable("Bluetooth permission denied");
+                if (!unattended())
+                    QMessageBox::warning(this, "Permission Denied", "Bluetooth access is required for this app.");
             }
         });
-        break;
+        return;
     case Qt::PermissionStatus::Denied:
         qWarning() << "Bluetooth permission denied.";
-        QMessageBox::warning(this, "Permission Denied", "Bluetooth access is required for this app. Please grant it in system settings.");
-        break;
+        statusLabel->setText("Status: Bluetooth permission denied.");
+        emit bluetoothUnavailable("Bluetooth permission denied");
+        if (!unattended())
+            QMessageBox::warning(this, "Permission Denied", "Bluetooth access is required for this app. Please grant it in system settings.");
+        return;
     case Qt::PermissionStatus::Granted:
         qDebug() << "Bluetooth permission already granted.";
         break;
     }
 #endif
+
+    // Adapter enumeration is a blocking round trip to the Bluetooth daemon on most platforms;
+    // do it on a worker thread and finish setting up on the GUI thread.
+    struct AdapterProbe {
+        QList<QBluetoothHostInfo> adapters;
+        bool poweredOff = false;
+    };
+    auto probe = std::make_shared<AdapterProbe>();
+    QThread *thread = QThread::create([probe]() {
+        probe->adapters = QBluetoothLocalDevice::allDevices();
+        if (!probe->adapters.isEmpty()) {
+            QBluetoothLocalDevice adapter(probe->adapters.first().address());
+            probe->poweredOff = adapter.hostMode() == QBluetoothLocalDevice::HostPoweredOff;
+        }
+    });
+    connect(thread, &QThread::finished, thread, &QObject::deleteLater);
+    connect(thread, &QThread::finished, this, [this, probe]() { finishBluetoothInit(probe->adapters, probe->poweredOff); });
+    thread->start();
+}
+
+void MainWindow::finishBluetoothInit(const QList<QBluetoothHostInfo> &adapters, bool poweredOff)
+{
+    if (adapters.isEmpty()) {
+        qDebug() << "No local Bluetooth adapter reported; using the platform default.";
+        discoveryAgent = new QBluetoothDeviceDiscoveryAgent(this);
+    } else {
+        qDebug() << "Using Bluetooth adapter" << adapters.first().name() << adapters.first().address().toString();
+        discoveryAgent = new QBluetoothDeviceDiscoveryAgent(adapters.first().address(), this);
+    }
+    connect(discoveryAgent, &QBluetoothDeviceDiscoveryAgent::deviceDiscovered,
+            this, &MainWindow::deviceDiscovered);
+    connect(discoveryAgent, &QBluetoothDeviceDiscoveryAgent::finished,
+            this, &MainWindow::scanFinished);
+    connect(discoveryAgent, &QBluetoothDeviceDiscoveryAgent::errorOccurred,
+            this, &MainWindow::scanError);
+    connect(discoveryAgent, &QBluetoothDeviceDiscoveryAgent::deviceUpdated,
+            this, [this](const QBluetoothDeviceInfo &device, QBluetoothDeviceInfo::Fields) {
+        m_ingestMetrics.advertReceived();
+        auto it = m_discoveredDevices.constFind(device.address().toUInt64());
+        if (it != m_discoveredDevices.constEnd()) {
+            m_timers->reschedule(it->expiry, kDeviceExpiryMs); // Still advertising
+            m_httpServer->updateDevice(device);
+        }
+    });
+
+    scanButton->setEnabled(true);
+    statusLabel->setText(poweredOff ? "Status: Bluetooth is powered off." : "Status: Idle");
+    PhaseTimeline::instance().mark(PhaseTimeline::BluetoothReady);
+    emit bluetoothReady();
+
+    if (m_config.autostart && !poweredOff)
+        startAutostart();
 }
 
 MainWindow::~MainWindow()
 {
+    MetricsRegistry::instance().removeCollectors(this);
+    cancelGattWorkflows(); // Their coroutines resume later and must find the token cancelled
+
     // Clean up QLowEnergyService objects
     for (QLowEnergyService *service : std::as_const(m_services)) {
         if (service) {
@@ -148,6 +434,7 @@ MainWindow::~MainWindow()
                 if (characteristic.properties() & (QLowEnergyCharacteristic::Notify | QLowEnergyCharacteristic::Indicate)) {
                     QLowEnergyDescriptor notificationDescriptor = characteristic.descriptor(QBluetoothUuid::DescriptorType::ClientCharacteristicConfiguration);
                     if (notificationDescriptor.isValid()) {
+                        m_ingestMetrics.opStarted(IngestMetrics::WriteDescriptor);
                         service->writeDescriptor(notificationDescriptor, QByteArray(2, 0)); // Turn off notifications
                     }
                 }
@@ -165,43 +452,101 @@ MainWindow::~MainWindow()
 
 // --- Bluetooth Scan Slots ---
 void MainWindow::startScan()
+{
+    if (!discoveryAgent)
+        return; // Bluetooth still starting up
+    qDebug() << "Starting Bluetooth device scan...";
+    resetScanState();
+
+    PhaseTimeline::instance().mark(PhaseTimeline::ScanStarted);
+    Tracer::instance().asyncEnd("scan", m_scanTraceId); // Restarted before it finished
+    m_scanTraceId = Tracer::instance().asyncBegin("scan");
+    discoveryAgent->start(QBluetoothDeviceDiscoveryAgent::DiscoveryMethod::LowEnergyMethod);
+}
+
+// Drops the connection and everything learnt from the previous scan
+void MainWindow::resetScanState()
 {
     deviceComboBox->clear(); // Change: Clear the QComboBox
-    characteristicListWidget->clear();
+    showKnownDevices(); // Re-labelled as they are seen advertising
+    characteristicTreeWidget->clear();
     statusLabel->setText("Status: Scanning...");
-    qDebug() << "Starting Bluetooth device scan...";
     scanButton->setEnabled(false);
     connectButton->setEnabled(false);
     readCharButton->setEnabled(false);
-    m_serviceUuids.clear();
-    m_services.clear();
-    m_characteristicItems.clear();
-    m_currentService = nullptr;
+    m_watchdog->clear();
+    m_linkQuality->stop();
+    cancelGattWorkflows();
+    releaseServices();
+    m_httpServer->clearDevices();
+    m_httpServer->setConnectedDevice(QBluetoothDeviceInfo());
+    for (const DiscoveredDevice &entry : std::as_const(m_discoveredDevices))
+        m_timers->cancel(entry.expiry);
+    m_discoveredDevices.clear();
 
     if (leController) {
         leController->disconnectFromDevice();
         leController->deleteLater();
         leController = nullptr;
     }
-
-    discoveryAgent->start(QBluetoothDeviceDiscoveryAgent::DiscoveryMethod::LowEnergyMethod);
 }
 
 
 
 void MainWindow::deviceDiscovered(const QBluetoothDeviceInfo &device)
 {
+    m_ingestMetrics.advertReceived();
+    Tracer::instance().instant("deviceDiscovered", device.address().toUInt64());
     if (device.coreConfigurations() & QBluetoothDeviceInfo::LowEnergyCoreConfiguration) {
-        QString itemText = device.name().isEmpty() ? "(Unknown BLE Device)" : device.name();
+        PhaseTimeline::instance().mark(PhaseTimeline::FirstDeviceDiscovered);
+        if (leController)
+            return; // Scan still running while connected; the combo box lists services now
+
+        const quint64 address = device.address().toUInt64();
+        const DeviceRegistry::Entry *known = m_registry.find(address);
+        QString itemText = known && !known->alias.isEmpty() ? known->alias
+                           : device.name().isEmpty() ? "(Unknown BLE Device)" : device.name();
         itemText += " (" + device.address().toString() + ")";
-        deviceComboBox->addItem(itemText); // Change: Add item to QComboBox
+        const int index = deviceComboIndex(address);
+        if (index >= 0)
+            deviceComboBox->setItemText(index, itemText); // Known device now seen advertising
+        else
+            deviceComboBox->addItem(itemText); // Change: Add item to QComboBox
+        m_httpServer->updateDevice(device);
+        // Remember scales only, not every phone and beacon in range
+        if (known || device.serviceUuids().contains(QBluetoothUuid(QBluetoothUuid::ServiceClassUuid::WeightScale)))
+            m_registry.noteSeen(device);
+        DiscoveredDevice &entry = m_discoveredDevices[address];
+        m_timers->cancel(entry.expiry);
+        entry.itemText = itemText;
+        entry.expiry = m_timers->schedule(kDeviceExpiryMs, [this, address]() { expireDevice(address); });
         qDebug() << "Discovered BLE device:" << itemText;
+
+        // Autostart takes the first configured match; fast connect the first advertised weight scale.
+        // Either way the scan keeps running while the connection is set up.
+        bool autoConnect = false;
+        if (m_config.autostart && m_config.hasTargetFilter())
+            autoConnect = m_config.matches(device);
+        else if (fastConnectCheckBox->isChecked())
+            autoConnect = device.serviceUuids().contains(QBluetoothUuid(QBluetoothUuid::ServiceClassUuid::WeightScale));
+        if (autoConnect) {
+            qDebug() << "Auto-connecting to" << itemText << "while the scan continues";
+            m_resumeServiceUuid = QBluetoothUuid();
+            connectToDeviceInfo(device);
+        }
     }
 }
 
 void MainWindow::scanFinished()
 {
     qDebug() << "Bluetooth scan finished.";
+    Tracer::instance().asyncEnd("scan", m_scanTraceId);
+    m_scanTraceId = 0;
+    PhaseTimeline::instance().mark(PhaseTimeline::ScanFinished);
+    if (leController)
+        return; // Connected during the scan; the connection owns the buttons and combo box
+    if (m_config.autostart)
+        scheduleAutostartRetry(); // No matching scale seen this time
     statusLabel->setText("Status: Scan Finished.");
     scanButton->setEnabled(true);
     if (deviceComboBox->count() == 0) { // Change: Check QComboBox count
@@ -215,6 +560,8 @@ void MainWindow::scanFinished()
 void MainWindow::scanError(QBluetoothDeviceDiscoveryAgent::Error error)
 {
     qWarning() << "Bluetooth scan error:" << error;
+    Tracer::instance().asyncEnd("scan", m_scanTraceId);
+    m_scanTraceId = 0;
     statusLabel->setText("Status: Scan Error!");
     scanButton->setEnabled(true);
     connectButton->setEnabled(false);
@@ -234,7 +581,12 @@ void MainWindow::scanError(QBluetoothDeviceDiscoveryAgent::Error error)
         errorString = "Unknown error.";
         break;
     }
-    QMessageBox::critical(this, "Bluetooth Error", errorString);
+    if (m_config.autostart) {
+        scheduleAutostartRetry(); // Nobody is there to dismiss a dialog
+        return;
+    }
+    if (!unattended())
+        QMessageBox::critical(this, "Bluetooth Error", errorString);
 }
 
 // --- BLE Connection Slots ---
@@ -242,29 +594,37 @@ void MainWindow::deviceDisconnected()
 {
     qDebug() << "Disconnected from BLE device.";
     statusLabel->setText("Status: Disconnected.");
+    m_httpServer->setConnectedDevice(QBluetoothDeviceInfo());
+    m_ingestMetrics.disconnected();
+    m_watchdog->clear();
+    m_linkQuality->stop();
     connectButton->setEnabled(true);
     scanButton->setEnabled(true);
     readCharButton->setEnabled(false);
+    cancelGattWorkflows();
 
     if (leController) {
         leController->deleteLater();
         leController = nullptr;
     }
-    for (QLowEnergyService *service : std::as_const(m_services)) {
-        if (service) service->deleteLater();
-    }
-    m_services.clear();
-    m_serviceUuids.clear();
-    m_characteristicItems.clear();
-    m_currentService = nullptr;
+    releaseServices();
     deviceComboBox->clear(); // Change: Clear the QComboBox
-    characteristicListWidget->clear();
+    showKnownDevices();
+    characteristicTreeWidget->clear();
+
+    if (m_reconnectAfterDisconnect) {
+        // Watchdog escalation: the old controller is already scheduled for deletion
+        QTimer::singleShot(0, this, [this]() { connectToDeviceInfo(m_currentDevice); });
+    } else if (m_config.autostart) {
+        scheduleAutostartRetry();
+    }
 }
 
 
 void MainWindow::controllerStateChanged(QLowEnergyController::ControllerState state)
 {
     qDebug() << "BLE Controller State Changed:" << state;
+    BLESCALE_PROBE2(conn_state, m_currentDevice.address().toUInt64(), int(state));
     switch (state) {
     case QLowEnergyController::UnconnectedState:
         statusLabel->setText("Status: Unconnected.");
@@ -294,6 +654,14 @@ void MainWindow::deviceConnected()
 {
     qDebug() << "Connected to BLE device.";
     statusLabel->setText("Status: Connected! Discovering services...");
+    m_httpServer->setConnectedDevice(m_currentDevice);
+    m_ingestMetrics.opFinished(IngestMetrics::Connect);
+    PhaseTimeline::instance().mark(PhaseTimeline::Connected);
+    m_autostartDirect = false;
+    m_registry.noteSeen(m_currentDevice);
+    m_ingestMetrics.connected(m_currentDevice.address().toUInt64());
+    m_linkQuality->start(leController, m_currentDevice.address().toUInt64());
+    m_ingestMetrics.opStarted(IngestMetrics::DiscoverServices);
     leController->discoverServices(); // Start discovering services
 }
 
@@ -306,6 +674,9 @@ void MainWindow::connectToDevice()
         return;
     }
 
+    if (!discoveryAgent)
+        return; // Bluetooth still starting up
+
     QString selectedText = deviceComboBox->currentText(); // Change: Get current text from QComboBox
     QBluetoothAddress deviceAddress(selectedText.section('(', -1).remove(')'));
 
@@ -317,29 +688,47 @@ void MainWindow::connectToDevice()
             break;
         }
     }
+    if (!m_currentDevice.isValid()) {
+        // Not seen in this scan (or no scan yet): connect from the remembered device info
+        if (const DeviceRegistry::Entry *known = m_registry.find(deviceAddress.toUInt64()))
+            m_currentDevice = known->toDeviceInfo();
+    }
 
     if (!m_currentDevice.isValid()) {
         QMessageBox::critical(this, "Error", "Could not find selected device information.");
         return;
     }
 
+    m_resumeServiceUuid = QBluetoothUuid(); // Manual connect, nothing to resume
+    m_autostartDirect = false;
+    connectToDeviceInfo(m_currentDevice);
+}
+
+void MainWindow::connectToDeviceInfo(const QBluetoothDeviceInfo &device)
+{
+    m_currentDevice = device;
+    m_reconnectAfterDisconnect = false;
+    m_watchdog->clear();
+    m_linkQuality->stop();
+    cancelGattWorkflows();
+
     if (leController) {
         leController->disconnectFromDevice();
         leController->deleteLater();
         leController = nullptr;
     }
-    for (QLowEnergyService *service : std::as_const(m_services)) {
-        if (service) service->deleteLater();
-    }
-    m_services.clear();
-    m_serviceUuids.clear();
-    m_characteristicItems.clear();
-    m_currentService = nullptr;
-    characteristicListWidget->clear();
+    releaseServices();
+    m_characteristicStats.clear();
+    m_pendingValues.clear();
+    m_pendingNotifications.clear(); // From the previous device
+    m_decoder.clearPlans(); // Formats are per device
+    selectDecoders();
+    characteristicTreeWidget->clear();
 
     leController = QLowEnergyController::createCentral(m_currentDevice, this);
     if (!leController) {
-        QMessageBox::critical(this, "Error", "Failed to create BLE controller.");
+        if (!unattended())
+            QMessageBox::critical(this, "Error", "Failed to create BLE controller.");
         statusLabel->setText("Status: Controller creation failed.");
         return;
     }
@@ -359,6 +748,8 @@ void MainWindow::connectToDevice()
 
     statusLabel->setText(QString("Status: Connecting to %1...").arg(m_currentDevice.name()));
     qDebug() << "Attempting to connect to BLE device:" << m_currentDevice.name() << m_currentDevice.address().toString();
+    m_ingestMetrics.opStarted(IngestMetrics::Connect);
+    PhaseTimeline::instance().mark(PhaseTimeline::ConnectRequested);
     leController->connectToDevice();
     connectButton->setEnabled(false);
     scanButton->setEnabled(false);
@@ -374,6 +765,8 @@ void MainWindow::serviceDiscovered(const QBluetoothUuid &uuid)
 void MainWindow::serviceDiscoveryFinished()
 {
     qDebug() << "Service discovery finished. Found" << m_serviceUuids.count() << "services.";
+    m_ingestMetrics.opFinished(IngestMetrics::DiscoverServices);
+    PhaseTimeline::instance().mark(PhaseTimeline::ServicesDiscovered);
     statusLabel->setText("Status: Services Discovered. Select a service.");
 
     deviceComboBox->clear(); // Change: Clear the QComboBox
@@ -392,11 +785,38 @@ void MainWindow::serviceDiscoveryFinished()
     }
     connectButton->setEnabled(false);
     scanButton->setEnabled(true);
+
+    // Autostart and fast connect open the preferred service straight away instead of waiting for a
+    // selection (the Weight Scale service unless configured otherwise)
+    if (m_resumeServiceUuid.isNull() && (m_config.autostart || fastConnectCheckBox->isChecked())) {
+        for (const QBluetoothUuid &uuid : std::as_const(m_config.services)) {
+            if (m_serviceUuids.contains(uuid)) {
+                m_resumeServiceUuid = uuid;
+                break;
+            }
+        }
+    }
+
+    // After a watchdog reconnect, reopen the service that was in use
+    if (!m_resumeServiceUuid.isNull()) {
+        const int index = deviceComboBox->findText(m_resumeServiceUuid.toString());
+        const QBluetoothUuid uuid = m_resumeServiceUuid;
+        m_resumeServiceUuid = QBluetoothUuid();
+        if (index >= 0) {
+            const QSignalBlocker blocker(deviceComboBox); // Shown as selected; opened below, not by onServiceSelected()
+            deviceComboBox->setCurrentIndex(index);
+            openServices({uuid});
+        }
+    }
 }
 
 
 void MainWindow::controllerError(QLowEnergyController::Error error)
 {
+#if QT_VERSION >= QT_VERSION_CHECK(6, 5, 0)
+    if (error == QLowEnergyController::RssiReadError)
+        return; // Not fatal to the link; handled by LinkQualityMonitor
+#endif
     qWarning() << "BLE Controller Error:" << error;
     statusLabel->setText("Status: Controller Error!");
     connectButton->setEnabled(true);
@@ -428,129 +848,242 @@ void MainWindow::controllerError(QLowEnergyController::Error error)
         errorString = "Other error.";
         break;
     }
-    QMessageBox::critical(this, "BLE Controller Error", errorString);
+    if (!unattended())
+        QMessageBox::critical(this, "BLE Controller Error", errorString);
+    m_httpServer->setConnectedDevice(QBluetoothDeviceInfo());
+    m_watchdog->clear();
+    m_linkQuality->stop();
+    m_reconnectAfterDisconnect = false;
+    for (int op = 0; op < IngestMetrics::GattOpCount; ++op)
+        m_ingestMetrics.opAborted(IngestMetrics::GattOp(op));
+    cancelGattWorkflows();
 
     if (leController) {
         leController->deleteLater();
         leController = nullptr;
     }
-    for (QLowEnergyService *service : std::as_const(m_services)) {
-        if (service) service->deleteLater();
-    }
-    m_services.clear();
-    m_serviceUuids.clear();
-    m_characteristicItems.clear();
-    m_currentService = nullptr;
+    releaseServices();
     deviceComboBox->clear(); // Change: Clear the QComboBox
-    characteristicListWidget->clear();
+    showKnownDevices();
+    characteristicTreeWidget->clear();
+
+    if (m_config.autostart) {
+        if (m_autostartDirect) {
+            // The stack didn't know the address without seeing it advertise; find it by scanning
+            qDebug() << "Autostart: direct connect failed, scanning instead";
+            m_autostartDirect = false;
+            startScan();
+        } else {
+            scheduleAutostartRetry();
+        }
+    }
 }
 
 // --- New: Service and Characteristic Interaction Slots ---
 void MainWindow::onServiceSelected()
 {
     // Change: Check if an item is selected in QComboBox
-    if (deviceComboBox->currentIndex() == -1 || !leController ||
-        leController->state() != QLowEnergyController::DiscoveredState ||
+    if (deviceComboBox->currentIndex() == -1 || !servicesReady() ||
         deviceComboBox->currentText().contains("--- Discovered Services ---") || // Don't try to select the separator
         deviceComboBox->currentText().contains("No services found")) {
         return;
     }
 
-    QString selectedServiceText = deviceComboBox->currentText(); // Change: Get current text from QComboBox
-    QString uuidString = selectedServiceText.split(" ").first();
-    QBluetoothUuid selectedUuid(uuidString);
-
-    if (m_services.contains(selectedUuid)) {
-        m_currentService = m_services.value(selectedUuid);
-        qDebug() << "Service already known, displaying characteristics for:" << selectedUuid.toString();
-        if (m_currentService->state() == QLowEnergyService::RemoteServiceDiscovered) {
-            characteristicListWidget->clear();
-            m_characteristicItems.clear();
-            for (const QLowEnergyCharacteristic &characteristic : m_currentService->characteristics()) {
-                QString charInfo = QString("  Char: %1 (%2) - Props: %3")
-                .arg(characteristic.name().isEmpty() ? characteristic.uuid().toString() : characteristic.name())
-                    .arg(characteristic.uuid().toString())
-                    .arg(characteristic.properties());
-                QListWidgetItem *item = new QListWidgetItem(charInfo);
-                characteristicListWidget->addItem(item);
-                m_characteristicItems.insert(characteristic, item);
-
-                if (characteristic.properties() & QLowEnergyCharacteristic::Read) {
-                    m_currentService->readCharacteristic(characteristic);
-                }
-                if (characteristic.properties() & (QLowEnergyCharacteristic::Notify | QLowEnergyCharacteristic::Indicate)) {
-                    QLowEnergyDescriptor notificationDescriptor = characteristic.descriptor(QBluetoothUuid::DescriptorType::ClientCharacteristicConfiguration);
-                    if (notificationDescriptor.isValid()) {
-                        m_currentService->writeDescriptor(notificationDescriptor, QByteArray::fromHex("0100"));
-                        qDebug() << "Enabled notifications for characteristic:" << characteristic.uuid().toString();
-                    }
-                }
-            }
-        }
-    } else {
-        QLowEnergyService *service = leController->createServiceObject(selectedUuid, this);
-        if (service) {
-            m_services.insert(selectedUuid, service);
-            m_currentService = service;
-            characteristicListWidget->clear();
-            m_characteristicItems.clear();
-
-            connect(service, &QLowEnergyService::stateChanged,
-                    this, &MainWindow::serviceDetailsDiscovered);
-            connect(service, QOverload<QLowEnergyService::ServiceError>::of(&QLowEnergyService::errorOccurred),
-                    this, &MainWindow::serviceError);
-            connect(service, &QLowEnergyService::characteristicChanged,
-                    this, &MainWindow::characteristicChanged);
-            connect(service, &QLowEnergyService::characteristicRead,
-                    this, &MainWindow::characteristicRead);
-            connect(service, &QLowEnergyService::descriptorWritten,
-                    this, &MainWindow::descriptorWritten);
-
-            statusLabel->setText(QString("Status: Discovering characteristics for %1...").arg(selectedServiceText));
-            service->discoverDetails();
-        } else {
-            statusLabel->setText("Status: Failed to create service object.");
-            qWarning() << "Failed to create service object for:" << selectedUuid.toString();
-            m_currentService = nullptr;
-        }
-    }
+    const QBluetoothUuid selectedUuid(deviceComboBox->currentText().split(" ").first());
+    openServices({selectedUuid});
 }
 
+bool MainWindow::servicesReady() const
+{
+    if (m_serviceFactory)
+        return true; // No controller behind the services
+    return leController && leController->state() == QLowEnergyController::DiscoveredState;
+}
 
-void MainWindow::serviceDetailsDiscovered(QLowEnergyService::ServiceState newState)
+QLowEnergyService *MainWindow::createService(const QBluetoothUuid &uuid)
 {
-    QLowEnergyService *service = qobject_cast<QLowEnergyService*>(sender());
-    if (!service) return;
+    // Owned by the controller as well, so none can outlive the connection it belongs to
+    QLowEnergyService *service = m_serviceFactory ? m_serviceFactory(uuid)
+                                 : leController ? leController->createServiceObject(uuid, leController)
+                                 : nullptr;
+    if (!service)
+        return nullptr;
+    m_services.insert(uuid, service);
+
+    connect(service, QOverload<QLowEnergyService::ServiceError>::of(&QLowEnergyService::errorOccurred),
+            this, &MainWindow::serviceError);
+    connect(service, &QLowEnergyService::characteristicChanged,
+            this, &MainWindow::characteristicChanged);
+    connect(service, &QLowEnergyService::characteristicRead,
+            this, &MainWindow::characteristicRead);
+    connect(service, &QLowEnergyService::descriptorWritten,
+            this, &MainWindow::descriptorWritten);
+    connect(service, &QLowEnergyService::descriptorRead,
+            this, &MainWindow::descriptorRead);
+    return service;
+}
+
+// --- Coroutine Workflows ---
+void MainWindow::cancelGattWorkflows()
+{
+    m_gattCancel.cancel();
+    m_gattCancel = Gatt::Cancel();
+}
+
+// Every teardown path goes through here: the service objects must be deleted, not just forgotten
+void MainWindow::releaseServices()
+{
+    for (QLowEnergyService *service : std::as_const(m_services)) {
+        if (service) service->deleteLater();
+    }
+    m_services.clear();
+    m_serviceUuids.clear();
+    m_characteristicItems.clear();
+    m_currentService = nullptr;
+    // Requests queued on those services will not complete
+    m_ingestMetrics.opAborted(IngestMetrics::DiscoverDetails);
+    m_ingestMetrics.opAborted(IngestMetrics::ReadCharacteristic);
+    m_ingestMetrics.opAborted(IngestMetrics::WriteDescriptor);
+}
 
-    if (newState == QLowEnergyService::RemoteServiceDiscovered) {
-        statusLabel->setText(QString("Status: Characteristics discovered for %1.").arg(service->serviceUuid().toString()));
-        characteristicListWidget->clear(); // Clear previous characteristics
-        m_characteristicItems.clear(); // Clear previous characteristic items
-
-        for (const QLowEnergyCharacteristic &characteristic : service->characteristics()) {
-            QString charInfo = QString("  Char: %1 (%2) - Props: %3")
-            .arg(characteristic.name().isEmpty() ? characteristic.uuid().toString() : characteristic.name())
-                .arg(characteristic.uuid().toString())
-                .arg(characteristic.properties());
-            QListWidgetItem *item = new QListWidgetItem(charInfo);
-            characteristicListWidget->addItem(item);
-            m_characteristicItems.insert(characteristic, item); // Store for later updates
-
-            // Read value if readable
+// Opens services, whether selected in the combo box or chosen by autostart, fast connect or a
+// watchdog resume. Detail discovery runs for all of them at once (services already discovered
+// complete immediately); then each service's characteristics are listed and subscribed, as limited
+// by the device's (or else the station's) subscription profile, and all reads are issued together
+// and awaited as one step, so the first weight is never queued behind optional reads.
+// Values still reach the table through characteristicRead(), as for reads started from the UI.
+Gatt::Task<> MainWindow::openServices(QList<QBluetoothUuid> uuids)
+{
+    Gatt::Context context;
+    context.timers = m_timers;
+    context.timeoutMs = kGattTimeoutMs;
+    context.cancel = m_gattCancel;
+
+    PhaseTimeline::instance().mark(PhaseTimeline::ServiceSelected);
+    QList<QLowEnergyService *> services;
+    std::vector<Gatt::Task<Gatt::Result<>>> details;
+    for (const QBluetoothUuid &uuid : std::as_const(uuids)) {
+        QLowEnergyService *service = m_services.value(uuid);
+        if (!service)
+            service = createService(uuid);
+        if (!service) {
+            qWarning() << "Failed to create service object for:" << uuid.toString();
+            continue;
+        }
+        services.append(service);
+        m_ingestMetrics.opStarted(IngestMetrics::DiscoverDetails, qHash(uuid));
+        details.push_back(Gatt::discoverDetails(service, context));
+    }
+    if (services.isEmpty()) {
+        statusLabel->setText("Status: Failed to create service object.");
+        co_return;
+    }
+    m_currentService = services.first();
+    statusLabel->setText(QString("Status: Discovering characteristics for %1...").arg(m_currentService->serviceUuid().toString()));
+
+    const std::vector<Gatt::Result<>> discovered = co_await Gatt::whenAll(std::move(details));
+    if (context.cancel.isCancelled())
+        co_return; // Connection torn down meanwhile; the services are gone
+
+    characteristicTreeWidget->clear();
+    m_characteristicItems.clear();
+    std::vector<Gatt::Task<Gatt::Result<QByteArray>>> reads;
+    for (int i = 0; i < services.size(); ++i) {
+        QLowEnergyService *service = services.at(i);
+        if (!discovered[size_t(i)]) {
+            qWarning() << "Detail discovery failed for" << service->serviceUuid().toString() << ":"
+                       << discovered[size_t(i)].errorString;
+            continue;
+        }
+        m_ingestMetrics.opFinished(IngestMetrics::DiscoverDetails, qHash(service->serviceUuid()));
+        PhaseTimeline::instance().mark(PhaseTimeline::DetailsDiscovered);
+
+        // Subscriptions go out before the reads, so the first weight is not queued behind them
+        const QList<QLowEnergyCharacteristic> characteristics = service->characteristics();
+        for (const QLowEnergyCharacteristic &characteristic : characteristics) {
+            m_characteristicItems.insert(characteristic, addCharacteristicItem(characteristic));
+            planDecoding(service, characteristic);
+            if (subscribes(characteristic.uuid()))
+                subscribeToCharacteristic(service, characteristic);
+        }
+        if (!m_config.readCharacteristics)
+            continue;
+        for (const QLowEnergyCharacteristic &characteristic : characteristics) {
             if (characteristic.properties() & QLowEnergyCharacteristic::Read) {
-                service->readCharacteristic(characteristic); // Triggers characteristicRead slot
+                m_ingestMetrics.opStarted(IngestMetrics::ReadCharacteristic, qHash(characteristic.uuid()));
+                reads.push_back(Gatt::read(service, characteristic, context));
             }
+        }
+    }
+    statusLabel->setText(QString("Status: Characteristics discovered for %1.").arg(m_currentService->serviceUuid().toString()));
 
-            // Enable notifications/indications if supported
-            if (characteristic.properties() & (QLowEnergyCharacteristic::Notify | QLowEnergyCharacteristic::Indicate)) {
-                QLowEnergyDescriptor notificationDescriptor = characteristic.descriptor(QBluetoothUuid::DescriptorType::ClientCharacteristicConfiguration);
-                if (notificationDescriptor.isValid()) {
-                    // Write to the Client Characteristic Configuration Descriptor (CCCD)
-                    // 0x01 for notifications, 0x02 for indications
-                    service->writeDescriptor(notificationDescriptor, QByteArray::fromHex("0100")); // Enable Notifications
-                    qDebug() << "Enabled notifications for characteristic:" << characteristic.uuid().toString();
-                }
-            }
+    const std::vector<Gatt::Result<QByteArray>> values = co_await Gatt::whenAll(std::move(reads));
+    if (context.cancel.isCancelled())
+        co_return;
+    int failed = 0;
+    for (const Gatt::Result<QByteArray> &value : values) {
+        if (!value)
+            ++failed;
+    }
+    if (failed > 0)
+        qWarning() << failed << "of" << values.size() << "characteristic reads failed or timed out";
+}
+
+// Presentation Format (0x2904) and User Description (0x2901) descriptors describe how to decode a
+// characteristic that has no dedicated decoder. Full detail discovery has normally read their
+// values already; anything still empty is read now and applied from descriptorRead().
+void MainWindow::planDecoding(QLowEnergyService *service, const QLowEnergyCharacteristic &characteristic)
+{
+    const QLowEnergyDescriptor descriptors[] = {
+        characteristic.descriptor(QBluetoothUuid::DescriptorType::CharacteristicPresentationFormat),
+        characteristic.descriptor(QBluetoothUuid::DescriptorType::CharacteristicUserDescription),
+    };
+    for (const QLowEnergyDescriptor &descriptor : descriptors) {
+        if (!descriptor.isValid())
+            continue;
+        if (descriptor.value().isEmpty())
+            service->readDescriptor(descriptor);
+        else
+            applyFormatDescriptor(characteristic, descriptor.uuid(), descriptor.value());
+    }
+}
+
+void MainWindow::applyFormatDescriptor(const QLowEnergyCharacteristic &characteristic, const QBluetoothUuid &descriptor, const QByteArray &value)
+{
+    const SampleDecoder::DecodePlan *current = m_decoder.plan(characteristic.uuid());
+    if (descriptor == QBluetoothUuid(QBluetoothUuid::DescriptorType::CharacteristicPresentationFormat)) {
+        SampleDecoder::DecodePlan plan = SampleDecoder::DecodePlan::fromPresentationFormat(value);
+        if (current)
+            plan.description = current->description;
+        m_decoder.setPlan(characteristic.uuid(), plan);
+        qDebug() << "Decode plan for" << characteristic.uuid().toString() << "format" << Qt::hex << plan.format
+                 << "exponent" << Qt::dec << plan.exponent << "unit" << Qt::hex << plan.unit
+                 << (plan.isValid() ? "" : "(not decoded)");
+    } else if (descriptor == QBluetoothUuid(QBluetoothUuid::DescriptorType::CharacteristicUserDescription)) {
+        const QString description = QString::fromUtf8(value).trimmed();
+        if (current) {
+            SampleDecoder::DecodePlan plan = *current;
+            plan.description = description;
+            m_decoder.setPlan(characteristic.uuid(), plan);
+        }
+        QTreeWidgetItem *item = m_characteristicItems.value(characteristic);
+        if (item && !description.isEmpty())
+            item->setText(CharacteristicColumn, QString("%1 (%2)").arg(description, characteristic.uuid().toString()));
+    }
+}
+
+void MainWindow::subscribeToCharacteristic(QLowEnergyService *service, const QLowEnergyCharacteristic &characteristic)
+{
+    // Enable notifications/indications if supported
+    if (characteristic.properties() & (QLowEnergyCharacteristic::Notify | QLowEnergyCharacteristic::Indicate)) {
+        QLowEnergyDescriptor notificationDescriptor = characteristic.descriptor(QBluetoothUuid::DescriptorType::ClientCharacteristicConfiguration);
+        if (notificationDescriptor.isValid()) {
+            // Write to the Client Characteristic Configuration Descriptor (CCCD)
+            // 0x01 for notifications, 0x02 for indications
+            m_ingestMetrics.opStarted(IngestMetrics::WriteDescriptor);
+            service->writeDescriptor(notificationDescriptor, QByteArray::fromHex("0100")); // Enable Notifications
+            m_watchdog->watch(service, characteristic);
+            qDebug() << "Enabled notifications for characteristic:" << characteristic.uuid().toString();
         }
     }
 }
@@ -558,38 +1091,162 @@ void MainWindow::serviceDetailsDiscovered(QLowEnergyService::ServiceState newSta
 void MainWindow::characteristicChanged(const QLowEnergyCharacteristic &characteristic, const QByteArray &newValue)
 {
     // This slot is called when a characteristic's value changes (due to notification/indication)
-    qDebug() << "Characteristic Changed:" << characteristic.uuid().toString() << "New Value:" << newValue.toHex();
-    if (m_characteristicItems.contains(characteristic)) {
-        QListWidgetItem *item = m_characteristicItems.value(characteristic);
-        QString charInfo = QString("  Char: %1 (%2)\n  Value: %3 (Hex) / %4")
-                               .arg(characteristic.name().isEmpty() ? characteristic.uuid().toString() : characteristic.name())
-                               .arg(characteristic.uuid().toString())
-                               .arg(newValue.toHex().toUpper())
-                               .arg(QString::fromUtf8(newValue)); // Try to decode as UTF-8
-        item->setText(charInfo);
+    TraceScope trace("notification");
+    qCDebug(lcNotifications) << "Characteristic Changed:" << characteristic.uuid().toString() << "New Value:" << newValue.toHex();
+    m_ingestMetrics.notificationReceived(characteristic.uuid());
+    const qint64 arrivalUs = CharacteristicStats::monotonicUs();
+    BLESCALE_PROBE3(notify_arrival, qHash(characteristic.uuid()), newValue.size(), arrivalUs);
+    CharacteristicStats &stats = m_characteristicStats[characteristic.uuid()];
+    stats.recordArrival(arrivalUs);
+    if (stats.count() == 1)
+        Tracer::instance().instant("firstNotification", qHash(characteristic.uuid()));
+    PhaseTimeline::instance().mark(PhaseTimeline::FirstNotification);
+    m_watchdog->notified(characteristic.uuid(), arrivalUs, stats.meanIntervalMs(), stats.count());
+
+    // The table shows the newest payload a few times a second instead of formatting every one
+    m_pendingValues.insert(characteristic.uuid(), newValue);
+    if (!m_valueRefreshTimer->isActive())
+        m_valueRefreshTimer->start();
+
+    const qint64 timestampUs = Sample::nowUs();
+#ifdef BLESCALE_SCRIPTING
+    if (m_scriptDecoder->handles(characteristic.uuid())) {
+        Sample sample;
+        sample.device = m_currentDevice.address().toUInt64();
+        sample.characteristic = characteristic.uuid();
+        sample.timestampUs = timestampUs;
+        m_scriptDecoder->decode(newValue, sample); // Result comes back through scriptDecoded()
+        m_linkQuality->notified(characteristic.uuid(), stats, arrivalUs);
+        return;
+    }
+#endif
+    m_pendingNotifications.push_back({characteristic.uuid(), newValue, timestampUs});
+    if (!m_decodeScheduled) {
+        m_decodeScheduled = true;
+        QMetaObject::invokeMethod(this, &MainWindow::decodeNotifications, Qt::QueuedConnection);
+    }
+    m_linkQuality->notified(characteristic.uuid(), stats, arrivalUs);
+}
+
+// Decodes everything that arrived since the last event loop pass. Temporaries live in a stack
+// arena and sample records come from SampleRef's pool, so once the hashes and pools have warmed
+// up, decoding a batch makes no heap allocations; the sinks' own output (JSON, MQTT frames) is
+// outside that and happens when the batch is published.
+void MainWindow::decodeNotifications()
+{
+    m_decodeScheduled = false;
+    if (m_pendingNotifications.empty())
+        return;
+    const quint64 allocationsBefore = AllocationCounter::count();
+
+    std::array<std::byte, kDecodeArenaBytes> buffer;
+    std::pmr::monotonic_buffer_resource arena(buffer.data(), buffer.size());
+    const int count = int(m_pendingNotifications.size());
+    std::pmr::vector<Sample> samples(count, &arena);
+    std::pmr::vector<QByteArray> payloads(&arena); // Shared with the pending list, not copied
+    payloads.reserve(count);
+    bool *decoded = static_cast<bool *>(arena.allocate(count * sizeof(bool), alignof(bool)));
+
+    const quint64 device = m_currentDevice.address().toUInt64();
+    for (int i = 0; i < count; ++i) {
+        const PendingNotification &notification = m_pendingNotifications[i];
+        samples[i].device = device;
+        samples[i].characteristic = notification.characteristic;
+        samples[i].timestampUs = notification.timestampUs;
+        payloads.push_back(notification.payload);
+    }
+
+    // One decoder call per run of the same characteristic, so batch decoders see whole runs
+    for (int first = 0; first < count;) {
+        const QBluetoothUuid &characteristic = m_pendingNotifications[first].characteristic;
+        int last = first + 1;
+        while (last < count && m_pendingNotifications[last].characteristic == characteristic)
+            ++last;
+        m_decoder.decodeRun(characteristic, payloads.data() + first, last - first, samples.data() + first, decoded + first);
+        first = last;
+    }
+
+    // Keep the decoded samples, in arrival order
+    int kept = 0;
+    for (int i = 0; i < count; ++i) {
+        if (!decoded[i]) {
+            if (m_decoder.canDecode(samples[i].characteristic))
+                m_ingestMetrics.decodeError();
+            continue;
+        }
+        if (samples[i].flags & Sample::HasSequence)
+            m_characteristicStats[samples[i].characteristic].recordSequence(samples[i].sequence);
+        if (kept != i) {
+            samples[kept] = samples[i];
+            payloads[kept] = payloads[i];
+        }
+        ++kept;
     }
+    samples.resize(kept);
+    m_calibration.apply(samples.data(), int(samples.size()));
+
+    std::pmr::vector<SampleRef> batch(&arena);
+    batch.reserve(samples.size());
+    for (size_t i = 0; i < samples.size(); ++i) {
+        const Sample &sample = samples[i];
+        BLESCALE_PROBE4(decode_done, qHash(sample.characteristic), sample.mantissa, sample.exponent, sample.timestampUs);
+        batch.emplace_back(sample, payloads[i]);
+    }
+    m_decodeAllocations += AllocationCounter::count() - allocationsBefore;
+    ++m_decodeBatches;
+
+    if (std::any_of(samples.cbegin(), samples.cend(), [](const Sample &sample) { return sample.isWeight(); }))
+        PhaseTimeline::instance().mark(PhaseTimeline::FirstWeight);
+    for (const SampleRef &ref : batch)
+        m_sampleBus->publish(ref);
+    m_pendingNotifications.clear(); // Keeps the capacity
+}
+
+void MainWindow::scriptDecoded(const Sample &sample)
+{
+    Sample decoded = sample;
+    if (decoded.flags & Sample::HasSequence)
+        m_characteristicStats[decoded.characteristic].recordSequence(decoded.sequence);
+    publishSample(decoded, QByteArray());
+}
+
+void MainWindow::publishSample(Sample &sample, const QByteArray &payload)
+{
+    m_calibration.apply(&sample, 1);
+    BLESCALE_PROBE4(decode_done, qHash(sample.characteristic), sample.mantissa, sample.exponent, sample.timestampUs);
+    if (sample.isWeight())
+        PhaseTimeline::instance().mark(PhaseTimeline::FirstWeight);
+    m_sampleBus->publish(SampleRef(sample, payload));
 }
 
 void MainWindow::characteristicRead(const QLowEnergyCharacteristic &characteristic, const QByteArray &value)
 {
     // This slot is called after a readCharacteristic() request completes
     qDebug() << "Characteristic Read:" << characteristic.uuid().toString() << "Value:" << value.toHex();
+    m_ingestMetrics.opFinished(IngestMetrics::ReadCharacteristic, qHash(characteristic.uuid()));
     if (m_characteristicItems.contains(characteristic)) {
-        QListWidgetItem *item = m_characteristicItems.value(characteristic);
-        QString charInfo = QString("  Char: %1 (%2)\n  Value: %3 (Hex) / %4")
-                               .arg(characteristic.name().isEmpty() ? characteristic.uuid().toString() : characteristic.name())
-                               .arg(characteristic.uuid().toString())
-                               .arg(value.toHex().toUpper())
-                               .arg(QString::fromUtf8(value)); // Try to decode as UTF-8
-        item->setText(charInfo);
+        QTreeWidgetItem *item = m_characteristicItems.value(characteristic);
+        setCharacteristicValue(item, value);
+    }
+
+    if (characteristic.uuid() == QBluetoothUuid(QBluetoothUuid::CharacteristicType::ModelNumberString)) {
+        const DeviceRegistry::Entry *known = m_registry.find(m_currentDevice.address().toUInt64());
+        const QString model = QString::fromUtf8(value).trimmed();
+        if (known && known->model != model) {
+            DeviceRegistry::Entry entry = *known;
+            entry.model = model;
+            m_registry.upsert(entry);
+        }
     }
 }
 
 void MainWindow::descriptorWritten(const QLowEnergyDescriptor &descriptor, const QByteArray &newValue)
 {
+    m_ingestMetrics.opFinished(IngestMetrics::WriteDescriptor);
     if (descriptor.uuid() == QBluetoothUuid::DescriptorType::ClientCharacteristicConfiguration) {
         //qDebug() << "CCCD Written for characteristic:" << descriptor.characteristic().uuid().toString() << "Value:" << newValue.toHex();
         if (newValue == QByteArray::fromHex("0100")) {
+            PhaseTimeline::instance().mark(PhaseTimeline::Subscribed);
             qDebug() << "Notifications enabled successfully.";
         } else if (newValue == QByteArray::fromHex("0200")) {
             qDebug() << "Indications enabled successfully.";
@@ -599,11 +1256,507 @@ void MainWindow::descriptorWritten(const QLowEnergyDescriptor &descriptor, const
     }
 }
 
+void MainWindow::descriptorRead(const QLowEnergyDescriptor &descriptor, const QByteArray &value)
+{
+    // Descriptors do not expose their characteristic; find it among the listed ones
+    for (auto it = m_characteristicItems.constBegin(); it != m_characteristicItems.constEnd(); ++it) {
+        if (it.key().descriptors().contains(descriptor)) {
+            applyFormatDescriptor(it.key(), descriptor.uuid(), value);
+            return;
+        }
+    }
+}
+
 void MainWindow::serviceError(QLowEnergyService::ServiceError error)
 {
     QLowEnergyService *service = qobject_cast<QLowEnergyService*>(sender());
     if (!service) return;
 
     qWarning() << "Service Error for" << service->serviceUuid().toString() << ":" << error;
+    if (error == QLowEnergyService::DescriptorWriteError)
+        m_ingestMetrics.opFailed(IngestMetrics::WriteDescriptor); // Never reaches descriptorWritten()
     statusLabel->setText(QString("Status: Service %1 Error %2").arg(service->serviceUuid().toString()).arg(error));
 }
+
+// --- Discovered Device Aging ---
+void MainWindow::expireDevice(quint64 address)
+{
+    auto it = m_discoveredDevices.find(address);
+    if (it == m_discoveredDevices.end())
+        return;
+
+    if (leController && m_currentDevice.address().toUInt64() == address) {
+        // Connected devices stop advertising; keep them while the link is up
+        it->expiry = m_timers->schedule(kDeviceExpiryMs, [this, address]() { expireDevice(address); });
+        return;
+    }
+
+    qDebug() << "Discovered device aged out:" << it->itemText;
+    const int index = deviceComboBox->findText(it->itemText); // Not present while services are listed
+    if (index >= 0 && !m_registry.find(address)) // Known devices stay listed
+        deviceComboBox->removeItem(index);
+    m_httpServer->removeDevice(address);
+    m_discoveredDevices.erase(it);
+}
+
+// --- Known Devices ---
+void MainWindow::showKnownDevices()
+{
+    const QList<DeviceRegistry::Entry> known = m_registry.entries();
+    for (const DeviceRegistry::Entry &entry : known) {
+        if (deviceComboIndex(entry.address) < 0)
+            deviceComboBox->addItem(entry.displayName() + " (" + QBluetoothAddress(entry.address).toString() + ")");
+    }
+}
+
+int MainWindow::deviceComboIndex(quint64 address) const
+{
+    const QString suffix = " (" + QBluetoothAddress(address).toString() + ")";
+    for (int i = 0; i < deviceComboBox->count(); ++i) {
+        if (deviceComboBox->itemText(i).endsWith(suffix))
+            return i;
+    }
+    return -1;
+}
+
+bool MainWindow::subscribes(const QBluetoothUuid &characteristic) const
+{
+    const DeviceRegistry::Entry *known = m_registry.find(m_currentDevice.address().toUInt64());
+    if (known && !known->subscriptions.isEmpty())
+        return known->subscriptions.contains(characteristic);
+    return m_config.subscribes(characteristic);
+}
+
+// --- Vendor Decoders ---
+// The registry's decoder choice names the plugin or layout for a known device; otherwise the
+// first plugin, then the first layout, claiming each characteristic applies.
+void MainWindow::selectDecoders()
+{
+    m_decoder.clearPlugins();
+    m_decoder.clearLayouts();
+    const DeviceRegistry::Entry *known = m_registry.find(m_currentDevice.address().toUInt64());
+    const QString chosen = known ? known->decoder : QString();
+    QSet<QBluetoothUuid> taken;
+    for (const DecoderPluginHost::Plugin &plugin : m_decoderPlugins.plugins()) {
+        if (!chosen.isEmpty() && plugin.decoder->name() != chosen)
+            continue;
+        const QList<QBluetoothUuid> characteristics = plugin.decoder->characteristics();
+        for (const QBluetoothUuid &characteristic : characteristics) {
+            if (taken.contains(characteristic))
+                continue;
+            taken.insert(characteristic);
+            m_decoder.setPlugin(characteristic, plugin.decoder);
+            qDebug() << "Decoding" << characteristic.toString() << "with plugin" << plugin.decoder->name();
+        }
+    }
+    for (const LayoutProgram &layout : std::as_const(m_layouts)) {
+        if (!chosen.isEmpty() ? layout.name() != chosen : taken.contains(layout.characteristic()))
+            continue;
+        taken.insert(layout.characteristic());
+        m_decoder.setLayout(layout);
+        qDebug() << "Decoding" << layout.characteristic().toString() << "with layout" << layout.name();
+    }
+}
+
+// --- Calibration ---
+void MainWindow::setupCalibration()
+{
+    m_calibration.setUnit(m_config.unit);
+    const QList<DeviceRegistry::Entry> known = m_registry.entries();
+    for (const DeviceRegistry::Entry &entry : known)
+        m_calibration.setCurve(entry.address, Calibration::Curve::fromBlob(entry.calibration));
+
+    // GET lists the curves per device, in kg. POST sets one (stored in the device registry) from
+    // {"device":"ADDR","points":[[raw,true],...]} in kg, or removes it with {"device":"ADDR","clear":true}.
+    // Only devices the station knows (remembered, seen in this scan or connected) can be calibrated.
+    m_httpServer->addRoute("/api/calibration", [this](const HttpServer::Request &) {
+        HttpServer::Response response;
+        response.body = "{\"devices\":[";
+        const QList<quint64> devices = m_calibration.devices();
+        for (int i = 0; i < devices.size(); ++i) {
+            if (i > 0)
+                response.body += ',';
+            response.body += "{\"device\":\"" + QBluetoothAddress(devices.at(i)).toString().toLatin1() + "\",\"points\":[";
+            const QList<Calibration::Point> &points = m_calibration.curve(devices.at(i))->points();
+            for (int p = 0; p < points.size(); ++p) {
+                if (p > 0)
+                    response.body += ',';
+                response.body += '[' + Calibration::formatKg(points.at(p).rawMg) + ',' + Calibration::formatKg(points.at(p).trueMg) + ']';
+            }
+            response.body += "]}";
+        }
+        response.body += "]}";
+        return response;
+    });
+    m_httpServer->addRoute("/api/calibration", [this](const HttpServer::Request &request) {
+        HttpServer::Response response;
+        const QJsonObject body = QJsonDocument::fromJson(request.body).object();
+        const QBluetoothAddress address(body.value("device").toString());
+        QList<Calibration::Point> points;
+        const QJsonArray pairs = body.value("points").toArray();
+        for (const QJsonValue &pair : pairs) {
+            const QJsonArray values = pair.toArray();
+            Calibration::Point point;
+            // Numbers or strings; either way no more than 6 decimals of a kg
+            const auto kg = [](const QJsonValue &value) {
+                return value.isDouble() ? QString::number(value.toDouble(), 'f', 6) : value.toString();
+            };
+            if (values.size() != 2 || !Calibration::parseMilligrams(kg(values.at(0)), point.rawMg)
+                || !Calibration::parseMilligrams(kg(values.at(1)), point.trueMg)) {
+                points.clear();
+                break;
+            }
+            points.append(point);
+        }
+        const bool clear = body.value("clear").toBool();
+        if (address.isNull() || (points.isEmpty() && !clear)) {
+            response.status = 400;
+            response.body = "{\"error\":\"expected {\\\"device\\\":ADDR,\\\"points\\\":[[raw,true],...]} in kg, or \\\"clear\\\":true\"}";
+            return response;
+        }
+        const quint64 device = address.toUInt64();
+        const DeviceRegistry::Entry *known = m_registry.find(device);
+        if (!known && !m_discoveredDevices.contains(device) && m_currentDevice.address() != address) {
+            response.status = 404;
+            response.body = "{\"error\":\"unknown device\"}";
+            return response;
+        }
+
+        const Calibration::Curve curve(points);
+        DeviceRegistry::Entry entry = known ? *known : DeviceRegistry::Entry();
+        entry.address = device;
+        entry.calibration = curve.toBlob();
+        m_registry.upsert(entry);
+        m_calibration.setCurve(entry.address, curve);
+        qDebug() << "Calibration for" << address.toString() << (curve.isEmpty() ? "cleared" : "set")
+                 << "with" << curve.points().size() << "points";
+        response.body = "{\"device\":\"" + address.toString().toLatin1() + "\",\"points\":" + QByteArray::number(curve.points().size()) + '}';
+        return response;
+    }, "POST");
+}
+
+// --- Link Quality ---
+void MainWindow::showLinkQuality(int score, int rssiDbm)
+{
+    if (score < 0) {
+        linkQualityLabel->setText("Link: --");
+        return;
+    }
+    QString text = QString("Link: %1/100").arg(score);
+    if (m_linkQuality->hasRssi())
+        text += QString(" (RSSI %1 dBm)").arg(rssiDbm);
+    linkQualityLabel->setText(text);
+}
+
+// --- Unattended Autostart ---
+void MainWindow::startAutostart()
+{
+    // Fastest path: a single configured address is connected without waiting to see it advertise,
+    // and so is a remembered scale matching the targets or name filters. With several targets and
+    // none remembered, the scan takes whichever advertises first.
+    QBluetoothDeviceInfo device;
+    if (m_config.targets.size() == 1) {
+        const DeviceRegistry::Entry *known = m_registry.find(m_config.targets.first().toUInt64());
+        device = known ? known->toDeviceInfo() : QBluetoothDeviceInfo(m_config.targets.first(), QString(), 0);
+        device.setCoreConfigurations(QBluetoothDeviceInfo::LowEnergyCoreConfiguration);
+    } else {
+        const QList<DeviceRegistry::Entry> known = m_registry.entries();
+        for (const DeviceRegistry::Entry &entry : known) {
+            if (m_config.hasTargetFilter() && m_config.matches(entry.toDeviceInfo())) {
+                device = entry.toDeviceInfo();
+                break;
+            }
+        }
+    }
+    if (device.isValid()) {
+        qDebug() << "Autostart: connecting directly to" << device.address().toString();
+        m_autostartDirect = true;
+        m_resumeServiceUuid = QBluetoothUuid();
+        connectToDeviceInfo(device);
+        return;
+    }
+    qDebug() << "Autostart: scanning for a matching scale";
+    startScan();
+}
+
+void MainWindow::scheduleAutostartRetry()
+{
+    m_timers->cancel(m_autostartRetry);
+    m_autostartRetry = m_timers->schedule(kAutostartRetryMs, [this]() {
+        m_autostartRetry = 0;
+        if (leController)
+            return; // Connected in the meantime
+        if (m_currentDevice.isValid()) {
+            m_autostartDirect = true; // Known from the previous connection
+            m_resumeServiceUuid = QBluetoothUuid();
+            connectToDeviceInfo(m_currentDevice);
+        } else {
+            startScan();
+        }
+    });
+}
+
+// --- Stall Recovery ---
+void MainWindow::recoverStalledConnection()
+{
+    if (!leController || !m_currentDevice.isValid())
+        return;
+
+    qWarning() << "Reconnecting to" << m_currentDevice.address().toString() << "after notification stall";
+    statusLabel->setText("Status: Notifications stalled, reconnecting...");
+    m_resumeServiceUuid = m_currentService ? m_currentService->serviceUuid() : QBluetoothUuid();
+    m_reconnectAfterDisconnect = true;
+    m_watchdog->clear();
+    leController->disconnectFromDevice(); // -> deviceDisconnected() -> connectToDeviceInfo()
+}
+
+// --- Characteristic Table ---
+QTreeWidgetItem *MainWindow::addCharacteristicItem(const QLowEnergyCharacteristic &characteristic)
+{
+    QTreeWidgetItem *item = new QTreeWidgetItem(characteristicTreeWidget);
+    item->setText(CharacteristicColumn, QString("%1 (%2)")
+                  .arg(characteristic.name().isEmpty() ? characteristic.uuid().toString() : characteristic.name())
+                  .arg(characteristic.uuid().toString()));
+    item->setText(PropertiesColumn, QString::number(characteristic.properties()));
+    return item;
+}
+
+QTreeWidgetItem *MainWindow::characteristicItem(const QBluetoothUuid &uuid) const
+{
+    for (auto it = m_characteristicItems.constBegin(); it != m_characteristicItems.constEnd(); ++it) {
+        if (it.key().uuid() == uuid)
+            return it.value();
+    }
+    return nullptr;
+}
+
+void MainWindow::setCharacteristicValue(QTreeWidgetItem *item, const QByteArray &value)
+{
+    TraceScope trace("uiSetValue");
+    item->setText(ValueColumn, QString("%1 (Hex) / %2")
+                  .arg(QString::fromLatin1(value.toHex().toUpper()))
+                  .arg(QString::fromUtf8(value))); // Try to decode as UTF-8
+}
+
+void MainWindow::refreshCharacteristicValues()
+{
+    // Shown entries are nulled rather than removed, so the hash keeps its nodes for the next arrival
+    for (auto it = m_pendingValues.begin(); it != m_pendingValues.end(); ++it) {
+        if (it.value().isNull())
+            continue;
+        if (QTreeWidgetItem *item = characteristicItem(it.key())) {
+            BLESCALE_PROBE1(ui_apply_start, qHash(it.key()));
+            setCharacteristicValue(item, it.value());
+            BLESCALE_PROBE1(ui_apply_done, qHash(it.key()));
+        }
+        it.value() = QByteArray();
+    }
+}
+
+// Statistics columns are refreshed on a timer rather than per notification so that a fast
+// characteristic doesn't pay for QString formatting on every arrival.
+void MainWindow::refreshCharacteristicStats()
+{
+    TraceScope trace("uiRefreshStats");
+    const qint64 nowUs = CharacteristicStats::monotonicUs();
+    for (auto it = m_characteristicItems.constBegin(); it != m_characteristicItems.constEnd(); ++it) {
+        auto statsIt = m_characteristicStats.constFind(it.key().uuid());
+        if (statsIt == m_characteristicStats.constEnd())
+            continue;
+        const CharacteristicStats &stats = statsIt.value();
+        QTreeWidgetItem *item = it.value();
+        item->setText(RateColumn, QString::number(stats.rateHz(nowUs), 'f', 1));
+        item->setText(JitterColumn, QString::number(stats.jitterMs(), 'f', 1));
+        item->setText(LongestGapColumn, QString::number(stats.longestGapMs(), 'f', 0));
+        item->setText(SequenceGapsColumn, QString::number(stats.sequenceGaps()));
+    }
+}
+
+// --- Memory Accounting ---
+// Each subsystem's estimate comes from the containers it owns; see MemoryAccounting for what is
+// and is not counted. Estimates are only taken when scraped, shown or checked.
+void MainWindow::setupMemoryAccounting()
+{
+    m_memory.addSubsystem("discovery", [this]() {
+        qint64 bytes = m_registry.memoryUsage() + MemoryAccounting::containerBytes(m_discoveredDevices);
+        for (const DiscoveredDevice &device : std::as_const(m_discoveredDevices))
+            bytes += MemoryAccounting::bytes(device.itemText);
+        return bytes;
+    });
+    m_memory.addSubsystem("gatt", [this]() {
+        return MemoryAccounting::containerBytes(m_services) + MemoryAccounting::containerBytes(m_serviceUuids)
+               + MemoryAccounting::containerBytes(m_characteristicStats)
+               + qint64(m_pendingNotifications.capacity() * sizeof(PendingNotification));
+    });
+    m_memory.addSubsystem("history", [this]() { return Tracer::instance().memoryUsage() + m_sampleBus->memoryUsage(); });
+    m_memory.addSubsystem("sinks", [this]() {
+        return m_streamServer->memoryUsage() + m_httpServer->memoryUsage() + m_mqttPublisher->memoryUsage();
+    });
+    m_memory.addSubsystem("ui", [this]() {
+        qint64 bytes = MemoryAccounting::containerBytes(m_characteristicItems) + MemoryAccounting::containerBytes(m_pendingValues);
+        for (const QByteArray &value : std::as_const(m_pendingValues))
+            bytes += MemoryAccounting::bytes(value);
+        for (int i = 0; i < characteristicTreeWidget->topLevelItemCount(); ++i) {
+            const QTreeWidgetItem *item = characteristicTreeWidget->topLevelItem(i);
+            bytes += qint64(sizeof(QTreeWidgetItem));
+            for (int column = 0; column < item->columnCount(); ++column)
+                bytes += MemoryAccounting::bytes(item->text(column));
+        }
+        for (int i = 0; i < deviceComboBox->count(); ++i)
+            bytes += MemoryAccounting::bytes(deviceComboBox->itemText(i));
+        return bytes;
+    });
+
+    MetricsRegistry::instance().addCollector(this, [this](QByteArray &out) { m_memory.appendMetrics(out); });
+    m_httpServer->addRoute("/api/memory", [this](const HttpServer::Request &) {
+        HttpServer::Response response;
+        response.body = m_memory.toJson();
+        return response;
+    });
+    connect(memoryButton, &QPushButton::clicked, this, &MainWindow::showMemoryUsage);
+
+    // --memory-check: steady-state streaming from a synthetic scale on the manual clock, so the
+    // simulated run takes as long as decoding and publishing it does
+    if (m_config.memoryCheckMb > 0) {
+        const qint64 durationMs = qint64(m_config.memoryCheckMinutes) * 60000;
+        m_timers->setManualClock(true);
+        SyntheticStream *stream = new SyntheticStream(this, 0x3e3c, this);
+        m_memoryCheck = new MemoryCheck(&m_memory, m_timers, this);
+        connect(m_memoryCheck, &MemoryCheck::finished, stream, &SyntheticStream::stop);
+        connect(m_memoryCheck, &MemoryCheck::finished, this, [this](bool passed) { emit memoryCheckFinished(passed); });
+        m_memoryCheck->start(qint64(m_config.memoryCheckMb * 1024 * 1024), durationMs, durationMs / 10); // Warm-up: fill caches and rings
+        statusLabel->setText("Status: Memory check (simulated)...");
+        stream->start();
+    }
+}
+
+void MainWindow::showMemoryUsage()
+{
+    QDialog *dialog = new QDialog(this);
+    dialog->setAttribute(Qt::WA_DeleteOnClose);
+    dialog->setWindowTitle("Memory Usage");
+    QTreeWidget *table = new QTreeWidget(dialog);
+    table->setRootIsDecorated(false);
+    table->setHeaderLabels({"Subsystem", "Bytes"});
+    QVBoxLayout *layout = new QVBoxLayout(dialog);
+    layout->addWidget(table);
+
+    const auto refresh = [this, table]() {
+        table->clear();
+        qint64 total = 0;
+        const QList<QPair<QByteArray, qint64>> subsystems = m_memory.snapshot();
+        for (const auto &subsystem : subsystems) {
+            new QTreeWidgetItem(table, {QString::fromLatin1(subsystem.first), QString::number(subsystem.second)});
+            total += subsystem.second;
+        }
+        new QTreeWidgetItem(table, {"Total (estimated)", QString::number(total)});
+        const qint64 resident = MemoryAccounting::residentBytes();
+        if (resident >= 0)
+            new QTreeWidgetItem(table, {"Process RSS", QString::number(resident)});
+    };
+    refresh();
+    QTimer *refreshTimer = new QTimer(dialog); // Stops with the dialog
+    connect(refreshTimer, &QTimer::timeout, dialog, refresh);
+    refreshTimer->start(1000);
+
+    dialog->resize(360, 260);
+    dialog->show();
+}
+
+// --- Metrics ---
+void MainWindow::setupMetrics()
+{
+    m_httpServer->addRoute("/metrics", [](const HttpServer::Request &) {
+        HttpServer::Response response;
+        response.contentType = "text/plain; version=0.0.4";
+        response.body = MetricsRegistry::instance().render();
+        return response;
+    });
+
+    // Launch to first weight, phase by phase
+    m_httpServer->addRoute("/api/timeline", [](const HttpServer::Request &) {
+        HttpServer::Response response;
+        response.body = PhaseTimeline::instance().toJson();
+        return response;
+    });
+    MetricsRegistry::instance().addCollector(this, [](QByteArray &out) { PhaseTimeline::instance().appendMetrics(out); });
+
+    // Chrome trace JSON of the BLE lifecycle; POST {"enable":true|false} toggles recording and
+    // {"clear":true} empties the ring (not from GET, which any page can trigger)
+    m_httpServer->addRoute("/debug/trace", [](const HttpServer::Request &) {
+        HttpServer::Response response;
+        response.body = Tracer::instance().toChromeJson();
+        return response;
+    });
+    m_httpServer->addRoute("/debug/trace", [](const HttpServer::Request &request) {
+        Tracer &tracer = Tracer::instance();
+        const QJsonObject body = QJsonDocument::fromJson(request.body).object();
+        if (body.contains("enable"))
+            tracer.setEnabled(body.value("enable").toBool());
+        if (body.value("clear").toBool())
+            tracer.clear();
+        HttpServer::Response response;
+        response.body = QByteArray("{\"tracing\":") + (tracer.isEnabled() ? "true" : "false") + "}";
+        return response;
+    }, "POST");
+
+    MetricsRegistry::instance().addCollector(this, [this](QByteArray &out) { m_sampleBus->appendMetrics(out); });
+    MetricsRegistry::instance().addCollector(this, [this](QByteArray &out) {
+        MetricsRegistry::appendMetric(out, "blescale_decode_batches_total", "counter",
+                                      "Notification batches decoded.", m_decodeBatches);
+        MetricsRegistry::appendMetric(out, "blescale_sample_records_pooled", "gauge",
+                                      "Free sample records held for reuse.", SampleRef::pooledRecords());
+        if (AllocationCounter::isEnabled()) {
+            MetricsRegistry::appendMetric(out, "blescale_decode_allocations_total", "counter",
+                                          "Heap allocations made while decoding notification batches.", m_decodeAllocations);
+        }
+    });
+
+    // Sink state is owned by the sinks themselves; sample it only when scraped
+    MetricsRegistry::instance().addCollector(this, [this](QByteArray &out) {
+        const MqttPublisher::Stats mqtt = m_mqttPublisher->stats();
+        MetricsRegistry::appendMetric(out, "blescale_stream_clients", "gauge",
+                                      "Connected binary stream subscribers.", m_streamServer->clientCount());
+        MetricsRegistry::appendMetric(out, "blescale_stream_evicted_clients_total", "counter",
+                                      "Stream subscribers evicted for being too slow.", m_streamServer->evictedClients());
+        MetricsRegistry::appendMetric(out, "blescale_sse_clients", "gauge",
+                                      "Connected Server-Sent Events clients.", m_httpServer->streamClientCount());
+        MetricsRegistry::appendMetric(out, "blescale_sse_dropped_batches_total", "counter",
+                                      "SSE batches dropped for slow clients.", m_httpServer->droppedStreamBatches());
+        MetricsRegistry::appendMetric(out, "blescale_mqtt_queue_depth", "gauge",
+                                      "MQTT messages waiting to be published.", mqtt.queueDepth);
+        MetricsRegistry::appendMetric(out, "blescale_mqtt_inflight", "gauge",
+                                      "MQTT QoS 1 messages awaiting PUBACK.", mqtt.inflight);
+        MetricsRegistry::appendMetric(out, "blescale_mqtt_dropped_total", "counter",
+                                      "MQTT messages dropped by the overflow policy.", mqtt.dropped);
+        MetricsRegistry::appendMetric(out, "blescale_mqtt_coalesced_total", "counter",
+                                      "MQTT messages replaced by a newer one for the same topic.", mqtt.coalesced);
+        MetricsRegistry::appendMetric(out, "blescale_mqtt_publish_latency_seconds", "gauge",
+                                      "Average MQTT publish latency (EWMA).", mqtt.avgLatencyMs / 1000.0);
+        MetricsRegistry::appendMetric(out, "blescale_mqtt_connected", "gauge",
+                                      "1 while connected to the MQTT broker.", mqtt.connected ? 1 : 0);
+    });
+
+    MetricsRegistry::instance().addCollector(this, [this](QByteArray &out) {
+        struct Series { const char *name; const char *help; double (*value)(const CharacteristicStats &, qint64); };
+        static const Series series[] = {
+            {"blescale_characteristic_rate_hz", "Notification rate per characteristic.",
+             [](const CharacteristicStats &s, qint64 now) { return s.rateHz(now); }},
+            {"blescale_characteristic_jitter_seconds", "Smoothed inter-arrival jitter per characteristic.",
+             [](const CharacteristicStats &s, qint64) { return s.jitterMs() / 1000.0; }},
+            {"blescale_characteristic_longest_gap_seconds", "Longest gap between notifications per characteristic.",
+             [](const CharacteristicStats &s, qint64) { return s.longestGapMs() / 1000.0; }},
+            {"blescale_characteristic_sequence_gaps_total", "Sequence counter discontinuities per characteristic.",
+             [](const CharacteristicStats &s, qint64) { return double(s.sequenceGaps()); }},
+        };
+        const qint64 nowUs = CharacteristicStats::monotonicUs();
+        for (const Series &metric : series) {
+            out += QByteArray("# HELP ") + metric.name + ' ' + metric.help + '\n';
+            out += QByteArray("# TYPE ") + metric.name + (QByteArray(metric.name).endsWith("_total") ? " counter\n" : " gauge\n");
+            for (auto it = m_characteristicStats.constBegin(); it != m_characteristicStats.constEnd(); ++it) {
+                out += QByteArray(metric.name) + "{characteristic=\"" + it.key().toByteArray(QUuid::WithoutBraces)
+                       + "\"} " + QByteArray::number(metric.value(it.value(), nowUs), 'g', 12) + '\n';
+            }
+        }
+    });
+}
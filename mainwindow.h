@@ -4,8 +4,12 @@
 #include <QMainWindow>
 #include <QBluetoothDeviceDiscoveryAgent>
 #include <QBluetoothDeviceInfo>
+#include <QBluetoothHostInfo>
 #include <QListWidget>
+#include <QTreeWidget>
+#include <QTimer>
 #include <QComboBox>
+#include <QCheckBox>
 #include <QPushButton>
 #include <QVBoxLayout>
 #include <QLowEnergyController>
@@ -13,6 +17,30 @@
 #include <QLowEnergyCharacteristic>
 #include <QLabel>
 #include <QMap>
+#include <QHash>
+#include <functional>
+
+#include "calibration.h"
+#include "characteristicstats.h"
+#include "decoderpluginhost.h"
+#include "deviceregistry.h"
+#include "gattawait.h"
+#include "ingestmetrics.h"
+#include "latestvaluetable.h"
+#include "memoryaccounting.h"
+#include "sampledecoder.h"
+#include "stationconfig.h"
+#include "timingwheel.h"
+
+class HttpServer;
+class LinkQualityMonitor;
+class MqttPublisher;
+class NotificationWatchdog;
+class SampleBus;
+class ScriptDecoder;
+class SoakHarness;
+class StreamServer;
+class SyntheticStream;
 
 QT_BEGIN_NAMESPACE
 
@@ -46,9 +74,18 @@ class MainWindow : public QMainWindow
     Q_OBJECT
 
 public:
-    MainWindow(QWidget *parent = nullptr);
+    explicit MainWindow(const StationConfig &config, QWidget *parent = nullptr);
     ~MainWindow();
 
+signals:
+    void bluetoothReady(); // Discovery agent created; scanning is possible
+    void bluetoothUnavailable(const QString &reason); // Startup stopped short of bluetoothReady()
+    void memoryCheckFinished(bool passed); // --memory-check run is over
+    void soakFinished(bool passed); // --soak run is over
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
 private slots:
     void startScan();
     void deviceDiscovered(const QBluetoothDeviceInfo &device);
@@ -65,21 +102,29 @@ private slots:
 
     // New slots for service and characteristic interaction
     void onServiceSelected(); // Slot for when a service is selected in the list
-    void serviceDetailsDiscovered(QLowEnergyService::ServiceState newState);
     void characteristicChanged(const QLowEnergyCharacteristic &characteristic, const QByteArray &newValue);
     void characteristicRead(const QLowEnergyCharacteristic &characteristic, const QByteArray &value);
     void descriptorWritten(const QLowEnergyDescriptor &descriptor, const QByteArray &newValue);
+    void descriptorRead(const QLowEnergyDescriptor &descriptor, const QByteArray &value);
     void serviceError(QLowEnergyService::ServiceError error); // Service-specific errors
+    void scriptDecoded(const Sample &sample);
 
 private:
+    // Deferred Bluetooth startup
+    void initBluetooth();
+    void finishBluetoothInit(const QList<QBluetoothHostInfo> &adapters, bool poweredOff);
+
     Ui::MainWindow *ui; // This should be `nullptr` if not using .ui file
     QBluetoothDeviceDiscoveryAgent *discoveryAgent;
     QListWidget *deviceListWidget; // Will show devices initially, then services
-    QListWidget *characteristicListWidget; // New: To show characteristics and values
+    QTreeWidget *characteristicTreeWidget; // Characteristics, values and arrival statistics
     QPushButton *scanButton;
     QPushButton *connectButton;
+    QCheckBox *fastConnectCheckBox; // Auto-connect to an advertised weight scale and open only its service
     QPushButton *readCharButton; // New: Button to manually read selected characteristic
+    QPushButton *memoryButton; // Per-subsystem memory diagnostics
     QLabel *statusLabel;
+    QLabel *linkQualityLabel;
     QComboBox *deviceComboBox;
 
     QLowEnergyController *leController;
@@ -88,7 +133,118 @@ private:
 
     // Maps to manage discovered services and characteristics
     QMap<QBluetoothUuid, QLowEnergyService*> m_services; // Key: Service UUID, Value: Service object
-    QMap<QLowEnergyCharacteristic, QListWidgetItem*> m_characteristicItems; // Key: Characteristic, Value: List item for quick update
+    QMap<QLowEnergyCharacteristic, QTreeWidgetItem*> m_characteristicItems; // Key: Characteristic, Value: Table row for quick update
     QLowEnergyService *m_currentService; // The currently selected service
+    QLowEnergyService *createService(const QBluetoothUuid &uuid); // Service object wired to the slots below
+    std::function<QLowEnergyService *(const QBluetoothUuid &)> m_serviceFactory; // --soak; unset = leController's
+    bool servicesReady() const; // Discovery finished, a service can be opened
+
+    // Coroutine workflows (gattawait.h); cancelled whenever the connection is torn down
+    Gatt::Cancel m_gattCancel;
+    void cancelGattWorkflows();
+    void releaseServices(); // Deletes the service objects; forgets their UUIDs and table rows
+    Gatt::Task<> openServices(QList<QBluetoothUuid> uuids); // Discover, subscribe, read
+
+    // Decoded sample output
+    SampleDecoder m_decoder;
+    Calibration m_calibration; // Per-device correction and unit conversion, before every sink
+    QList<LayoutProgram> m_layouts; // Vendor characteristic layouts, compiled at startup
+    DecoderPluginHost m_decoderPlugins; // Vendor decoders loaded at startup
+    void selectDecoders(); // Plugins and layouts for the device being connected
+    ScriptDecoder *m_scriptDecoder; // JavaScript decoders on a worker thread; null without QtQml
+    void publishSample(Sample &sample, const QByteArray &payload); // Calibrate and publish on the sample bus
+    void setupCalibration();
+    StreamServer *m_streamServer; // Local TCP/QLocalSocket subscribers
+    LatestValueTable m_latestTable; // Shared-memory latest value per scale
+    HttpServer *m_httpServer; // REST + Server-Sent Events for dashboards
+    MqttPublisher *m_mqttPublisher; // Per-device topics on the plant broker
+    SampleBus *m_sampleBus; // Fans decoded samples out to the sinks and the UI
+
+    IngestMetrics m_ingestMetrics; // Served at /metrics
+    void setupMetrics();
+
+    // Estimated memory per subsystem (metrics, /api/memory, diagnostics dialog, --memory-check)
+    MemoryAccounting m_memory;
+    MemoryCheck *m_memoryCheck;
+    void setupMemoryAccounting();
+    void showMemoryUsage();
+
+    // Characteristic table columns and per-characteristic arrival statistics
+    enum CharacteristicTableColumn {
+        CharacteristicColumn,
+        PropertiesColumn,
+        ValueColumn,
+        DecodedColumn,
+        RateColumn,
+        JitterColumn,
+        LongestGapColumn,
+        SequenceGapsColumn
+    };
+    QTreeWidgetItem *addCharacteristicItem(const QLowEnergyCharacteristic &characteristic);
+    QTreeWidgetItem *characteristicItem(const QBluetoothUuid &uuid) const;
+    void setCharacteristicValue(QTreeWidgetItem *item, const QByteArray &value);
+    void subscribeToCharacteristic(QLowEnergyService *service, const QLowEnergyCharacteristic &characteristic);
+    void planDecoding(QLowEnergyService *service, const QLowEnergyCharacteristic &characteristic);
+    void applyFormatDescriptor(const QLowEnergyCharacteristic &characteristic, const QBluetoothUuid &descriptor, const QByteArray &value);
+    void refreshCharacteristicStats();
+    QHash<QBluetoothUuid, CharacteristicStats> m_characteristicStats;
+    QTimer *m_statsRefreshTimer;
+    void refreshCharacteristicValues();
+    QHash<QBluetoothUuid, QByteArray> m_pendingValues; // Latest payload not yet shown in the table
+    QTimer *m_valueRefreshTimer;
+
+    // Notifications are decoded in batches, once per event loop pass
+    struct PendingNotification {
+        QBluetoothUuid characteristic;
+        QByteArray payload;
+        qint64 timestampUs;
+    };
+    std::vector<PendingNotification> m_pendingNotifications; // Capacity kept between batches
+    bool m_decodeScheduled;
+    quint64 m_decodeBatches;
+    quint64 m_decodeAllocations; // Heap allocations while decoding; counted with CONFIG+=alloccount only
+    void decodeNotifications();
+
+    // Stall detection and recovery
+    void connectToDeviceInfo(const QBluetoothDeviceInfo &device);
+    void recoverStalledConnection();
+    NotificationWatchdog *m_watchdog;
+    bool m_reconnectAfterDisconnect;
+    QBluetoothUuid m_resumeServiceUuid; // Service to reopen once a reconnect has rediscovered services
+
+    // Timing wheel shared by all per-device deadlines
+    TimerService *m_timers;
+    struct DiscoveredDevice {
+        QString itemText; // deviceComboBox entry
+        TimingWheel::TimerId expiry = 0;
+    };
+    QHash<quint64, DiscoveredDevice> m_discoveredDevices; // Key: address
+    quint64 m_scanTraceId; // Tracer span of the running scan
+    void expireDevice(quint64 address);
+    void resetScanState(); // Everything startScan() does except starting the agent
+
+    // Scales connected before, listed without scanning and connectable from cached info
+    DeviceRegistry m_registry;
+    void showKnownDevices();
+    int deviceComboIndex(quint64 address) const;
+    bool subscribes(const QBluetoothUuid &characteristic) const; // Per-device profile, else the station's
+
+    // RSSI and notification health of the connected link
+    LinkQualityMonitor *m_linkQuality;
+    void showLinkQuality(int score, int rssiDbm);
+
+    // Unattended operation (command line / config file)
+    StationConfig m_config;
+    bool m_autostartDirect; // Connecting to a configured address without having scanned for it
+    TimingWheel::TimerId m_autostartRetry;
+    void startAutostart();
+    void scheduleAutostartRetry();
+    bool unattended() const { return m_config.autostart || simulated() || m_config.startupBenchmark; } // No dialogs
+    bool simulated() const { return m_config.memoryCheckMb > 0 || m_config.soakCycles > 0; } // Manual clock, no Bluetooth
+
+    // --soak and --memory-check drive the slots above directly
+    friend class SoakHarness;
+    friend class SyntheticStream;
+    SoakHarness *m_soak;
 };
 #endif // MAINWINDOW_H
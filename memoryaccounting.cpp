@@ -0,0 +1,161 @@
+#include "memoryaccounting.h"
+#include "metrics.h"
+#include <QDebug>
+#include <QFile>
+#include <algorithm>
+#if defined(Q_OS_LINUX) || defined(Q_OS_ANDROID)
+#include <unistd.h>
+#endif
+
+// --- MemoryAccounting ---
+void MemoryAccounting::addSubsystem(const QByteArray &name, Estimator estimator)
+{
+    m_estimators.append({name, std::move(estimator)});
+}
+
+QList<QPair<QByteArray, qint64>> MemoryAccounting::snapshot() const
+{
+    QMap<QByteArray, qint64> bySubsystem;
+    for (const auto &estimator : m_estimators)
+        bySubsystem[estimator.first] += estimator.second();
+    QList<QPair<QByteArray, qint64>> result;
+    for (auto it = bySubsystem.constBegin(); it != bySubsystem.constEnd(); ++it)
+        result.append({it.key(), it.value()});
+    return result;
+}
+
+qint64 MemoryAccounting::total() const
+{
+    qint64 sum = 0;
+    for (const auto &estimator : m_estimators)
+        sum += estimator.second();
+    return sum;
+}
+
+qint64 MemoryAccounting::residentBytes()
+{
+#if defined(Q_OS_LINUX) || defined(Q_OS_ANDROID)
+    // statm: size resident shared text lib data dt, in pages
+    QFile statm(QStringLiteral("/proc/self/statm"));
+    if (!statm.open(QIODevice::ReadOnly))
+        return -1;
+    const QList<QByteArray> fields = statm.readAll().split(' ');
+    if (fields.size() < 2)
+        return -1;
+    return fields.at(1).toLongLong() * sysconf(_SC_PAGESIZE);
+#else
+    return -1;
+#endif
+}
+
+void MemoryAccounting::appendMetrics(QByteArray &out) const
+{
+    out += "# HELP blescale_memory_bytes Estimated heap bytes held per subsystem.\n";
+    out += "# TYPE blescale_memory_bytes gauge\n";
+    const QList<QPair<QByteArray, qint64>> subsystems = snapshot();
+    for (const auto &subsystem : subsystems)
+        out += "blescale_memory_bytes{subsystem=\"" + subsystem.first + "\"} " + QByteArray::number(subsystem.second) + '\n';
+    const qint64 resident = residentBytes();
+    if (resident >= 0) {
+        MetricsRegistry::appendMetric(out, "blescale_process_resident_bytes", "gauge",
+                                      "Resident set size of the process.", double(resident));
+    }
+}
+
+QByteArray MemoryAccounting::toJson() const
+{
+    QByteArray json = "{\"subsystems\":{";
+    qint64 sum = 0;
+    const QList<QPair<QByteArray, qint64>> subsystems = snapshot();
+    for (int i = 0; i < subsystems.size(); ++i) {
+        if (i > 0)
+            json += ',';
+        json += '"' + subsystems.at(i).first + "\":" + QByteArray::number(subsystems.at(i).second);
+        sum += subsystems.at(i).second;
+    }
+    json += "},\"total\":" + QByteArray::number(sum) + ",\"resident\":" + QByteArray::number(residentBytes()) + '}';
+    return json;
+}
+
+// --- MemoryCheck ---
+MemoryCheck::MemoryCheck(const MemoryAccounting *accounting, TimerService *timers, QObject *parent)
+    : QObject(parent)
+    , m_accounting(accounting)
+    , m_timers(timers)
+    , m_thresholdBytes(0)
+    , m_endMs(0)
+    , m_intervalMs(60000)
+    , m_baselineTotal(0)
+    , m_baselineResident(-1)
+    , m_peakTotal(0)
+    , m_peakResident(-1)
+    , m_timer(0)
+{
+}
+
+void MemoryCheck::start(qint64 thresholdBytes, qint64 durationMs, qint64 warmupMs, qint64 intervalMs)
+{
+    m_thresholdBytes = thresholdBytes;
+    m_endMs = m_timers->nowMs() + durationMs;
+    m_intervalMs = qMax<qint64>(1, intervalMs);
+    m_timers->cancel(m_timer);
+    m_timer = m_timers->schedule(qMin(warmupMs, durationMs), [this]() { takeBaseline(); });
+    qDebug() << "Memory check: threshold" << thresholdBytes << "bytes over" << durationMs / 1000 << "s after"
+             << warmupMs / 1000 << "s warm-up";
+}
+
+void MemoryCheck::takeBaseline()
+{
+    m_baselineTotal = m_peakTotal = m_accounting->total();
+    m_baselineResident = m_peakResident = MemoryAccounting::residentBytes();
+    m_baselineSubsystems.clear();
+    const QList<QPair<QByteArray, qint64>> subsystems = m_accounting->snapshot();
+    for (const auto &subsystem : subsystems)
+        m_baselineSubsystems.insert(subsystem.first, subsystem.second);
+    sample();
+}
+
+void MemoryCheck::sample()
+{
+    m_peakTotal = qMax(m_peakTotal, m_accounting->total());
+    m_peakResident = qMax(m_peakResident, MemoryAccounting::residentBytes());
+    const qint64 remainingMs = m_endMs - m_timers->nowMs();
+    if (remainingMs <= 0) {
+        finish();
+        return;
+    }
+    m_timer = m_timers->schedule(qMin(m_intervalMs, remainingMs), [this]() { sample(); });
+}
+
+// Judged on the final sample against the baseline; peaks are reported but transient growth that
+// is given back does not fail the run
+void MemoryCheck::finish()
+{
+    m_timer = 0;
+    const qint64 total = m_accounting->total();
+    const qint64 resident = MemoryAccounting::residentBytes();
+    const qint64 totalGrowth = total - m_baselineTotal;
+    const qint64 residentGrowth = resident >= 0 && m_baselineResident >= 0 ? resident - m_baselineResident : 0;
+    const bool passed = totalGrowth <= m_thresholdBytes && residentGrowth <= m_thresholdBytes;
+
+    QString report = QString("Memory check %1: accounted %2 -> %3 bytes (peak %4), RSS %5 -> %6 bytes (peak %7), threshold %8")
+                         .arg(passed ? "passed" : "FAILED")
+                         .arg(m_baselineTotal).arg(total).arg(m_peakTotal)
+                         .arg(m_baselineResident).arg(resident).arg(m_peakResident)
+                         .arg(m_thresholdBytes);
+
+    // Largest growers first, so a failure names the suspect
+    QList<QPair<qint64, QByteArray>> growth;
+    const QList<QPair<QByteArray, qint64>> subsystems = m_accounting->snapshot();
+    for (const auto &subsystem : subsystems)
+        growth.append({subsystem.second - m_baselineSubsystems.value(subsystem.first), subsystem.first});
+    std::sort(growth.begin(), growth.end(), [](const auto &a, const auto &b) { return a.first > b.first; });
+    for (const auto &grower : std::as_const(growth))
+        report += QString("\n  %1: %2%3 bytes").arg(QString::fromLatin1(grower.second), grower.first >= 0 ? "+" : "").arg(grower.first);
+
+    if (passed)
+        qDebug().noquote() << report;
+    else
+        qCritical().noquote() << report;
+    emit finished(passed, report);
+}
@@ -0,0 +1,92 @@
+#ifndef MEMORYACCOUNTING_H
+#define MEMORYACCOUNTING_H
+
+#include "timingwheel.h"
+
+#include <QObject>
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QPair>
+#include <QString>
+#include <functional>
+
+// Approximate heap bytes held per subsystem, to tell which part of a long-running station grows.
+//
+// Subsystems report their own estimate from the containers they own: element storage by
+// capacity plus the heap parts of the elements (strings, buffers, socket write queues). Estimates
+// are only taken when asked for (metrics scrape, diagnostics view, memory check), never on the
+// notification path. Several estimators may report under one subsystem name; they are summed.
+// Process RSS is reported alongside, so the unaccounted remainder (Qt, the Bluetooth stack,
+// allocator slack) is visible too.
+class MemoryAccounting
+{
+public:
+    using Estimator = std::function<qint64()>;
+
+    void addSubsystem(const QByteArray &name, Estimator estimator);
+
+    QList<QPair<QByteArray, qint64>> snapshot() const; // Per subsystem, by name
+    qint64 total() const;
+    static qint64 residentBytes(); // Process RSS; -1 where unknown
+
+    void appendMetrics(QByteArray &out) const;
+    QByteArray toJson() const;
+
+    // Shallow sizes for estimators; add the heap parts of the elements separately
+    template<typename T>
+    static qint64 containerBytes(const QList<T> &list) { return qint64(list.capacity()) * qint64(sizeof(T)); }
+    template<typename Key, typename T>
+    static qint64 containerBytes(const QHash<Key, T> &hash)
+    {
+        return qint64(hash.capacity()) * qint64(sizeof(Key) + sizeof(T) + 1); // Qt 6 spans: entry + offset byte
+    }
+    template<typename Key, typename T>
+    static qint64 containerBytes(const QMap<Key, T> &map)
+    {
+        return qint64(map.size()) * qint64(sizeof(Key) + sizeof(T) + 4 * sizeof(void *)); // Red-black tree node
+    }
+    static qint64 bytes(const QByteArray &array) { return array.capacity(); }
+    static qint64 bytes(const QString &string) { return qint64(string.capacity()) * qint64(sizeof(QChar)); }
+
+private:
+    QList<QPair<QByteArray, Estimator>> m_estimators;
+};
+
+// Test mode for soak runs: after a warm-up, fails if either the accounted total or the process
+// RSS grows by more than the threshold before the run ends. Time is taken from the TimerService;
+// --memory-check puts it on the manual clock and streams from a SyntheticStream, so an hour of
+// streaming is checked in however long it takes to replay.
+class MemoryCheck : public QObject
+{
+    Q_OBJECT
+
+public:
+    MemoryCheck(const MemoryAccounting *accounting, TimerService *timers, QObject *parent = nullptr);
+
+    // Baseline after warmupMs, then a sample every intervalMs until durationMs
+    void start(qint64 thresholdBytes, qint64 durationMs, qint64 warmupMs, qint64 intervalMs = 60000);
+
+signals:
+    void finished(bool passed, const QString &report);
+
+private:
+    void takeBaseline();
+    void sample();
+    void finish();
+
+    const MemoryAccounting *m_accounting;
+    TimerService *m_timers;
+    qint64 m_thresholdBytes;
+    qint64 m_endMs;
+    qint64 m_intervalMs;
+    qint64 m_baselineTotal;
+    qint64 m_baselineResident;
+    qint64 m_peakTotal;
+    qint64 m_peakResident;
+    QHash<QByteArray, qint64> m_baselineSubsystems;
+    TimingWheel::TimerId m_timer;
+};
+
+#endif // MEMORYACCOUNTING_H
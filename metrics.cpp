@@ -0,0 +1,141 @@
+#include "metrics.h"
+
+namespace {
+QByteArray typeName(int type)
+{
+    switch (type) {
+    case 0: return "counter";
+    case 1: return "gauge";
+    default: return "histogram";
+    }
+}
+
+QByteArray labelSet(const QByteArray &labels, const QByteArray &extra = QByteArray())
+{
+    if (labels.isEmpty() && extra.isEmpty())
+        return QByteArray();
+    if (labels.isEmpty())
+        return '{' + extra + '}';
+    if (extra.isEmpty())
+        return '{' + labels + '}';
+    return '{' + labels + ',' + extra + '}';
+}
+}
+
+MetricsRegistry &MetricsRegistry::instance()
+{
+    static MetricsRegistry registry;
+    return registry;
+}
+
+void *MetricsRegistry::find(const QByteArray &name, const QByteArray &labels, Type type) const
+{
+    for (const Entry &entry : m_entries) {
+        if (entry.name == name && entry.labels == labels && entry.type == type)
+            return entry.metric;
+    }
+    return nullptr;
+}
+
+Counter *MetricsRegistry::counter(const QByteArray &name, const QByteArray &help, const QByteArray &labels)
+{
+    if (void *existing = find(name, labels, CounterType))
+        return static_cast<Counter *>(existing);
+    m_counters.emplace_back();
+    m_entries.append({name, help, labels, CounterType, &m_counters.back()});
+    return &m_counters.back();
+}
+
+Gauge *MetricsRegistry::gauge(const QByteArray &name, const QByteArray &help, const QByteArray &labels)
+{
+    if (void *existing = find(name, labels, GaugeType))
+        return static_cast<Gauge *>(existing);
+    m_gauges.emplace_back();
+    m_entries.append({name, help, labels, GaugeType, &m_gauges.back()});
+    return &m_gauges.back();
+}
+
+Histogram *MetricsRegistry::histogram(const QByteArray &name, const QByteArray &help, const QByteArray &labels)
+{
+    if (void *existing = find(name, labels, HistogramType))
+        return static_cast<Histogram *>(existing);
+    m_histograms.emplace_back();
+    m_entries.append({name, help, labels, HistogramType, &m_histograms.back()});
+    return &m_histograms.back();
+}
+
+void MetricsRegistry::removeCollectors(const void *owner)
+{
+    m_collectors.removeIf([owner](const QPair<const void *, Collector> &collector) {
+        return collector.first == owner;
+    });
+}
+
+void MetricsRegistry::appendMetric(QByteArray &out, const QByteArray &name, const QByteArray &type,
+                                   const QByteArray &help, double value, const QByteArray &labels)
+{
+    out += "# HELP " + name + ' ' + help + '\n';
+    out += "# TYPE " + name + ' ' + type + '\n';
+    out += name + labelSet(labels) + ' ' + QByteArray::number(value, 'g', 12) + '\n';
+}
+
+QByteArray MetricsRegistry::render() const
+{
+    QByteArray out;
+    out.reserve(8192);
+
+    // Samples sharing a name must be grouped under one HELP/TYPE header
+    QList<QByteArray> names;
+    for (const Entry &entry : m_entries) {
+        if (!names.contains(entry.name))
+            names.append(entry.name);
+    }
+
+    for (const QByteArray &name : std::as_const(names)) {
+        bool headerWritten = false;
+        for (const Entry &entry : m_entries) {
+            if (entry.name != name)
+                continue;
+            if (!headerWritten) {
+                out += "# HELP " + name + ' ' + entry.help + '\n';
+                out += "# TYPE " + name + ' ' + typeName(entry.type) + '\n';
+                headerWritten = true;
+            }
+
+            switch (entry.type) {
+            case CounterType:
+                out += name + labelSet(entry.labels) + ' '
+                       + QByteArray::number(static_cast<const Counter *>(entry.metric)->value()) + '\n';
+                break;
+            case GaugeType:
+                out += name + labelSet(entry.labels) + ' '
+                       + QByteArray::number(static_cast<const Gauge *>(entry.metric)->value()) + '\n';
+                break;
+            case HistogramType: {
+                const Histogram *histogram = static_cast<const Histogram *>(entry.metric);
+                // Every bucket on every scrape, so rate() and histogram_quantile() see a stable
+                // set of series. The last bucket is open-ended and only reported as +Inf.
+                quint64 cumulative = 0;
+                for (int i = 0; i < Histogram::BucketCount - 1; ++i) {
+                    cumulative += histogram->bucket(i);
+                    const double le = double(quint64(1) << i) / 1e6;
+                    out += name + "_bucket" + labelSet(entry.labels, "le=\"" + QByteArray::number(le, 'g', 12) + '"')
+                           + ' ' + QByteArray::number(cumulative) + '\n';
+                }
+                cumulative += histogram->bucket(Histogram::BucketCount - 1);
+                out += name + "_bucket" + labelSet(entry.labels, "le=\"+Inf\"") + ' '
+                       + QByteArray::number(cumulative) + '\n';
+                out += name + "_sum" + labelSet(entry.labels) + ' '
+                       + QByteArray::number(histogram->sumUs() / 1e6, 'g', 12) + '\n';
+                out += name + "_count" + labelSet(entry.labels) + ' ' + QByteArray::number(cumulative) + '\n';
+                break;
+            }
+            }
+        }
+    }
+
+    for (const auto &collector : m_collectors)
+        collector.second(out);
+
+    return out;
+}
@@ -0,0 +1,104 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <QByteArray>
+#include <QtAlgorithms>
+#include <QList>
+#include <QPair>
+#include <atomic>
+#include <deque>
+#include <functional>
+
+// Lock-free counters, gauges and histograms rendered in the Prometheus text exposition format.
+//
+// Metric objects are created once through MetricsRegistry and then updated on the hot path with a
+// single relaxed atomic operation (histograms: two), so instrumenting the notification path costs
+// a few nanoseconds. Values that already live elsewhere (queue depths, memory usage) are reported
+// by collectors that run only when the endpoint is scraped.
+
+class Counter
+{
+public:
+    void inc(quint64 n = 1) { m_value.fetch_add(n, std::memory_order_relaxed); }
+    quint64 value() const { return m_value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<quint64> m_value{0};
+};
+
+class Gauge
+{
+public:
+    void set(qint64 v) { m_value.store(v, std::memory_order_relaxed); }
+    void add(qint64 n) { m_value.fetch_add(n, std::memory_order_relaxed); }
+    qint64 value() const { return m_value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<qint64> m_value{0};
+};
+
+// Power-of-two buckets over microseconds: bucket i counts observations <= 2^i us (1 us .. ~36 min).
+class Histogram
+{
+public:
+    static constexpr int BucketCount = 32;
+
+    void observeUs(quint64 us)
+    {
+        const int index = us <= 1 ? 0 : qMin(BucketCount - 1, 64 - int(qCountLeadingZeroBits(us - 1)));
+        m_buckets[index].fetch_add(1, std::memory_order_relaxed);
+        m_sumUs.fetch_add(us, std::memory_order_relaxed);
+    }
+
+    quint64 bucket(int index) const { return m_buckets[index].load(std::memory_order_relaxed); }
+    quint64 sumUs() const { return m_sumUs.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<quint64> m_buckets[BucketCount] = {};
+    std::atomic<quint64> m_sumUs{0};
+};
+
+class MetricsRegistry
+{
+public:
+    using Collector = std::function<void(QByteArray &out)>;
+
+    static MetricsRegistry &instance();
+
+    // Returned pointers stay valid for the lifetime of the process.
+    // `labels` is the Prometheus label set without braces, e.g. characteristic="2a9d".
+    Counter *counter(const QByteArray &name, const QByteArray &help, const QByteArray &labels = QByteArray());
+    Gauge *gauge(const QByteArray &name, const QByteArray &help, const QByteArray &labels = QByteArray());
+    Histogram *histogram(const QByteArray &name, const QByteArray &help, const QByteArray &labels = QByteArray());
+
+    // Collectors are removed by owner, typically from the owner's destructor
+    void addCollector(const void *owner, Collector collector) { m_collectors.append({owner, std::move(collector)}); }
+    void removeCollectors(const void *owner);
+
+    QByteArray render() const;
+
+    // For collectors: emits HELP/TYPE lines followed by a single sample
+    static void appendMetric(QByteArray &out, const QByteArray &name, const QByteArray &type,
+                             const QByteArray &help, double value, const QByteArray &labels = QByteArray());
+
+private:
+    enum Type { CounterType, GaugeType, HistogramType };
+
+    struct Entry {
+        QByteArray name;
+        QByteArray help;
+        QByteArray labels;
+        Type type;
+        void *metric;
+    };
+
+    void *find(const QByteArray &name, const QByteArray &labels, Type type) const;
+
+    std::deque<Counter> m_counters;
+    std::deque<Gauge> m_gauges;
+    std::deque<Histogram> m_histograms;
+    QList<Entry> m_entries;
+    QList<QPair<const void *, Collector>> m_collectors;
+};
+
+#endif // METRICS_H
@@ -0,0 +1,415 @@
+#include "mqttpublisher.h"
+#include "memoryaccounting.h"
+#include "samplejson.h"
+#include <QBluetoothAddress>
+#include <QDebug>
+#include <QTcpSocket>
+#include <algorithm>
+
+namespace {
+constexpr quint8 PacketConnect = 0x10;
+constexpr quint8 PacketConnAck = 0x20;
+constexpr quint8 PacketPublish = 0x30;
+constexpr quint8 PacketPubAck = 0x40;
+constexpr quint8 PacketPingReq = 0xC0;
+constexpr quint8 PacketPingResp = 0xD0;
+constexpr quint8 PacketDisconnect = 0xE0;
+
+constexpr qint64 SocketHighWaterBytes = 64 * 1024;
+constexpr int MinReconnectDelayMs = 1000;
+constexpr int MaxReconnectDelayMs = 30000;
+}
+
+MqttPublisher::MqttPublisher(QObject *parent)
+    : QObject(parent)
+    , m_socket(new QTcpSocket(this))
+    , m_connected(false)
+    , m_running(false)
+    , m_reconnectDelayMs(MinReconnectDelayMs)
+    , m_nextPacketId(1)
+    , m_published(0)
+    , m_dropped(0)
+    , m_coalesced(0)
+    , m_avgLatencyMs(0.0)
+    , m_maxLatencyMs(0)
+{
+    m_clock.start();
+
+    connect(m_socket, &QTcpSocket::connected, this, &MqttPublisher::onConnected);
+    connect(m_socket, &QTcpSocket::disconnected, this, &MqttPublisher::onDisconnected);
+    connect(m_socket, &QTcpSocket::readyRead, this, &MqttPublisher::onReadyRead);
+    connect(m_socket, &QTcpSocket::bytesWritten, this, [this]() { pump(); });
+    connect(m_socket, &QTcpSocket::errorOccurred, this, [this](QAbstractSocket::SocketError error) {
+        qDebug() << "MQTT socket error:" << error << m_socket->errorString();
+        if (m_socket->state() != QAbstractSocket::ConnectedState)
+            scheduleReconnect();
+    });
+
+    m_batchTimer.setSingleShot(true);
+    connect(&m_batchTimer, &QTimer::timeout, this, &MqttPublisher::flushBatches);
+    connect(&m_pingTimer, &QTimer::timeout, this, &MqttPublisher::sendPing);
+    m_pingDeadline.setSingleShot(true);
+    connect(&m_pingDeadline, &QTimer::timeout, this, &MqttPublisher::pingTimedOut);
+    m_reconnectTimer.setSingleShot(true);
+    connect(&m_reconnectTimer, &QTimer::timeout, this, &MqttPublisher::reconnect);
+}
+
+MqttPublisher::~MqttPublisher()
+{
+    stop();
+}
+
+void MqttPublisher::start()
+{
+    m_running = true;
+    m_reconnectDelayMs = MinReconnectDelayMs;
+    reconnect();
+}
+
+void MqttPublisher::stop()
+{
+    m_running = false;
+    m_reconnectTimer.stop();
+    m_pingTimer.stop();
+    m_pingDeadline.stop();
+    if (m_connected) {
+        QByteArray packet;
+        packet.append(char(PacketDisconnect));
+        packet.append(char(0));
+        m_socket->write(packet);
+        m_socket->flush();
+    }
+    m_socket->abort();
+    m_connected = false;
+}
+
+void MqttPublisher::reconnect()
+{
+    if (!m_running || m_socket->state() != QAbstractSocket::UnconnectedState)
+        return;
+    m_readBuffer.clear();
+    m_socket->connectToHost(m_settings.host, m_settings.port);
+}
+
+void MqttPublisher::scheduleReconnect()
+{
+    if (!m_running || m_reconnectTimer.isActive())
+        return;
+    m_reconnectTimer.start(m_reconnectDelayMs);
+    m_reconnectDelayMs = qMin(m_reconnectDelayMs * 2, MaxReconnectDelayMs);
+}
+
+MqttPublisher::Stats MqttPublisher::stats() const
+{
+    Stats stats;
+    stats.queueDepth = m_queue.size();
+    stats.inflight = m_inflight.size();
+    stats.published = m_published;
+    stats.dropped = m_dropped;
+    stats.coalesced = m_coalesced;
+    stats.avgLatencyMs = m_avgLatencyMs;
+    stats.maxLatencyMs = m_maxLatencyMs;
+    stats.connected = m_connected;
+    return stats;
+}
+
+QByteArray MqttPublisher::topicFor(quint64 device) const
+{
+    return m_settings.topicPrefix.toUtf8() + '/'
+           + QBluetoothAddress(device).toString().remove(':').toLatin1();
+}
+
+// --- Publishing ---
+void MqttPublisher::publish(const Sample &sample)
+{
+    if (!m_running)
+        return;
+
+    const QByteArray topic = topicFor(sample.device);
+    if (m_settings.batchIntervalMs <= 0) {
+        enqueue({topic, '[' + SampleJson::toJson(sample) + ']', m_clock.elapsed(), 0, false});
+        return;
+    }
+
+    Batch &batch = m_batches[topic];
+    if (batch.items.isEmpty())
+        batch.firstMs = m_clock.elapsed();
+    else
+        batch.items += ',';
+    SampleJson::append(batch.items, sample);
+    if (!m_batchTimer.isActive())
+        m_batchTimer.start(m_settings.batchIntervalMs);
+}
+
+void MqttPublisher::flushBatches()
+{
+    for (auto it = m_batches.begin(); it != m_batches.end(); ++it) {
+        if (it->items.isEmpty())
+            continue;
+        enqueue({it.key(), '[' + it->items + ']', it->firstMs, 0, false});
+        it->items.clear();
+    }
+}
+
+void MqttPublisher::enqueue(Message message)
+{
+    if (m_queue.size() >= m_settings.maxQueue) {
+        switch (m_settings.overflowPolicy) {
+        case DropOldest:
+            m_queue.removeFirst();
+            ++m_dropped;
+            break;
+        case DropNewest:
+            ++m_dropped;
+            return;
+        case CoalesceLatest: {
+            bool replaced = false;
+            for (Message &queued : m_queue) {
+                if (queued.topic == message.topic) {
+                    queued.payload = message.payload;
+                    ++m_coalesced;
+                    replaced = true;
+                    break;
+                }
+            }
+            if (replaced) {
+                pump();
+                return;
+            }
+            m_queue.removeFirst(); // No message for this topic queued; fall back to dropping the oldest
+            ++m_dropped;
+            break;
+        }
+        }
+    }
+    m_queue.append(std::move(message));
+    pump();
+}
+
+void MqttPublisher::pump()
+{
+    if (!m_connected)
+        return;
+
+    while (!m_queue.isEmpty()) {
+        if (m_settings.qos > 0 && m_inflight.size() >= m_settings.maxInflight)
+            return; // Wait for PUBACKs
+        if (m_socket->bytesToWrite() > SocketHighWaterBytes)
+            return; // Wait for bytesWritten
+        Message message = m_queue.takeFirst();
+        sendPublish(message);
+    }
+}
+
+void MqttPublisher::sendPublish(Message &message)
+{
+    const int qos = qBound(0, m_settings.qos, 1);
+    if (qos > 0 && message.packetId == 0) {
+        message.packetId = m_nextPacketId++;
+        if (m_nextPacketId == 0)
+            m_nextPacketId = 1;
+    }
+
+    QByteArray packet;
+    const int remaining = 2 + message.topic.size() + (qos > 0 ? 2 : 0) + message.payload.size();
+    packet.reserve(remaining + 5);
+    packet.append(char(PacketPublish | (message.duplicate ? 0x08 : 0) | (qos << 1)));
+    appendRemainingLength(packet, remaining);
+    appendString(packet, message.topic);
+    if (qos > 0) {
+        packet.append(char(message.packetId >> 8));
+        packet.append(char(message.packetId & 0xFF));
+    }
+    packet.append(message.payload);
+    m_socket->write(packet);
+
+    if (qos > 0) {
+        m_inflight.insert(message.packetId, message);
+    } else {
+        ++m_published;
+        recordLatency(m_clock.elapsed() - message.enqueuedMs);
+    }
+}
+
+void MqttPublisher::recordLatency(qint64 latencyMs)
+{
+    m_avgLatencyMs = m_published <= 1 ? double(latencyMs) : m_avgLatencyMs * 0.9 + latencyMs * 0.1;
+    m_maxLatencyMs = qMax(m_maxLatencyMs, latencyMs);
+}
+
+// --- Connection ---
+void MqttPublisher::onConnected()
+{
+    const QByteArray clientId = m_settings.clientId.toUtf8();
+    QByteArray packet;
+    packet.append(char(PacketConnect));
+    appendRemainingLength(packet, 10 + 2 + clientId.size());
+    appendString(packet, "MQTT");
+    packet.append(char(4));    // Protocol level 3.1.1
+    packet.append(char(0x02)); // Clean session
+    packet.append(char(m_settings.keepAliveSecs >> 8));
+    packet.append(char(m_settings.keepAliveSecs & 0xFF));
+    appendString(packet, clientId);
+    m_socket->write(packet);
+}
+
+void MqttPublisher::onDisconnected()
+{
+    const bool wasConnected = m_connected;
+    m_connected = false;
+    m_pingTimer.stop();
+    m_pingDeadline.stop();
+
+    // Unacknowledged QoS 1 messages go back to the front of the queue and are resent as duplicates
+    QList<Message> resend = m_inflight.values();
+    std::sort(resend.begin(), resend.end(), [](const Message &a, const Message &b) {
+        return a.enqueuedMs < b.enqueuedMs;
+    });
+    for (auto it = resend.rbegin(); it != resend.rend(); ++it) {
+        it->duplicate = true;
+        m_queue.prepend(*it);
+    }
+    m_inflight.clear();
+    while (m_queue.size() > m_settings.maxQueue) {
+        m_queue.removeFirst();
+        ++m_dropped;
+    }
+
+    if (wasConnected) {
+        qWarning() << "MQTT broker connection lost";
+        emit connectedChanged(false);
+    }
+    scheduleReconnect();
+}
+
+void MqttPublisher::onReadyRead()
+{
+    m_readBuffer += m_socket->readAll();
+
+    for (;;) {
+        if (m_readBuffer.size() < 2)
+            return;
+
+        // Remaining length is a 1-4 byte varint
+        int length = 0;
+        int multiplier = 1;
+        int pos = 1;
+        for (;; ++pos) {
+            if (pos >= m_readBuffer.size())
+                return; // Need more data
+            const quint8 byte = quint8(m_readBuffer.at(pos));
+            length += (byte & 0x7F) * multiplier;
+            multiplier *= 128;
+            if (!(byte & 0x80))
+                break;
+            if (pos == 4) {
+                qWarning() << "MQTT: malformed remaining length, dropping connection";
+                m_socket->abort();
+                return;
+            }
+        }
+        const int headerSize = pos + 1;
+        if (m_readBuffer.size() < headerSize + length)
+            return;
+
+        const quint8 header = quint8(m_readBuffer.at(0));
+        const QByteArray body = m_readBuffer.mid(headerSize, length);
+        m_readBuffer.remove(0, headerSize + length);
+        handlePacket(header, body);
+    }
+}
+
+void MqttPublisher::handlePacket(quint8 header, const QByteArray &body)
+{
+    switch (header & 0xF0) {
+    case PacketConnAck:
+        if (body.size() >= 2 && body.at(1) == 0) {
+            qDebug() << "MQTT connected to" << m_settings.host << m_settings.port;
+            m_connected = true;
+            m_reconnectDelayMs = MinReconnectDelayMs;
+            if (m_settings.keepAliveSecs > 0)
+                m_pingTimer.start(m_settings.keepAliveSecs * 500);
+            emit connectedChanged(true);
+            pump();
+        } else {
+            qWarning() << "MQTT connection refused, return code" << (body.size() >= 2 ? int(body.at(1)) : -1);
+            m_socket->abort();
+        }
+        break;
+    case PacketPubAck:
+        if (body.size() >= 2) {
+            const quint16 id = quint16((quint8(body.at(0)) << 8) | quint8(body.at(1)));
+            auto it = m_inflight.find(id);
+            if (it != m_inflight.end()) {
+                ++m_published;
+                recordLatency(m_clock.elapsed() - it->enqueuedMs);
+                m_inflight.erase(it);
+                pump();
+            }
+        }
+        break;
+    case PacketPingResp:
+        m_pingDeadline.stop();
+        break;
+    default:
+        qDebug() << "MQTT: ignoring packet type" << (header >> 4);
+        break;
+    }
+}
+
+void MqttPublisher::sendPing()
+{
+    if (!m_connected)
+        return;
+    QByteArray packet;
+    packet.append(char(PacketPingReq));
+    packet.append(char(0));
+    m_socket->write(packet);
+    if (!m_pingDeadline.isActive()) // An earlier ping still unanswered keeps its deadline
+        m_pingDeadline.start(m_settings.keepAliveSecs * 1000);
+}
+
+void MqttPublisher::pingTimedOut()
+{
+    qWarning() << "MQTT: no PINGRESP within" << m_settings.keepAliveSecs << "s, dropping the connection";
+    m_socket->abort();
+    if (m_connected)
+        onDisconnected(); // Requeues in-flight messages and schedules the reconnect
+}
+
+// --- Encoding helpers ---
+void MqttPublisher::appendRemainingLength(QByteArray &out, int length)
+{
+    do {
+        quint8 byte = length % 128;
+        length /= 128;
+        if (length > 0)
+            byte |= 0x80;
+        out.append(char(byte));
+    } while (length > 0);
+}
+
+void MqttPublisher::appendString(QByteArray &out, const QByteArray &value)
+{
+    out.append(char(value.size() >> 8));
+    out.append(char(value.size() & 0xFF));
+    out.append(value);
+}
+
+qint64 MqttPublisher::memoryUsage() const
+{
+    const auto messageBytes = [](const Message &message) {
+        return MemoryAccounting::bytes(message.topic) + MemoryAccounting::bytes(message.payload);
+    };
+    qint64 bytes = MemoryAccounting::containerBytes(m_batches) + MemoryAccounting::containerBytes(m_queue)
+                   + MemoryAccounting::containerBytes(m_inflight) + MemoryAccounting::bytes(m_readBuffer);
+    for (auto it = m_batches.constBegin(); it != m_batches.constEnd(); ++it)
+        bytes += MemoryAccounting::bytes(it.key()) + MemoryAccounting::bytes(it.value().items);
+    for (const Message &message : m_queue)
+        bytes += messageBytes(message);
+    for (const Message &message : m_inflight)
+        bytes += messageBytes(message);
+    if (m_socket)
+        bytes += m_socket->bytesToWrite();
+    return bytes;
+}
@@ -0,0 +1,137 @@
+#ifndef MQTTPUBLISHER_H
+#define MQTTPUBLISHER_H
+
+#include "sample.h"
+
+#include <QObject>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QTimer>
+
+class QTcpSocket;
+
+// Publishes decoded samples to an MQTT 3.1.1 broker, one topic per device:
+//   <topicPrefix>/<address without colons>   payload: JSON array of samples
+//
+// Samples for the same topic arriving within batchInterval() are merged into one message.
+// Messages wait in a bounded queue; with QoS 1 at most maxInflight() are unacknowledged at any
+// time, with QoS 0 sending pauses while the socket buffer is above its high-water mark. When the
+// queue is full the configured OverflowPolicy decides what is lost. Publish latency is measured
+// from enqueue to PUBACK (QoS 1) or to the socket write (QoS 0).
+//
+// Only the subset of MQTT needed for publishing is implemented (CONNECT, PUBLISH, PUBACK, PING).
+// A PINGREQ not answered within the keep-alive interval means a half-open connection: it is
+// dropped and re-established, and in-flight messages are resent.
+class MqttPublisher : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum OverflowPolicy {
+        DropOldest,     // Discard the head of the queue
+        DropNewest,     // Discard the incoming message
+        CoalesceLatest, // Replace the queued message for the same topic with the newest one
+    };
+
+    struct Settings {
+        QString host = QStringLiteral("127.0.0.1");
+        quint16 port = 1883;
+        QString clientId = QStringLiteral("blescaleqt");
+        QString topicPrefix = QStringLiteral("blescale");
+        int qos = 0;                 // 0 or 1
+        int batchIntervalMs = 50;    // 0 publishes every sample individually
+        int maxQueue = 1000;         // Messages
+        int maxInflight = 16;        // QoS 1 window
+        int keepAliveSecs = 30;
+        OverflowPolicy overflowPolicy = CoalesceLatest;
+    };
+
+    struct Stats {
+        int queueDepth = 0;
+        int inflight = 0;
+        quint64 published = 0;
+        quint64 dropped = 0;
+        quint64 coalesced = 0;
+        double avgLatencyMs = 0.0;   // EWMA
+        qint64 maxLatencyMs = 0;
+        bool connected = false;
+    };
+
+    explicit MqttPublisher(QObject *parent = nullptr);
+    ~MqttPublisher();
+
+    void setSettings(const Settings &settings) { m_settings = settings; }
+    const Settings &settings() const { return m_settings; }
+
+    void start();
+    void stop();
+
+    void publish(const Sample &sample);
+
+    Stats stats() const;
+    qint64 memoryUsage() const; // Batches, queue, in-flight messages and socket buffers, see MemoryAccounting
+
+signals:
+    void connectedChanged(bool connected);
+
+private slots:
+    void onConnected();
+    void onDisconnected();
+    void onReadyRead();
+    void flushBatches();
+    void sendPing();
+    void pingTimedOut();
+    void reconnect();
+
+private:
+    struct Message {
+        QByteArray topic;
+        QByteArray payload;      // JSON array
+        qint64 enqueuedMs;
+        quint16 packetId;
+        bool duplicate;
+    };
+    struct Batch {
+        QByteArray items;        // Comma separated JSON objects
+        qint64 firstMs;
+    };
+
+    void enqueue(Message message);
+    void pump();
+    void sendPublish(Message &message);
+    void recordLatency(qint64 latencyMs);
+    void handlePacket(quint8 header, const QByteArray &body);
+    void scheduleReconnect();
+    QByteArray topicFor(quint64 device) const;
+
+    static void appendRemainingLength(QByteArray &out, int length);
+    static void appendString(QByteArray &out, const QByteArray &value);
+
+    Settings m_settings;
+    QTcpSocket *m_socket;
+    bool m_connected;
+    bool m_running;
+    QElapsedTimer m_clock;
+    QTimer m_batchTimer;
+    QTimer m_pingTimer;
+    QTimer m_pingDeadline; // Running from PINGREQ until PINGRESP
+    QTimer m_reconnectTimer;
+    int m_reconnectDelayMs;
+
+    QHash<QByteArray, Batch> m_batches;  // topic -> samples not yet turned into a message
+    QList<Message> m_queue;
+    QHash<quint16, Message> m_inflight;  // QoS 1 packet id -> message awaiting PUBACK
+    quint16 m_nextPacketId;
+    QByteArray m_readBuffer;
+
+    quint64 m_published;
+    quint64 m_dropped;
+    quint64 m_coalesced;
+    double m_avgLatencyMs;
+    qint64 m_maxLatencyMs;
+};
+
+#endif // MQTTPUBLISHER_H
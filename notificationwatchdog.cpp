@@ -0,0 +1,141 @@
+#include "notificationwatchdog.h"
+#include "characteristicstats.h"
+#include "metrics.h"
+#include <QDebug>
+#include <QLowEnergyDescriptor>
+#include <QLowEnergyService>
+
+namespace {
+constexpr quint64 MinSamplesToLearn = 8;
+}
+
+NotificationWatchdog::NotificationWatchdog(TimerService *timers, QObject *parent)
+    : QObject(parent)
+    , m_timers(timers)
+    , m_stallMultiplier(5.0)
+    , m_minimumStallMs(2000)
+    , m_stallCount(0)
+    , m_lastRecoveryMs(0.0)
+{
+    MetricsRegistry &registry = MetricsRegistry::instance();
+    m_stalls = registry.counter("blescale_notification_stalls_total", "Subscriptions that stopped notifying.");
+    m_resubscribes = registry.counter("blescale_notification_resubscribes_total", "CCCD rewrites issued by the stall watchdog.");
+    m_escalations = registry.counter("blescale_notification_escalations_total", "Stalls escalated to a reconnect.");
+    m_recoveryTime = registry.histogram("blescale_stall_recovery_seconds", "Time from stall detection to the next notification.");
+}
+
+void NotificationWatchdog::watch(QLowEnergyService *service, const QLowEnergyCharacteristic &characteristic, int expectedIntervalMs)
+{
+    Subscription &subscription = m_subscriptions[characteristic.uuid()];
+    subscription.service = service;
+    subscription.characteristic = characteristic;
+    subscription.configuredIntervalMs = expectedIntervalMs;
+    subscription.lastArrivalUs = CharacteristicStats::monotonicUs();
+    subscription.stage = Healthy;
+    arm(characteristic.uuid(), subscription);
+}
+
+void NotificationWatchdog::clear()
+{
+    for (const Subscription &subscription : std::as_const(m_subscriptions))
+        m_timers->cancel(subscription.deadline);
+    m_subscriptions.clear();
+}
+
+void NotificationWatchdog::notified(const QBluetoothUuid &characteristic, qint64 arrivalUs, double meanIntervalMs, quint64 count)
+{
+    auto it = m_subscriptions.find(characteristic);
+    if (it == m_subscriptions.end())
+        return;
+
+    Subscription &subscription = it.value();
+    subscription.lastArrivalUs = arrivalUs;
+    subscription.learnedIntervalMs = meanIntervalMs;
+    subscription.count = count;
+    if (subscription.stage != Healthy) {
+        subscription.stage = Healthy;
+        qDebug() << "Notifications resumed for" << characteristic.toString();
+    }
+    arm(characteristic, subscription);
+
+    auto stalled = m_stalledSinceUs.find(characteristic);
+    if (stalled != m_stalledSinceUs.end()) {
+        const qint64 recoveryUs = arrivalUs - stalled.value();
+        m_stalledSinceUs.erase(stalled);
+        m_recoveryTime->observeUs(quint64(recoveryUs));
+        m_lastRecoveryMs = recoveryUs / 1000.0;
+        emit recovered(characteristic, m_lastRecoveryMs);
+    }
+}
+
+qint64 NotificationWatchdog::stallThresholdMs(const Subscription &subscription) const
+{
+    double cadenceMs = subscription.configuredIntervalMs;
+    if (cadenceMs <= 0) {
+        if (subscription.count < MinSamplesToLearn)
+            return -1; // Cadence unknown; a quiet scale is not a stalled one
+        cadenceMs = subscription.learnedIntervalMs;
+    }
+    return qint64(qMax(cadenceMs * m_stallMultiplier, double(m_minimumStallMs)));
+}
+
+// Called on every notification, so this is a single O(1) wheel reschedule in the common case
+void NotificationWatchdog::arm(const QBluetoothUuid &uuid, Subscription &subscription)
+{
+    const qint64 thresholdMs = stallThresholdMs(subscription);
+    if (thresholdMs < 0)
+        return;
+    if (!m_timers->reschedule(subscription.deadline, thresholdMs))
+        subscription.deadline = m_timers->schedule(thresholdMs, [this, uuid]() { deadlineExpired(uuid); });
+}
+
+void NotificationWatchdog::deadlineExpired(const QBluetoothUuid &uuid)
+{
+    auto it = m_subscriptions.find(uuid);
+    if (it == m_subscriptions.end())
+        return;
+    Subscription &subscription = it.value();
+    subscription.deadline = 0;
+    if (!subscription.service)
+        return;
+
+    const qint64 nowUs = CharacteristicStats::monotonicUs();
+    switch (subscription.stage) {
+    case Healthy:
+        qWarning() << "Notification stall on" << uuid.toString()
+                   << "silent for" << (nowUs - subscription.lastArrivalUs) / 1000 << "ms";
+        ++m_stallCount;
+        m_stalls->inc();
+        m_stalledSinceUs.insert(uuid, nowUs);
+        emit stallDetected(uuid);
+        resubscribe(subscription);
+        subscription.stage = Resubscribed;
+        arm(uuid, subscription); // Give the re-subscribe one more stall period
+        break;
+    case Resubscribed:
+        qWarning() << "Re-subscribe did not recover" << uuid.toString() << "- escalating to reconnect";
+        m_escalations->inc();
+        subscription.stage = Escalated;
+        emit escalationRequested(uuid);
+        break;
+    case Escalated:
+        break; // Owner is reconnecting; subscriptions are re-registered afterwards
+    }
+}
+
+void NotificationWatchdog::resubscribe(Subscription &subscription)
+{
+    const QLowEnergyDescriptor cccd = subscription.characteristic.descriptor(
+        QBluetoothUuid::DescriptorType::ClientCharacteristicConfiguration);
+    if (!cccd.isValid())
+        return;
+
+    // Toggle off and on; some stacks ignore a write of the value the CCCD already holds
+    const QByteArray enable = (subscription.characteristic.properties() & QLowEnergyCharacteristic::Notify)
+                                  ? QByteArray::fromHex("0100") : QByteArray::fromHex("0200");
+    emit descriptorWriteStarted();
+    subscription.service->writeDescriptor(cccd, QByteArray(2, 0));
+    emit descriptorWriteStarted();
+    subscription.service->writeDescriptor(cccd, enable);
+    m_resubscribes->inc();
+}
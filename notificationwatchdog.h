@@ -0,0 +1,84 @@
+#ifndef NOTIFICATIONWATCHDOG_H
+#define NOTIFICATIONWATCHDOG_H
+
+#include <QObject>
+#include <QBluetoothUuid>
+#include <QHash>
+#include <QLowEnergyCharacteristic>
+#include <QPointer>
+
+#include "timingwheel.h"
+
+class QLowEnergyService;
+class Counter;
+class Histogram;
+
+// Detects subscriptions that stay "connected" but silently stop notifying.
+//
+// Each watched characteristic has an expected cadence, either configured or learned from the
+// mean inter-arrival interval once enough notifications have been seen, and a deadline on the
+// shared timing wheel that every notification pushes out. When nothing arrives for
+// stallMultiplier() times that cadence the watchdog first re-subscribes by rewriting the CCCD;
+// if the stream is still silent after another stall period it emits escalationRequested() so the
+// owner can disconnect and reconnect. Stall counts and recovery times (stall detection to next
+// notification) are recorded in the metrics registry.
+class NotificationWatchdog : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit NotificationWatchdog(TimerService *timers, QObject *parent = nullptr);
+
+    // expectedIntervalMs == 0 learns the cadence from the stream itself
+    void watch(QLowEnergyService *service, const QLowEnergyCharacteristic &characteristic, int expectedIntervalMs = 0);
+    void clear();
+
+    // Called from the notification path with the characteristic's current mean interval
+    void notified(const QBluetoothUuid &characteristic, qint64 arrivalUs, double meanIntervalMs, quint64 count);
+
+    void setStallMultiplier(double multiplier) { m_stallMultiplier = multiplier; }
+    void setMinimumStallMs(int msec) { m_minimumStallMs = msec; }
+
+    quint64 stallCount() const { return m_stallCount; }
+    double lastRecoveryMs() const { return m_lastRecoveryMs; }
+
+signals:
+    void stallDetected(const QBluetoothUuid &characteristic);
+    void escalationRequested(const QBluetoothUuid &characteristic);
+    void recovered(const QBluetoothUuid &characteristic, double recoveryMs);
+    void descriptorWriteStarted(); // Before each CCCD write, so the owner can time them
+
+private:
+    enum Stage { Healthy, Resubscribed, Escalated };
+
+    struct Subscription {
+        QPointer<QLowEnergyService> service;
+        QLowEnergyCharacteristic characteristic;
+        int configuredIntervalMs = 0;
+        double learnedIntervalMs = 0.0;
+        quint64 count = 0;
+        qint64 lastArrivalUs = 0;
+        Stage stage = Healthy;
+        TimingWheel::TimerId deadline = 0;
+    };
+
+    qint64 stallThresholdMs(const Subscription &subscription) const;
+    void arm(const QBluetoothUuid &uuid, Subscription &subscription);
+    void deadlineExpired(const QBluetoothUuid &uuid);
+    void resubscribe(Subscription &subscription);
+
+    QHash<QBluetoothUuid, Subscription> m_subscriptions;
+    QHash<QBluetoothUuid, qint64> m_stalledSinceUs; // Survives clear() so reconnect recovery is timed
+    TimerService *m_timers;
+    double m_stallMultiplier;
+    int m_minimumStallMs;
+    quint64 m_stallCount;
+    double m_lastRecoveryMs;
+
+    Counter *m_stalls;
+    Counter *m_resubscribes;
+    Counter *m_escalations;
+    Histogram *m_recoveryTime;
+};
+
+#endif // NOTIFICATIONWATCHDOG_H
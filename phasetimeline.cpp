@@ -0,0 +1,147 @@
+#include "phasetimeline.h"
+#include "metrics.h"
+#include "tracer.h"
+#include <QDebug>
+#include <QFile>
+#include <QList>
+#include <algorithm>
+
+#ifdef Q_OS_LINUX
+#include <time.h>
+#include <unistd.h>
+#endif
+
+namespace {
+const char *const kPhaseNames[PhaseTimeline::PhaseCount] = {
+    "process_started", "app_launched", "first_paint", "bluetooth_ready", "scan_started", "first_device_discovered", "scan_finished", "connect_requested",
+    "connected", "services_discovered", "service_selected", "details_discovered", "subscribed",
+    "first_notification", "first_weight"
+};
+
+// Time since the process was started, or -1 where that is not known
+qint64 processAgeNs()
+{
+#ifdef Q_OS_LINUX
+    QFile stat(QStringLiteral("/proc/self/stat"));
+    if (!stat.open(QIODevice::ReadOnly))
+        return -1;
+    const QByteArray line = stat.readAll();
+    // Fields after the parenthesised command name; starttime (field 22) is index 19 from there
+    const QList<QByteArray> fields = line.mid(line.lastIndexOf(')') + 2).split(' ');
+    timespec now;
+    if (fields.size() < 20 || clock_gettime(CLOCK_BOOTTIME, &now) != 0)
+        return -1;
+    const qint64 startNs = qint64(fields.at(19).toULongLong() * 1e9 / sysconf(_SC_CLK_TCK));
+    return qMax<qint64>(0, qint64(now.tv_sec) * 1000000000 + now.tv_nsec - startNs);
+#else
+    return -1;
+#endif
+}
+
+// Reached phases in the order they happened
+QList<PhaseTimeline::Phase> chronological(const PhaseTimeline &timeline)
+{
+    QList<PhaseTimeline::Phase> phases;
+    for (int phase = 0; phase < PhaseTimeline::PhaseCount; ++phase) {
+        if (timeline.reached(PhaseTimeline::Phase(phase)))
+            phases.append(PhaseTimeline::Phase(phase));
+    }
+    std::stable_sort(phases.begin(), phases.end(), [&timeline](PhaseTimeline::Phase a, PhaseTimeline::Phase b) {
+        return timeline.elapsedMs(a) < timeline.elapsedMs(b);
+    });
+    return phases;
+}
+}
+
+PhaseTimeline &PhaseTimeline::instance()
+{
+    static PhaseTimeline timeline;
+    return timeline;
+}
+
+PhaseTimeline::PhaseTimeline()
+    : m_enabled(true)
+{
+    std::fill(std::begin(m_atNs), std::end(m_atNs), -1);
+    m_clock.start();
+    m_startOffsetNs = processAgeNs();
+    if (m_startOffsetNs >= 0)
+        m_atNs[ProcessStarted] = 0;
+    else
+        m_startOffsetNs = 0; // Measure from main() instead
+}
+
+const char *PhaseTimeline::name(Phase phase)
+{
+    return kPhaseNames[phase];
+}
+
+void PhaseTimeline::mark(Phase phase)
+{
+    if (!m_enabled || reached(phase))
+        return;
+    m_atNs[phase] = m_startOffsetNs + m_clock.nsecsElapsed();
+    Tracer::instance().instant(kPhaseNames[phase]);
+    if (phase == BluetoothReady)
+        qDebug().noquote() << startupReport();
+    else if (phase == FirstWeight)
+        qDebug().noquote() << report();
+}
+
+QString PhaseTimeline::startupReport() const
+{
+    const QString origin = reached(ProcessStarted) ? QStringLiteral("process start") : QStringLiteral("main()");
+    QString text = QString("Startup (from %1):").arg(origin);
+    for (Phase phase : {AppLaunched, FirstPaint, BluetoothReady}) {
+        if (reached(phase))
+            text += QString(" %1 %2 ms").arg(QString::fromLatin1(kPhaseNames[phase])).arg(elapsedMs(phase), 0, 'f', 1);
+    }
+    return text;
+}
+
+QString PhaseTimeline::report() const
+{
+    QString text = reached(FirstWeight)
+        ? QString("Time to first weight: %1 ms").arg(elapsedMs(FirstWeight), 0, 'f', 1)
+        : QString("Time to first weight: not reached");
+    double previousMs = 0.0;
+    for (Phase phase : chronological(*this)) {
+        text += QString("\n  %1 %2 ms (+%3 ms)")
+                    .arg(QString::fromLatin1(kPhaseNames[phase]), -24)
+                    .arg(elapsedMs(phase), 9, 'f', 1)
+                    .arg(elapsedMs(phase) - previousMs, 0, 'f', 1);
+        previousMs = elapsedMs(phase);
+    }
+    return text;
+}
+
+QByteArray PhaseTimeline::toJson() const
+{
+    QByteArray out = "{\"phases\":[";
+    double previousMs = 0.0;
+    bool first = true;
+    for (Phase phase : chronological(*this)) {
+        if (!first)
+            out += ',';
+        first = false;
+        out += "{\"phase\":\"";
+        out += kPhaseNames[phase];
+        out += "\",\"ms\":" + QByteArray::number(elapsedMs(phase), 'f', 3)
+               + ",\"deltaMs\":" + QByteArray::number(elapsedMs(phase) - previousMs, 'f', 3) + '}';
+        previousMs = elapsedMs(phase);
+    }
+    out += "]}";
+    return out;
+}
+
+void PhaseTimeline::appendMetrics(QByteArray &out) const
+{
+    out += "# HELP blescale_startup_phase_seconds Time from app launch to each connect phase (first occurrence).\n"
+           "# TYPE blescale_startup_phase_seconds gauge\n";
+    for (int phase = 0; phase < PhaseCount; ++phase) {
+        if (!reached(Phase(phase)))
+            continue;
+        out += QByteArray("blescale_startup_phase_seconds{phase=\"") + kPhaseNames[phase] + "\"} "
+               + QByteArray::number(elapsedMs(Phase(phase)) / 1000.0, 'g', 12) + '\n';
+    }
+}
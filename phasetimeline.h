@@ -0,0 +1,66 @@
+#ifndef PHASETIMELINE_H
+#define PHASETIMELINE_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QString>
+
+// Startup and time to first weight, broken down by phase.
+//
+// Each phase records the first time it is reached, measured from process start where the platform
+// reports it (Linux, via /proc/self/stat) and from main() elsewhere. Once the Bluetooth stack is
+// ready a startup summary is logged (process start to first paint and to scan ready); when the first
+// decoded weight arrives the breakdown is logged in chronological order with the delta from the
+// previous phase; it is also served as JSON and exported as gauges on /metrics. Phases can overlap
+// (in fast connect mode the scan is still running while the device connects), so the report is
+// ordered by time rather than by enum value.
+//
+// The simulated modes (--memory-check, --soak) turn it off: they replay the connect and the
+// notifications on a virtual clock without a radio, so the phases would time only the app's own
+// code and the report would not be comparable with a real connect.
+class PhaseTimeline
+{
+public:
+    enum Phase {
+        ProcessStarted,
+        AppLaunched,
+        FirstPaint,
+        BluetoothReady,
+        ScanStarted,
+        FirstDeviceDiscovered,
+        ScanFinished,
+        ConnectRequested,
+        Connected,
+        ServicesDiscovered,
+        ServiceSelected,
+        DetailsDiscovered,
+        Subscribed,
+        FirstNotification,
+        FirstWeight,
+        PhaseCount
+    };
+
+    static PhaseTimeline &instance();
+
+    void mark(Phase phase);
+    void setEnabled(bool enabled) { m_enabled = enabled; } // Off: later marks are ignored
+    bool reached(Phase phase) const { return m_atNs[phase] >= 0; }
+    double elapsedMs(Phase phase) const { return reached(phase) ? m_atNs[phase] / 1e6 : -1.0; }
+
+    static const char *name(Phase phase);
+
+    QString report() const;
+    QString startupReport() const;
+    QByteArray toJson() const;
+    void appendMetrics(QByteArray &out) const;
+
+private:
+    PhaseTimeline();
+
+    QElapsedTimer m_clock;
+    qint64 m_startOffsetNs; // Process age when the timeline was created
+    qint64 m_atNs[PhaseCount];
+    bool m_enabled;
+};
+
+#endif // PHASETIMELINE_H
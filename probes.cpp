@@ -0,0 +1,10 @@
+#include "probes.h"
+
+#ifdef BLESCALE_HAVE_USDT
+// Probe semaphores, in the section perf, bpftrace and SystemTap look for them
+#define BLESCALE_DEFINE_SEMAPHORE(name) \
+    __attribute__((section(".probes"))) volatile unsigned short blescale_##name##_semaphore = 0;
+extern "C" {
+BLESCALE_PROBES(BLESCALE_DEFINE_SEMAPHORE)
+}
+#endif
@@ -0,0 +1,53 @@
+#ifndef PROBES_H
+#define PROBES_H
+
+// Static user-space tracepoints (USDT) for perf, bpftrace and SystemTap.
+//
+// Built with `qmake CONFIG+=usdt` on a system with <sys/sdt.h> (systemtap-sdt-dev), each probe is
+// a single nop in the instruction stream plus a note in the ELF; it costs nothing until a tracer
+// attaches. Otherwise the macros expand to nothing and their arguments are not evaluated.
+//
+// Provider "blescale":
+//   notify_arrival(characteristic, payload_len, arrival_us)
+//   decode_done(characteristic, mantissa, exponent, timestamp_us)
+//   ui_apply_start(characteristic)        ui_apply_done(characteristic)
+//   gatt_op_start(op, key)                gatt_op_done(op, key, latency_us)
+//   conn_state(address, state)
+//
+// `characteristic` is qHash() of the characteristic UUID, `op` an IngestMetrics::GattOp and
+// `state` a QLowEnergyController::ControllerState. See blescale_probes.bt for an example.
+//
+// Every probe has a semaphore (probes.cpp) that tracers increment while attached; arguments are
+// only evaluated while it is non-zero, so they may do some work (a qHash(), a conversion).
+
+#define BLESCALE_PROBES(X) \
+    X(notify_arrival) X(decode_done) X(ui_apply_start) X(ui_apply_done) \
+    X(gatt_op_start) X(gatt_op_done) X(conn_state)
+
+#if defined(BLESCALE_USDT) && defined(__has_include)
+#  if __has_include(<sys/sdt.h>)
+#    define _SDT_HAS_SEMAPHORES 1
+#    include <sys/sdt.h>
+#    define BLESCALE_HAVE_USDT
+#  endif
+#endif
+
+#ifdef BLESCALE_HAVE_USDT
+#  define BLESCALE_DECLARE_SEMAPHORE(name) extern volatile unsigned short blescale_##name##_semaphore;
+extern "C" {
+BLESCALE_PROBES(BLESCALE_DECLARE_SEMAPHORE)
+}
+#  define BLESCALE_PROBE_ENABLED(name) __builtin_expect(blescale_##name##_semaphore != 0, 0)
+#  define BLESCALE_PROBE1(name, a1) do { if (BLESCALE_PROBE_ENABLED(name)) DTRACE_PROBE1(blescale, name, a1); } while (0)
+#  define BLESCALE_PROBE2(name, a1, a2) do { if (BLESCALE_PROBE_ENABLED(name)) DTRACE_PROBE2(blescale, name, a1, a2); } while (0)
+#  define BLESCALE_PROBE3(name, a1, a2, a3) do { if (BLESCALE_PROBE_ENABLED(name)) DTRACE_PROBE3(blescale, name, a1, a2, a3); } while (0)
+#  define BLESCALE_PROBE4(name, a1, a2, a3, a4) do { if (BLESCALE_PROBE_ENABLED(name)) DTRACE_PROBE4(blescale, name, a1, a2, a3, a4); } while (0)
+#else
+#  define BLESCALE_PROBE_ENABLED(name) false
+#  define BLESCALE_PROBE1(name, a1) do {} while (0)
+#  define BLESCALE_PROBE2(name, a1, a2) do {} while (0)
+#  define BLESCALE_PROBE3(name, a1, a2, a3) do {} while (0)
+#  define BLESCALE_PROBE4(name, a1, a2, a3, a4) do {} while (0)
+#endif
+
+#endif // PROBES_H
@@ -0,0 +1,60 @@
+#ifndef SAMPLE_H
+#define SAMPLE_H
+
+#include <QtGlobal>
+#include <QBluetoothUuid>
+#include <chrono>
+#include <cmath>
+
+// Bluetooth SIG unit UUIDs (Sample::unit) the station converts between
+namespace SigUnit {
+constexpr quint16 Kilogram = 0x2702; // mass (kilogram)
+constexpr quint16 Pound = 0x27B8;    // mass (pound)
+}
+
+// A decoded measurement coming out of a characteristic notification.
+// Kept trivially copyable and free of heap members so it can be batched,
+// written to sockets or shared memory and queued without allocations.
+struct Sample
+{
+    enum Flag : quint8 {
+        HasValue    = 0x01, // mantissa/exponent/unit are valid
+        HasSequence = 0x02, // payload carried a sequence counter
+        Imperial    = 0x04, // device reported imperial units
+        Special     = 0x08, // no value; mantissa holds a SpecialValue (IEEE-11073 NaN, INF, ...)
+    };
+    enum SpecialValue : quint8 {
+        NoSpecial,
+        NotANumber,
+        NotAtResolution,
+        PositiveInfinity,
+        NegativeInfinity,
+        ReservedValue,
+    };
+
+    quint64 device = 0;             // QBluetoothAddress::toUInt64()
+    QBluetoothUuid characteristic;  // Source characteristic
+    qint64 timestampUs = 0;         // Arrival time, microseconds since epoch
+    qint32 mantissa = 0;            // value = mantissa * 10^exponent
+    qint8 exponent = 0;
+    quint8 flags = 0;
+    quint16 unit = 0;               // Bluetooth SIG unit UUID, e.g. 0x2702 (kg)
+    quint32 sequence = 0;           // Only meaningful with HasSequence
+
+    bool hasValue() const { return flags & HasValue; }
+    // Weight Measurement, or any other characteristic reporting a mass (kg, lb)
+    bool isWeight() const
+    {
+        return unit == SigUnit::Kilogram || unit == SigUnit::Pound
+            || characteristic == QBluetoothUuid(QBluetoothUuid::CharacteristicType::WeightMeasurement);
+    }
+    double value() const { return mantissa * std::pow(10.0, exponent); }
+
+    static qint64 nowUs()
+    {
+        using namespace std::chrono;
+        return duration_cast<microseconds>(system_clock::now().time_since_epoch()).count();
+    }
+};
+
+#endif // SAMPLE_H
@@ -0,0 +1,242 @@
+#include "samplebus.h"
+#include "memoryaccounting.h"
+#include <new>
+#include <utility>
+
+namespace {
+constexpr int kMaxPooledRecords = 4096; // Released beyond this go back to the heap
+
+struct FreeRecord {
+    FreeRecord *next;
+};
+thread_local FreeRecord *t_freeRecords = nullptr;
+thread_local int t_pooledRecords = 0;
+}
+
+// --- SampleRef ---
+void *SampleRef::Data::operator new(std::size_t size)
+{
+    if (FreeRecord *record = t_freeRecords) {
+        t_freeRecords = record->next;
+        --t_pooledRecords;
+        return record;
+    }
+    return ::operator new(size);
+}
+
+void SampleRef::Data::operator delete(void *pointer, std::size_t size)
+{
+    if (t_pooledRecords >= kMaxPooledRecords) {
+        ::operator delete(pointer, size);
+        return;
+    }
+    t_freeRecords = new (pointer) FreeRecord{t_freeRecords};
+    ++t_pooledRecords;
+}
+
+int SampleRef::pooledRecords()
+{
+    return t_pooledRecords;
+}
+
+SampleRef::SampleRef(const Sample &sample, const QByteArray &payload)
+{
+    Data *data = new Data;
+    data->sample = sample;
+    data->payload = payload;
+    d.reset(data);
+}
+
+// --- SampleBus ---
+SampleBus::SampleBus(TimerService *timers, QObject *parent)
+    : QObject(parent)
+    , m_timers(timers)
+    , m_nextId(1)
+{
+}
+
+SampleBus::~SampleBus()
+{
+    for (Subscriber *subscriber : std::as_const(m_subscribers)) {
+        m_timers->cancel(subscriber->flush);
+        delete subscriber;
+    }
+}
+
+// Not to be called from inside a subscriber callback
+SampleBus::SubscriberId SampleBus::subscribe(const QByteArray &name, const Options &options, Callback callback)
+{
+    Subscriber *subscriber = new Subscriber;
+    subscriber->id = m_nextId++;
+    subscriber->name = name;
+    subscriber->options = options;
+    subscriber->callback = std::move(callback);
+    subscriber->intervalMs = options.maxHz > 0 ? qMax<qint64>(1, qint64(1000.0 / options.maxHz)) : 0;
+    subscriber->flush = 0;
+    subscriber->drainScheduled = false;
+    subscriber->delivered = 0;
+    subscriber->dropped = 0;
+    subscriber->coalesced = 0;
+    m_subscribers.append(subscriber);
+    return subscriber->id;
+}
+
+void SampleBus::unsubscribe(SubscriberId id)
+{
+    for (int i = 0; i < m_subscribers.size(); ++i) {
+        if (m_subscribers.at(i)->id == id) {
+            m_timers->cancel(m_subscribers.at(i)->flush);
+            delete m_subscribers.takeAt(i);
+            return;
+        }
+    }
+}
+
+SampleBus::Subscriber *SampleBus::find(SubscriberId id)
+{
+    for (Subscriber *subscriber : std::as_const(m_subscribers)) {
+        if (subscriber->id == id)
+            return subscriber;
+    }
+    return nullptr;
+}
+
+void SampleBus::publish(const SampleRef &sample)
+{
+    const Sample &value = sample.sample();
+    const Key key(value.device, value.characteristic);
+    for (Subscriber *subscriber : std::as_const(m_subscribers)) {
+        switch (subscriber->options.rate) {
+        case EverySample:
+            deliver(*subscriber, sample);
+            break;
+        case ChangeOnly: {
+            SampleRef &last = subscriber->last[key];
+            if (!last.isNull()) {
+                const Sample &previous = last.sample();
+                if (previous.mantissa == value.mantissa && previous.exponent == value.exponent
+                    && previous.unit == value.unit && previous.flags == value.flags) {
+                    ++subscriber->coalesced;
+                    break;
+                }
+            }
+            last = sample;
+            deliver(*subscriber, sample);
+            break;
+        }
+        case LatestOnly: {
+            const qint64 nowMs = m_timers->nowMs();
+            const qint64 sinceMs = nowMs - subscriber->lastSentMs.value(key, nowMs - subscriber->intervalMs);
+            SampleRef &waiting = subscriber->last[key];
+            if (waiting.isNull() && sinceMs >= subscriber->intervalMs) {
+                subscriber->lastSentMs.insert(key, nowMs);
+                deliver(*subscriber, sample);
+                break;
+            }
+            if (!waiting.isNull())
+                ++subscriber->coalesced;
+            waiting = sample;
+            if (!m_timers->isActive(subscriber->flush)) {
+                const SubscriberId id = subscriber->id;
+                subscriber->flush = m_timers->schedule(qMax<qint64>(1, subscriber->intervalMs - sinceMs),
+                                                       [this, id]() { flushLatest(id); });
+            }
+            break;
+        }
+        }
+    }
+}
+
+void SampleBus::flushLatest(SubscriberId id)
+{
+    Subscriber *subscriber = find(id);
+    if (!subscriber)
+        return;
+    subscriber->flush = 0;
+    // Samples published while delivering land in the other table; entries are nulled, not
+    // removed, so neither table gives up its storage
+    QHash<Key, SampleRef> waiting;
+    waiting.swap(subscriber->last);
+    subscriber->last.swap(subscriber->flushing);
+    const qint64 nowMs = m_timers->nowMs();
+    for (auto it = waiting.begin(); it != waiting.end(); ++it) {
+        if (it.value().isNull())
+            continue;
+        const SampleRef sample = std::exchange(it.value(), SampleRef());
+        subscriber->lastSentMs.insert(it.key(), nowMs);
+        deliver(*subscriber, sample);
+    }
+    subscriber->flushing.swap(waiting);
+}
+
+void SampleBus::deliver(Subscriber &subscriber, const SampleRef &sample)
+{
+    if (subscriber.options.delivery == Direct) {
+        ++subscriber.delivered;
+        subscriber.callback(sample);
+        return;
+    }
+
+    if (subscriber.queue.size() >= subscriber.options.queueLimit) {
+        ++subscriber.dropped;
+        if (subscriber.options.overflow == DropNewest)
+            return;
+        subscriber.queue.removeFirst();
+    }
+    subscriber.queue.append(sample);
+    if (!subscriber.drainScheduled) {
+        subscriber.drainScheduled = true;
+        const SubscriberId id = subscriber.id;
+        QMetaObject::invokeMethod(this, [this, id]() { drain(id); }, Qt::QueuedConnection);
+    }
+}
+
+void SampleBus::drain(SubscriberId id)
+{
+    Subscriber *subscriber = find(id);
+    if (!subscriber)
+        return;
+    subscriber->drainScheduled = false;
+    QList<SampleRef> queue;
+    queue.swap(subscriber->queue);
+    subscriber->queue.swap(subscriber->spare); // Takes what arrives meanwhile
+    const Callback callback = subscriber->callback; // The subscriber may unsubscribe meanwhile
+    subscriber->delivered += queue.size();
+    for (const SampleRef &sample : std::as_const(queue))
+        callback(sample);
+
+    queue.clear(); // Keeps the capacity for the drain after next
+    if (Subscriber *live = find(id))
+        live->spare.swap(queue);
+}
+
+void SampleBus::appendMetrics(QByteArray &out) const
+{
+    struct Series { const char *name; const char *help; quint64 Subscriber::*counter; };
+    static const Series series[] = {
+        {"blescale_bus_delivered_total", "Samples delivered per bus subscriber.", &Subscriber::delivered},
+        {"blescale_bus_dropped_total", "Samples dropped by a bus subscriber's overflow policy.", &Subscriber::dropped},
+        {"blescale_bus_coalesced_total", "Samples skipped or replaced by a bus subscriber's rate.", &Subscriber::coalesced},
+    };
+    for (const Series &metric : series) {
+        out += QByteArray("# HELP ") + metric.name + ' ' + metric.help + '\n';
+        out += QByteArray("# TYPE ") + metric.name + " counter\n";
+        for (const Subscriber *subscriber : m_subscribers) {
+            out += QByteArray(metric.name) + "{subscriber=\"" + subscriber->name + "\"} "
+                   + QByteArray::number(subscriber->*metric.counter) + '\n';
+        }
+    }
+}
+
+qint64 SampleBus::memoryUsage() const
+{
+    qint64 bytes = MemoryAccounting::containerBytes(m_subscribers) + qint64(SampleRef::pooledRecords()) * SampleRef::recordSize();
+    for (const Subscriber *subscriber : m_subscribers) {
+        bytes += qint64(sizeof(Subscriber)) + MemoryAccounting::bytes(subscriber->name)
+                 + MemoryAccounting::containerBytes(subscriber->last) + MemoryAccounting::containerBytes(subscriber->flushing)
+                 + MemoryAccounting::containerBytes(subscriber->lastSentMs)
+                 + MemoryAccounting::containerBytes(subscriber->queue) + MemoryAccounting::containerBytes(subscriber->spare)
+                 + qint64(subscriber->queue.size() + subscriber->last.size()) * SampleRef::recordSize(); // Upper bound
+    }
+    return bytes;
+}
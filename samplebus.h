@@ -0,0 +1,125 @@
+#ifndef SAMPLEBUS_H
+#define SAMPLEBUS_H
+
+#include "sample.h"
+#include "timingwheel.h"
+
+#include <QObject>
+#include <QByteArray>
+#include <QExplicitlySharedDataPointer>
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QSharedData>
+#include <cstddef>
+#include <functional>
+
+// An immutable, reference-counted decoded sample plus the raw payload it came from. Copies
+// share one allocation, so fanning a sample out to any number of subscribers costs a
+// reference count per subscriber, never a copy of the data.
+//
+// The fixed-size records come from a per-thread free list and go back to it once the last
+// reference is gone, so steady-state publishing does not touch the heap.
+class SampleRef
+{
+public:
+    SampleRef() = default;
+    SampleRef(const Sample &sample, const QByteArray &payload);
+
+    bool isNull() const { return !d; }
+    const Sample &sample() const { return d->sample; }
+    const QByteArray &payload() const { return d->payload; } // Implicitly shared, may be empty
+
+    static int pooledRecords(); // Free records on this thread
+    static qint64 recordSize() { return sizeof(Data); }
+
+private:
+    struct Data : QSharedData {
+        Sample sample;
+        QByteArray payload;
+
+        static void *operator new(std::size_t size);
+        static void operator delete(void *pointer, std::size_t size);
+    };
+    QExplicitlySharedDataPointer<const Data> d;
+};
+
+// In-process publish/subscribe for decoded samples. Every subscriber chooses how often it
+// wants samples and what happens when it falls behind:
+//
+//   EverySample   each sample, in order
+//   ChangeOnly    a sample only when the value differs from the last one delivered for that
+//                 device and characteristic
+//   LatestOnly    at most maxHz deliveries per device and characteristic, each carrying the
+//                 newest sample; those in between are coalesced
+//
+// Direct subscribers run inside publish(). Queued subscribers are called from the event loop
+// once publish() has returned; when more than queueLimit samples are waiting the policy drops
+// the oldest or the newest. Per-subscriber counters are exported as metrics.
+//
+// Queues and waiting tables alternate with a spare of the same kind and keep their storage across
+// flushes, so once every device and characteristic has been seen, publishing and flushing do not
+// allocate (checked by --self-test in CONFIG+=alloccount builds).
+class SampleBus : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Rate { EverySample, ChangeOnly, LatestOnly };
+    enum Delivery { Direct, Queued };
+    enum Overflow { DropOldest, DropNewest };
+
+    struct Options {
+        Rate rate = EverySample;
+        double maxHz = 10.0;   // LatestOnly
+        Delivery delivery = Direct;
+        int queueLimit = 1024; // Queued
+        Overflow overflow = DropOldest;
+    };
+    using Callback = std::function<void(const SampleRef &)>;
+    using SubscriberId = int;
+
+    SampleBus(TimerService *timers, QObject *parent = nullptr);
+    ~SampleBus();
+
+    SubscriberId subscribe(const QByteArray &name, const Options &options, Callback callback);
+    void unsubscribe(SubscriberId id);
+    int subscriberCount() const { return m_subscribers.size(); }
+
+    void publish(const SampleRef &sample);
+
+    void appendMetrics(QByteArray &out) const;
+    qint64 memoryUsage() const; // Queues, per-key state and this thread's record pool, see MemoryAccounting
+
+private:
+    using Key = QPair<quint64, QBluetoothUuid>; // Device, characteristic
+
+    struct Subscriber {
+        SubscriberId id;
+        QByteArray name;
+        Options options;
+        Callback callback;
+        qint64 intervalMs;
+        QHash<Key, SampleRef> last;     // ChangeOnly: last delivered; LatestOnly: waiting, null if none
+        QHash<Key, SampleRef> flushing; // LatestOnly: the other half of `last`, all null between flushes
+        QHash<Key, qint64> lastSentMs;  // LatestOnly
+        QList<SampleRef> queue;         // Queued delivery
+        QList<SampleRef> spare;         // Queued: empty storage swapped in for the next drain
+        TimingWheel::TimerId flush;
+        bool drainScheduled;
+        quint64 delivered;
+        quint64 dropped;
+        quint64 coalesced;
+    };
+
+    Subscriber *find(SubscriberId id);
+    void deliver(Subscriber &subscriber, const SampleRef &sample);
+    void drain(SubscriberId id);
+    void flushLatest(SubscriberId id);
+
+    TimerService *m_timers;
+    QList<Subscriber *> m_subscribers;
+    SubscriberId m_nextId;
+};
+
+#endif // SAMPLEBUS_H
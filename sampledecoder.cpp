@@ -0,0 +1,223 @@
+#include "sampledecoder.h"
+#include "decoderplugin.h"
+#include "ieee11073.h"
+#include <QtEndian>
+#include <cstring>
+#include <limits>
+
+namespace {
+// GATT format types (Characteristic Presentation Format, Bluetooth Assigned Numbers)
+enum Format : quint8 {
+    FormatUint8 = 0x04,
+    FormatUint16 = 0x06,
+    FormatUint24 = 0x07,
+    FormatUint32 = 0x08,
+    FormatSint8 = 0x0C,
+    FormatSint16 = 0x0E,
+    FormatSint24 = 0x0F,
+    FormatSint32 = 0x10,
+    FormatSFloat = 0x16,
+    FormatFloat = 0x17,
+};
+
+constexpr int kKernelChunk = 64; // Values per kernel call in decodeRun(), on the stack
+}
+
+bool SampleDecoder::canDecode(const QBluetoothUuid &characteristic) const
+{
+    return characteristic == QBluetoothUuid(QBluetoothUuid::CharacteristicType::WeightMeasurement)
+        || m_plans.contains(characteristic) || m_layouts.contains(characteristic) || m_plugins.contains(characteristic);
+}
+
+bool SampleDecoder::decode(const QBluetoothUuid &characteristic, const QByteArray &payload, Sample &out) const
+{
+    if (!m_plugins.isEmpty()) {
+        DecoderPlugin *plugin = m_plugins.value(characteristic);
+        if (plugin)
+            return plugin->decode(characteristic, payload, out); // One lookup, one virtual call
+    }
+    if (!m_layouts.isEmpty()) {
+        auto layout = m_layouts.constFind(characteristic);
+        if (layout != m_layouts.constEnd())
+            return layout->run(payload, out);
+    }
+    if (characteristic == QBluetoothUuid(QBluetoothUuid::CharacteristicType::WeightMeasurement))
+        return decodeWeightMeasurement(payload, out);
+    if (const DecodePlan *decodePlan = plan(characteristic))
+        return decodeWithPlan(*decodePlan, payload, out);
+    return false;
+}
+
+void SampleDecoder::decodeRun(const QBluetoothUuid &characteristic, const QByteArray *payloads, int count, Sample *out, bool *ok) const
+{
+    if (!m_plugins.isEmpty()) {
+        if (DecoderPlugin *plugin = m_plugins.value(characteristic)) {
+            // Whatever the plugin leaves undone goes through its single decode()
+            int done = qBound(0, plugin->decodeBatch(characteristic, payloads, count, out, ok), count);
+            for (; done < count; ++done)
+                ok[done] = plugin->decode(characteristic, payloads[done], out[done]);
+            return;
+        }
+    }
+
+    const DecodePlan *decodePlan = nullptr;
+    if (!m_layouts.contains(characteristic)
+        && characteristic != QBluetoothUuid(QBluetoothUuid::CharacteristicType::WeightMeasurement))
+        decodePlan = plan(characteristic);
+    if (!decodePlan || (decodePlan->format != FormatSFloat && decodePlan->format != FormatFloat)) {
+        for (int i = 0; i < count; ++i)
+            ok[i] = decode(characteristic, payloads[i], out[i]);
+        return;
+    }
+
+    // Pack the values of each chunk contiguously, decode them in one kernel call, then spread the
+    // results back; payloads too short for a value are skipped
+    const int size = DecodePlan::valueSize(decodePlan->format);
+    for (int first = 0; first < count; first += kKernelChunk) {
+        const int chunk = qMin(kKernelChunk, count - first);
+        uchar packed[kKernelChunk * 4];
+        int index[kKernelChunk];
+        int packedCount = 0;
+        for (int i = first; i < first + chunk; ++i) {
+            ok[i] = payloads[i].size() >= size;
+            if (!ok[i])
+                continue;
+            std::memcpy(packed + packedCount * size, payloads[i].constData(), size);
+            index[packedCount++] = i;
+        }
+
+        qint32 mantissa[kKernelChunk];
+        qint8 exponent[kKernelChunk];
+        quint8 special[kKernelChunk];
+        if (decodePlan->format == FormatSFloat)
+            Ieee11073::decodeSFloat(packed, packedCount, mantissa, exponent, special);
+        else
+            Ieee11073::decodeFloat(packed, packedCount, mantissa, exponent, special);
+        for (int k = 0; k < packedCount; ++k) {
+            Sample &sample = out[index[k]];
+            sample.unit = decodePlan->unit;
+            Ieee11073::toSample(mantissa[k], exponent[k], special[k], sample);
+        }
+    }
+}
+
+void SampleDecoder::setPlan(const QBluetoothUuid &characteristic, const DecodePlan &plan)
+{
+    if (plan.isValid())
+        m_plans.insert(characteristic, plan);
+    else
+        m_plans.remove(characteristic);
+}
+
+const SampleDecoder::DecodePlan *SampleDecoder::plan(const QBluetoothUuid &characteristic) const
+{
+    auto it = m_plans.constFind(characteristic);
+    return it == m_plans.constEnd() ? nullptr : &it.value();
+}
+
+int SampleDecoder::DecodePlan::valueSize(quint8 format)
+{
+    switch (format) {
+    case FormatUint8:
+    case FormatSint8:
+        return 1;
+    case FormatUint16:
+    case FormatSint16:
+    case FormatSFloat:
+        return 2;
+    case FormatUint24:
+    case FormatSint24:
+        return 3;
+    case FormatUint32:
+    case FormatSint32:
+    case FormatFloat:
+        return 4;
+    default:
+        return 0; // Booleans, 48+ bit integers, IEEE-754 floats and strings stay raw
+    }
+}
+
+// Characteristic Presentation Format (0x2904):
+//   byte 0     format
+//   byte 1     exponent, int8 (value = raw * 10^exponent)
+//   bytes 2-3  unit, uint16 little endian
+//   byte 4     namespace, bytes 5-6 description (not used)
+SampleDecoder::DecodePlan SampleDecoder::DecodePlan::fromPresentationFormat(const QByteArray &descriptorValue)
+{
+    DecodePlan plan;
+    if (descriptorValue.size() < 4)
+        return plan;
+    const uchar *data = reinterpret_cast<const uchar *>(descriptorValue.constData());
+    plan.format = data[0];
+    plan.exponent = qint8(data[1]);
+    plan.unit = qFromLittleEndian<quint16>(data + 2);
+    return plan;
+}
+
+// The characteristic value is a single value of the plan's format at offset 0
+bool SampleDecoder::decodeWithPlan(const DecodePlan &plan, const QByteArray &payload, Sample &out)
+{
+    const int size = DecodePlan::valueSize(plan.format);
+    if (size == 0 || payload.size() < size)
+        return false;
+
+    const uchar *data = reinterpret_cast<const uchar *>(payload.constData());
+    out.unit = plan.unit;
+    if (plan.format == FormatSFloat || plan.format == FormatFloat) {
+        qint32 mantissa;
+        qint8 exponent;
+        quint8 special;
+        if (plan.format == FormatSFloat)
+            Ieee11073::decodeSFloat(data, 1, &mantissa, &exponent, &special);
+        else
+            Ieee11073::decodeFloat(data, 1, &mantissa, &exponent, &special);
+        Ieee11073::toSample(mantissa, exponent, special, out);
+        return true;
+    }
+
+    qint64 raw = 0;
+    switch (plan.format) {
+    case FormatUint8: raw = data[0]; break;
+    case FormatUint16: raw = qFromLittleEndian<quint16>(data); break;
+    case FormatUint24: raw = data[0] | (data[1] << 8) | (qint64(data[2]) << 16); break;
+    case FormatUint32: raw = qFromLittleEndian<quint32>(data); break;
+    case FormatSint8: raw = qint8(data[0]); break;
+    case FormatSint16: raw = qFromLittleEndian<qint16>(data); break;
+    case FormatSint24: raw = ((data[0] | (data[1] << 8) | (qint32(data[2]) << 16)) ^ 0x800000) - 0x800000; break;
+    case FormatSint32: raw = qFromLittleEndian<qint32>(data); break;
+    }
+    if (raw > std::numeric_limits<qint32>::max())
+        return false; // Does not fit the mantissa
+    out.mantissa = qint32(raw);
+    out.exponent = plan.exponent;
+    out.flags |= Sample::HasValue;
+    return true;
+}
+
+// Weight Measurement (GATT 0x2A9D):
+//   byte 0     flags (bit 0: 0 = SI kg, 1 = imperial lb)
+//   bytes 1-2  weight, uint16 little endian
+//   SI resolution is 0.005 kg, imperial resolution is 0.01 lb.
+//   Optional timestamp / user id / BMI fields follow and are ignored here.
+bool SampleDecoder::decodeWeightMeasurement(const QByteArray &payload, Sample &out)
+{
+    if (payload.size() < 3)
+        return false;
+
+    const uchar *data = reinterpret_cast<const uchar *>(payload.constData());
+    const quint8 flags = data[0];
+    const quint16 raw = qFromLittleEndian<quint16>(data + 1);
+
+    if (flags & 0x01) {
+        out.mantissa = raw;
+        out.exponent = -2;
+        out.unit = SigUnit::Pound;
+        out.flags |= Sample::Imperial;
+    } else {
+        out.mantissa = qint32(raw) * 5;
+        out.exponent = -3;
+        out.unit = SigUnit::Kilogram;
+    }
+    out.flags |= Sample::HasValue;
+    return true;
+}
@@ -0,0 +1,61 @@
+#ifndef SAMPLEDECODER_H
+#define SAMPLEDECODER_H
+
+#include "layoutprogram.h"
+#include "sample.h"
+
+#include <QByteArray>
+#include <QBluetoothUuid>
+#include <QHash>
+#include <QString>
+
+class DecoderPlugin;
+
+// Turns raw characteristic payloads into Samples.
+// The standard Weight Measurement characteristic (0x2A9D) is always understood. Any other
+// characteristic is decodable once a plan has been set for it, normally built from its
+// Characteristic Presentation Format descriptor (0x2904): value format, decimal exponent and unit.
+// A decoder plugin or vendor layout (LayoutProgram) set for a characteristic takes precedence
+// over both, the plugin first.
+// Characteristics without any of these are reported as not decodable and left to the raw hex display.
+class SampleDecoder
+{
+public:
+    struct DecodePlan {
+        quint8 format = 0;    // GATT format type, e.g. 0x06 uint16, 0x16 SFLOAT, 0x17 FLOAT
+        qint8 exponent = 0;   // Applied to integer formats; the 11073 floats carry their own
+        quint16 unit = 0;     // Bluetooth SIG unit UUID
+        QString description;  // Characteristic User Description (0x2901), if any
+
+        bool isValid() const { return valueSize(format) > 0; }
+        static int valueSize(quint8 format); // 0 for formats that are not decoded
+        static DecodePlan fromPresentationFormat(const QByteArray &descriptorValue);
+    };
+
+    bool canDecode(const QBluetoothUuid &characteristic) const;
+    bool decode(const QBluetoothUuid &characteristic, const QByteArray &payload, Sample &out) const;
+    // A run of payloads of one characteristic, as decode() would do them one by one; ok[i] tells
+    // which produced a sample. Plugins get the run through decodeBatch(), IEEE-11073 float plans
+    // go through the batch kernels.
+    void decodeRun(const QBluetoothUuid &characteristic, const QByteArray *payloads, int count, Sample *out, bool *ok) const;
+
+    void setPlan(const QBluetoothUuid &characteristic, const DecodePlan &plan);
+    const DecodePlan *plan(const QBluetoothUuid &characteristic) const;
+    void clearPlans() { m_plans.clear(); }
+
+    void setLayout(const LayoutProgram &layout) { m_layouts.insert(layout.characteristic(), layout); }
+    void clearLayouts() { m_layouts.clear(); }
+
+    void setPlugin(const QBluetoothUuid &characteristic, DecoderPlugin *plugin) { m_plugins.insert(characteristic, plugin); }
+    void clearPlugins() { m_plugins.clear(); }
+
+    static bool decodeWeightMeasurement(const QByteArray &payload, Sample &out);
+    static bool decodeWithPlan(const DecodePlan &plan, const QByteArray &payload, Sample &out);
+
+private:
+    QHash<QBluetoothUuid, DecodePlan> m_plans;
+    QHash<QBluetoothUuid, LayoutProgram> m_layouts;
+    QHash<QBluetoothUuid, DecoderPlugin *> m_plugins;
+};
+
+#endif // SAMPLEDECODER_H
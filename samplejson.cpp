@@ -0,0 +1,64 @@
+#include "samplejson.h"
+#include <QBluetoothAddress>
+
+namespace SampleJson {
+
+QByteArray formatDecimal(qint64 mantissa, int exponent)
+{
+    const bool negative = mantissa < 0;
+    QByteArray digits = QByteArray::number(negative ? -mantissa : mantissa);
+
+    if (exponent >= 0) {
+        if (mantissa != 0)
+            digits.append(QByteArray(exponent, '0'));
+    } else {
+        const int fraction = -exponent;
+        if (digits.size() <= fraction)
+            digits.prepend(QByteArray(fraction - digits.size() + 1, '0'));
+        digits.insert(digits.size() - fraction, '.');
+    }
+    if (negative)
+        digits.prepend('-');
+    return digits;
+}
+
+void append(QByteArray &out, const Sample &sample)
+{
+    out += "{\"device\":\"";
+    out += QBluetoothAddress(sample.device).toString().toLatin1();
+    out += "\",\"characteristic\":\"";
+    out += sample.characteristic.toByteArray(QUuid::WithoutBraces);
+    out += "\",\"ts\":";
+    out += QByteArray::number(sample.timestampUs);
+    if (sample.hasValue()) {
+        out += ",\"value\":";
+        out += formatDecimal(sample.mantissa, sample.exponent);
+        out += ",\"unit\":";
+        out += QByteArray::number(sample.unit);
+    } else if (sample.flags & Sample::Special) {
+        out += ",\"value\":null,\"special\":\"";
+        out += specialName(sample.mantissa);
+        out += '"';
+    }
+    if (sample.flags & Sample::HasSequence) {
+        out += ",\"seq\":";
+        out += QByteArray::number(sample.sequence);
+    }
+    out += '}';
+}
+
+const char *specialName(int special)
+{
+    static const char *const names[] = {"", "nan", "nres", "+inf", "-inf", "reserved"};
+    return special > 0 && special < 6 ? names[special] : "reserved";
+}
+
+QByteArray toJson(const Sample &sample)
+{
+    QByteArray out;
+    out.reserve(160);
+    append(out, sample);
+    return out;
+}
+
+} // namespace SampleJson
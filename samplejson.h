@@ -0,0 +1,22 @@
+#ifndef SAMPLEJSON_H
+#define SAMPLEJSON_H
+
+#include "sample.h"
+
+#include <QByteArray>
+
+// Hand-rolled JSON for the per-sample hot path; QJsonDocument allocates a tree per call.
+namespace SampleJson {
+
+// Exact decimal rendering of mantissa * 10^exponent, e.g. (12345, -3) -> "12.345"
+QByteArray formatDecimal(qint64 mantissa, int exponent);
+
+// {"device":"AA:BB:..","characteristic":"{...}","ts":...,"value":...,"unit":...,"seq":...}
+// Special values carry "value":null,"special":"nan" (or nres, +inf, -inf, reserved)
+void append(QByteArray &out, const Sample &sample);
+const char *specialName(int special); // Sample::SpecialValue -> "nan", "nres", "+inf", ...
+QByteArray toJson(const Sample &sample);
+
+} // namespace SampleJson
+
+#endif // SAMPLEJSON_H
@@ -0,0 +1,218 @@
+#include "scriptdecoder.h"
+#include "gattuuid.h"
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QJSEngine>
+#include <QJSValue>
+#include <cmath>
+#include <limits>
+
+namespace {
+constexpr int kDefaultBudgetMs = 20;
+constexpr int kMaxBacklog = 32; // Payloads queued for the worker before new ones are dropped
+
+// Scripts get the payload as typed views over a single ArrayBuffer
+const char kWrapper[] =
+    "(function (decode) {"
+    "  return function (buffer) { return decode(new Uint8Array(buffer), new DataView(buffer)); };"
+    "})";
+
+// Fewest decimals (up to 6) that represent the number; false for NaN/INF or out of range
+bool toMantissa(double value, qint32 &mantissa, qint8 &exponent)
+{
+    if (!std::isfinite(value))
+        return false;
+    for (int decimals = 0; decimals <= 6; ++decimals) {
+        const double scaled = value * std::pow(10.0, decimals);
+        const double rounded = std::round(scaled);
+        if (std::fabs(rounded) > std::numeric_limits<qint32>::max())
+            return decimals > 0; // Keep the previous, coarser result
+        mantissa = qint32(rounded);
+        exponent = qint8(-decimals);
+        if (std::fabs(scaled - rounded) < 1e-6)
+            break;
+    }
+    return true;
+}
+
+bool toSample(const QJSValue &result, Sample &sample)
+{
+    if (result.isNumber()) {
+        if (!toMantissa(result.toNumber(), sample.mantissa, sample.exponent))
+            return false;
+        sample.flags |= Sample::HasValue;
+        return true;
+    }
+    if (!result.isObject())
+        return false; // null / undefined: nothing to report
+
+    bool produced = false;
+    if (result.hasProperty("mantissa")) {
+        sample.mantissa = result.property("mantissa").toInt();
+        sample.exponent = qint8(result.property("exponent").toInt());
+        produced = true;
+    } else if (result.hasProperty("value")) {
+        produced = toMantissa(result.property("value").toNumber(), sample.mantissa, sample.exponent);
+    }
+    if (produced)
+        sample.flags |= Sample::HasValue;
+
+    const QJSValue unit = result.property("unit");
+    if (unit.isNumber())
+        sample.unit = quint16(unit.toUInt());
+    else if (unit.toString() == QLatin1String("kg"))
+        sample.unit = SigUnit::Kilogram;
+    else if (unit.toString() == QLatin1String("lb"))
+        sample.unit = SigUnit::Pound;
+    if (sample.unit == SigUnit::Pound)
+        sample.flags |= Sample::Imperial;
+
+    if (result.hasProperty("seq")) {
+        sample.sequence = result.property("seq").toUInt();
+        sample.flags |= Sample::HasSequence;
+        produced = true;
+    }
+    return produced;
+}
+}
+
+// --- Worker (script thread) ---
+class ScriptDecoder::Worker : public QObject
+{
+public:
+    explicit Worker(ScriptDecoder *owner) : m_owner(owner), m_engine(nullptr) {}
+
+    void init()
+    {
+        m_engine = new QJSEngine(this);
+        m_wrapper = m_engine->evaluate(QString::fromLatin1(kWrapper));
+        m_owner->m_engine.store(m_engine);
+    }
+
+    void compile(const QBluetoothUuid &characteristic, const QString &source, const QString &fileName)
+    {
+        const QJSValue function = m_engine->evaluate(source, fileName);
+        if (!function.isCallable()) {
+            qWarning() << "Decoder script" << fileName << "does not evaluate to a function:" << function.toString();
+            ++m_owner->m_errors;
+            QMetaObject::invokeMethod(m_owner, [owner = m_owner, characteristic]() {
+                owner->m_characteristics.remove(characteristic);
+            }, Qt::QueuedConnection);
+            return;
+        }
+        m_functions.insert(characteristic, m_wrapper.call({function}));
+        qDebug() << "Compiled decoder script" << fileName;
+    }
+
+    void call(const QByteArray &payload, Sample sample)
+    {
+        const QJSValue function = m_functions.value(sample.characteristic);
+        if (function.isCallable()) {
+            m_engine->setInterrupted(false); // A late interrupt aimed at the previous call
+            m_owner->m_callStartedMs.store(m_owner->m_clock.elapsed());
+            const QJSValue result = function.call({m_engine->toScriptValue(payload)});
+            m_owner->m_callStartedMs.store(-1);
+
+            if (m_engine->isInterrupted()) {
+                m_engine->setInterrupted(false);
+                ++m_owner->m_timeouts;
+                qWarning() << "Decoder script for" << sample.characteristic.toString() << "exceeded its time budget";
+            } else if (result.isError()) {
+                ++m_owner->m_errors;
+                qWarning() << "Decoder script for" << sample.characteristic.toString() << "failed:" << result.toString();
+            } else if (toSample(result, sample)) {
+                QMetaObject::invokeMethod(m_owner, [owner = m_owner, sample]() { emit owner->decoded(sample); },
+                                          Qt::QueuedConnection);
+            }
+        }
+        --m_owner->m_pending;
+    }
+
+private:
+    ScriptDecoder *m_owner;
+    QJSEngine *m_engine;
+    QJSValue m_wrapper;
+    QHash<QBluetoothUuid, QJSValue> m_functions;
+};
+
+// --- ScriptDecoder (owner thread) ---
+ScriptDecoder::ScriptDecoder(QObject *parent)
+    : QObject(parent)
+    , m_worker(new Worker(this))
+    , m_budgetMs(kDefaultBudgetMs)
+    , m_dropped(0)
+    , m_engine(nullptr)
+    , m_callStartedMs(-1)
+    , m_pending(0)
+    , m_timeouts(0)
+    , m_errors(0)
+{
+    m_clock.start();
+    m_thread.setObjectName(QStringLiteral("ScriptDecoder"));
+    m_worker->moveToThread(&m_thread);
+    connect(&m_thread, &QThread::finished, m_worker, &QObject::deleteLater);
+    m_thread.start();
+    QMetaObject::invokeMethod(m_worker, [worker = m_worker]() { worker->init(); }, Qt::QueuedConnection);
+
+    connect(&m_budgetTimer, &QTimer::timeout, this, &ScriptDecoder::checkBudget);
+}
+
+ScriptDecoder::~ScriptDecoder()
+{
+    if (QJSEngine *engine = m_engine.load())
+        engine->setInterrupted(true); // Don't wait for a runaway script
+    m_thread.quit();
+    m_thread.wait();
+}
+
+int ScriptDecoder::loadDirectory(const QString &path)
+{
+    int count = 0;
+    const QFileInfoList files = QDir(path).entryInfoList({QStringLiteral("*.js")}, QDir::Files, QDir::Name);
+    for (const QFileInfo &info : files) {
+        QBluetoothUuid characteristic;
+        if (!GattUuid::parse(info.completeBaseName(), characteristic)) {
+            qWarning() << "Skipping decoder script" << info.filePath() << ": file name is not a characteristic UUID";
+            continue;
+        }
+        QFile file(info.filePath());
+        if (!file.open(QIODevice::ReadOnly)) {
+            qWarning() << "Cannot read decoder script" << info.filePath() << ":" << file.errorString();
+            continue;
+        }
+        const QString source = QString::fromUtf8(file.readAll());
+        m_characteristics.insert(characteristic);
+        QMetaObject::invokeMethod(m_worker, [worker = m_worker, characteristic, source, fileName = info.filePath()]() {
+            worker->compile(characteristic, source, fileName);
+        }, Qt::QueuedConnection);
+        ++count;
+    }
+    return count;
+}
+
+void ScriptDecoder::decode(const QByteArray &payload, const Sample &sample)
+{
+    if (m_pending.load() >= kMaxBacklog) {
+        ++m_dropped; // Script slower than the notification rate
+        return;
+    }
+    ++m_pending;
+    QMetaObject::invokeMethod(m_worker, [worker = m_worker, payload, sample]() { worker->call(payload, sample); },
+                              Qt::QueuedConnection);
+    if (!m_budgetTimer.isActive())
+        m_budgetTimer.start(qMax(1, m_budgetMs / 2));
+}
+
+void ScriptDecoder::checkBudget()
+{
+    const qint64 started = m_callStartedMs.load();
+    if (started >= 0 && m_clock.elapsed() - started > m_budgetMs) {
+        if (QJSEngine *engine = m_engine.load())
+            engine->setInterrupted(true);
+    } else if (m_pending.load() == 0) {
+        m_budgetTimer.stop();
+    }
+}
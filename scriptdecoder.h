@@ -0,0 +1,71 @@
+#ifndef SCRIPTDECODER_H
+#define SCRIPTDECODER_H
+
+#include "sample.h"
+
+#include <QObject>
+#include <QBluetoothUuid>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QSet>
+#include <QThread>
+#include <QTimer>
+#include <atomic>
+
+class QJSEngine;
+
+// JavaScript decoders for prototyping vendor characteristics without rebuilding.
+//
+// Each <uuid>.js file in the script directory ("fff4.js" or a full UUID) must evaluate to a
+// function; it is compiled once and called per notification as f(bytes, view) with a Uint8Array
+// and a DataView over the payload. It returns a number (the value), an object
+// {value | mantissa + exponent, unit: "kg" | "lb" | SIG unit number, seq}, or null for nothing.
+//
+// Scripts run on their own thread with their own QJSEngine, so characteristicChanged() only
+// queues the payload. A call that runs past the time budget is interrupted; while the worker is
+// behind, new payloads beyond a small backlog are dropped. Results arrive through decoded() on
+// the owner's thread.
+class ScriptDecoder : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ScriptDecoder(QObject *parent = nullptr);
+    ~ScriptDecoder();
+
+    int loadDirectory(const QString &path); // Returns the number of scripts queued for compiling
+    bool handles(const QBluetoothUuid &characteristic) const { return m_characteristics.contains(characteristic); }
+
+    // `sample` carries device, characteristic and timestamp; the script fills in the rest
+    void decode(const QByteArray &payload, const Sample &sample);
+
+    void setBudgetMs(int msec) { m_budgetMs = qMax(1, msec); }
+    quint64 timeouts() const { return m_timeouts.load(); }
+    quint64 dropped() const { return m_dropped; }
+    quint64 errors() const { return m_errors.load(); }
+
+signals:
+    void decoded(const Sample &sample);
+
+private:
+    class Worker;
+
+    void checkBudget();
+
+    QThread m_thread;
+    Worker *m_worker;
+    QSet<QBluetoothUuid> m_characteristics;
+    QTimer m_budgetTimer;
+    QElapsedTimer m_clock;
+    int m_budgetMs;
+    quint64 m_dropped;
+
+    // Shared with the worker thread
+    std::atomic<QJSEngine *> m_engine;
+    std::atomic<qint64> m_callStartedMs; // -1 while idle
+    std::atomic<int> m_pending;
+    std::atomic<quint64> m_timeouts;
+    std::atomic<quint64> m_errors;
+};
+
+#endif // SCRIPTDECODER_H
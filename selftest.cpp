@@ -0,0 +1,972 @@
+#include "selftest.h"
+#include "allocationcounter.h"
+#include "calibration.h"
+#include "gattawait.h"
+#include "httpserver.h"
+#include "layoutprogram.h"
+#include "mqttpublisher.h"
+#include "samplebus.h"
+#include "sampledecoder.h"
+#include "streamserver.h"
+#include "timingwheel.h"
+#include "tracer.h"
+#include <QCoreApplication>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QList>
+#include <QLocalSocket>
+#include <QLowEnergyController>
+#include <QLowEnergyServiceData>
+#include <QPair>
+#include <QRandomGenerator>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QThread>
+#include <QTimer>
+#include <QtEndian>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <ctime>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+#if defined(Q_OS_UNIX) && !defined(Q_OS_ANDROID)
+#include "blescale_shm.h"
+#define BLESCALE_HAVE_SHM 1
+#endif
+
+namespace {
+constexpr qint64 kBenchmarkMs = 300; // Per path
+
+using Points = QList<Calibration::Point>;
+
+// The Weight Measurement format as a layout, to compare the interpreter with the handwritten decoder
+const char kWeightLayout[] = R"({
+    "name": "weight measurement", "characteristic": "2a9d", "minLength": 3,
+    "fields": [
+        {"name": "flags", "offset": 0, "type": "u8"},
+        {"name": "kg", "offset": 1, "type": "u16", "multiplier": 5, "exponent": -3, "unit": "kg", "role": "value",
+         "when": {"field": "flags", "mask": 1, "equals": 0}},
+        {"name": "lb", "offset": 1, "type": "u16", "exponent": -2, "unit": "lb", "role": "value",
+         "when": {"field": "flags", "mask": 1, "equals": 1}}
+    ]
+})";
+
+volatile qint64 g_sink; // Benchmark results land here so the work is not optimised away
+
+// Weight Measurement payloads: SI and imperial, across the whole 16-bit range
+QList<QByteArray> weightPayloads(int count)
+{
+    QList<QByteArray> payloads;
+    payloads.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        const quint16 raw = quint16(i * 2654435761u >> 16);
+        payloads.append(QByteArray(1, char(i & 1)).append(char(raw & 0xFF)).append(char(raw >> 8)));
+    }
+    return payloads;
+}
+
+class Checks
+{
+public:
+    void expect(const char *what, qint64 actual, qint64 expected)
+    {
+        ++m_count;
+        if (actual == expected)
+            return;
+        ++m_failed;
+        qWarning().nospace() << "Self-test: " << what << ": expected " << expected << ", got " << actual;
+    }
+    void expect(const char *what, bool condition) { expect(what, condition ? 1 : 0, 1); }
+
+    bool passed() const { return m_failed == 0; }
+    int count() const { return m_count; }
+    int failed() const { return m_failed; }
+
+private:
+    int m_count = 0;
+    int m_failed = 0;
+};
+
+Sample massSample(quint64 device, qint32 mantissa, qint8 exponent, quint16 unit)
+{
+    Sample sample;
+    sample.device = device;
+    sample.mantissa = mantissa;
+    sample.exponent = exponent;
+    sample.unit = unit;
+    sample.flags = Sample::HasValue;
+    return sample;
+}
+
+// Output mantissa of fromMilligrams, or a marker that it was rejected
+qint64 converted(qint64 mg, Calibration::Unit unit)
+{
+    Sample sample;
+    return Calibration::fromMilligrams(mg, unit, sample) ? sample.mantissa : std::numeric_limits<qint64>::min();
+}
+
+qint64 milligrams(qint32 mantissa, qint8 exponent, quint16 unit)
+{
+    qint64 mg = 0;
+    return Calibration::toMilligrams(massSample(1, mantissa, exponent, unit), mg) ? mg : std::numeric_limits<qint64>::min();
+}
+
+// --- Calibration ---
+void checkCalibration(Checks &checks)
+{
+    constexpr qint64 rejected = std::numeric_limits<qint64>::min();
+
+    // Rounding: half away from zero, either sign, either denominator sign
+    checks.expect("divRound(5, 10)", Calibration::divRound(5, 10), 1);
+    checks.expect("divRound(4, 10)", Calibration::divRound(4, 10), 0);
+    checks.expect("divRound(-5, 10)", Calibration::divRound(-5, 10), -1);
+    checks.expect("divRound(-4, 10)", Calibration::divRound(-4, 10), 0);
+    checks.expect("divRound(15, 10)", Calibration::divRound(15, 10), 2);
+    checks.expect("divRound(-15, 10)", Calibration::divRound(-15, 10), -2);
+    checks.expect("divRound(5, -10)", Calibration::divRound(5, -10), -1);
+    checks.expect("divRound(-5, -10)", Calibration::divRound(-5, -10), 1);
+    checks.expect("divRound(0, 7)", Calibration::divRound(0, 7), 0);
+
+    // Into milligrams
+    checks.expect("1.2345 kg", milligrams(12345, -4, SigUnit::Kilogram), 1234500);
+    checks.expect("0.0000015 kg", milligrams(15, -7, SigUnit::Kilogram), 2);
+    checks.expect("-0.0000015 kg", milligrams(-15, -7, SigUnit::Kilogram), -2);
+    checks.expect("0.0000014 kg", milligrams(14, -7, SigUnit::Kilogram), 1);
+    checks.expect("1 lb", milligrams(1, 0, SigUnit::Pound), 453592);
+    checks.expect("0.01 lb", milligrams(1, -2, SigUnit::Pound), 4536);
+    checks.expect("-0.01 lb", milligrams(-1, -2, SigUnit::Pound), -4536);
+    checks.expect("non-mass unit", milligrams(1, 0, 0x2763), rejected);
+
+    // Out of milligrams, at each unit's half-step boundary
+    checks.expect("150 mg in kg", converted(150, Calibration::Kilogram), 2);
+    checks.expect("149 mg in kg", converted(149, Calibration::Kilogram), 1);
+    checks.expect("-150 mg in kg", converted(-150, Calibration::Kilogram), -2);
+    checks.expect("-149 mg in kg", converted(-149, Calibration::Kilogram), -1);
+    checks.expect("453592 mg in lb", converted(453592, Calibration::Pound), 1000);
+    checks.expect("227 mg in lb", converted(227, Calibration::Pound), 1);
+    checks.expect("226 mg in lb", converted(226, Calibration::Pound), 0);
+    checks.expect("-227 mg in lb", converted(-227, Calibration::Pound), -1);
+
+    // Mantissa limits: qint32 after rounding, and no overflow past the supported range
+    checks.expect("kg mantissa at qint32 max", converted(214748364700, Calibration::Kilogram), 2147483647);
+    checks.expect("kg mantissa past qint32 max", converted(214748364750, Calibration::Kilogram), rejected);
+    checks.expect("kg mantissa at qint32 min", converted(-214748364800, Calibration::Kilogram), -2147483648LL);
+    checks.expect("kg mantissa past qint32 min", converted(-214748364850, Calibration::Kilogram), rejected);
+    checks.expect("lb beyond range", converted(std::numeric_limits<qint64>::max() / 1000, Calibration::Pound), rejected);
+
+    // Curves: offset, two-point gain with extrapolation, saturation
+    const Calibration::Curve offset(Points{{0, 500}});
+    checks.expect("offset curve", offset.apply(1000), 1500);
+    const Calibration::Curve gain(Points{{0, 0}, {10000, 10050}});
+    checks.expect("gain curve inside", gain.apply(5000), 5025);
+    checks.expect("gain curve above", gain.apply(20000), 20100);
+    checks.expect("gain curve below", gain.apply(-10000), -10050);
+    const Calibration::Curve steep(Points{{0, 0}, {1000, 3999}});
+    checks.expect("steep curve saturates", steep.apply(std::numeric_limits<qint64>::max()), qint64(1) << 46);
+    checks.expect("steep curve saturates below", steep.apply(std::numeric_limits<qint64>::min()), -(qint64(1) << 46));
+    checks.expect("saturated weight in lb", converted(steep.apply(std::numeric_limits<qint64>::max()), Calibration::Pound), rejected);
+    const Calibration::Curve restored = Calibration::Curve::fromBlob(gain.toBlob());
+    checks.expect("curve blob round trip", restored.points().size() == 2 && restored.apply(20000) == 20100);
+
+    // Text
+    qint64 mg = 0;
+    checks.expect("parse 1.5 kg", Calibration::parseMilligrams(QStringLiteral("1.5"), mg) ? mg : rejected, 1500000);
+    checks.expect("parse -0.0005 kg", Calibration::parseMilligrams(QStringLiteral("-0.0005"), mg) ? mg : rejected, -500);
+    checks.expect("parse +2 kg", Calibration::parseMilligrams(QStringLiteral("+2"), mg) ? mg : rejected, 2000000);
+    checks.expect("parse below 1 mg", !Calibration::parseMilligrams(QStringLiteral("1.0000001"), mg));
+    checks.expect("parse empty", !Calibration::parseMilligrams(QString(), mg));
+    checks.expect("format -0.0005 kg", Calibration::formatKg(-500) == "-0.000500");
+
+    // Whole stage: curve, then kg to lb, flags and unit rewritten
+    Calibration calibration(Calibration::Pound);
+    calibration.setCurve(1, Calibration::Curve(Points{{0, 1000}}));
+    Sample samples[] = {massSample(1, 1000, -3, SigUnit::Kilogram), massSample(2, 1000, -3, SigUnit::Kilogram),
+                        massSample(2, 7, 0, 0x2763)};
+    calibration.apply(samples, 3);
+    checks.expect("calibrated 1 kg in lb", samples[0].mantissa, 2207);
+    checks.expect("calibrated unit", samples[0].unit, SigUnit::Pound);
+    checks.expect("calibrated imperial flag", (samples[0].flags & Sample::Imperial) != 0);
+    checks.expect("uncalibrated 1 kg in lb", samples[1].mantissa, 2205);
+    checks.expect("non-mass sample untouched", samples[2].mantissa == 7 && samples[2].unit == 0x2763);
+
+    // Out of range: reported as +/-INF, never passed on in the original unit
+    Calibration kilograms(Calibration::Kilogram);
+    kilograms.setCurve(1, steep);
+    Sample extremes[] = {massSample(1, 2000000000, 0, SigUnit::Pound), massSample(1, -2000000000, 0, SigUnit::Pound),
+                         massSample(1, 100000, 0, SigUnit::Kilogram)};
+    kilograms.apply(extremes, 3);
+    checks.expect("lb beyond range is +INF", extremes[0].flags & Sample::Special && !extremes[0].hasValue()
+                  && extremes[0].mantissa == Sample::PositiveInfinity);
+    checks.expect("lb beyond range is -INF", extremes[1].flags & Sample::Special && extremes[1].mantissa == Sample::NegativeInfinity);
+    checks.expect("calibrated past kg mantissa is +INF", extremes[2].flags & Sample::Special
+                  && extremes[2].mantissa == Sample::PositiveInfinity);
+}
+
+// --- Decoding ---
+void checkDecoding(Checks &checks)
+{
+    // SFLOAT run longer than one kernel chunk: values, NaN, and payloads too short for a value
+    const QBluetoothUuid characteristic(QStringLiteral("0000fff1-0000-1000-8000-00805f9b34fb"));
+    SampleDecoder::DecodePlan plan;
+    plan.format = 0x16;
+    plan.unit = SigUnit::Kilogram;
+    SampleDecoder decoder;
+    decoder.setPlan(characteristic, plan);
+
+    constexpr int count = 150;
+    QList<QByteArray> payloads;
+    for (int i = 0; i < count; ++i) {
+        if (i % 10 == 9)
+            payloads.append(QByteArray(1, '\x01'));
+        else if (i % 10 == 8)
+            payloads.append(QByteArray::fromHex("ff07"));
+        else
+            payloads.append(QByteArray(1, char(i & 0xFF)).append(char(0xF0 | (i >> 8)))); // i * 10^-1
+    }
+    QList<Sample> run(count);
+    bool ok[count];
+    decoder.decodeRun(characteristic, payloads.constData(), count, run.data(), ok);
+
+    int mismatches = 0;
+    for (int i = 0; i < count; ++i) {
+        Sample single;
+        const bool singleOk = decoder.decode(characteristic, payloads.at(i), single);
+        if (ok[i] != singleOk || (singleOk && (run.at(i).mantissa != single.mantissa || run.at(i).exponent != single.exponent
+                                               || run.at(i).flags != single.flags || run.at(i).unit != single.unit)))
+            ++mismatches;
+    }
+    checks.expect("SFLOAT run matches single decodes", mismatches, 0);
+    checks.expect("SFLOAT 12.3", run.at(123).mantissa == 123 && run.at(123).exponent == -1 && run.at(123).hasValue());
+    checks.expect("SFLOAT NaN", (run.at(128).flags & Sample::Special) && run.at(128).mantissa == Sample::NotANumber);
+    checks.expect("short payload rejected", !ok[129]);
+
+    // A compiled layout agrees with the handwritten decoder it mirrors
+    LayoutProgram layout;
+    QString error;
+    checks.expect("weight layout compiles", LayoutProgram::compile(kWeightLayout, layout, error));
+    const QList<QByteArray> weights = weightPayloads(512);
+    mismatches = 0;
+    for (const QByteArray &payload : weights) {
+        Sample fromLayout;
+        Sample handwritten;
+        if (layout.run(payload, fromLayout) != SampleDecoder::decodeWeightMeasurement(payload, handwritten)
+            || fromLayout.mantissa != handwritten.mantissa || fromLayout.exponent != handwritten.exponent
+            || fromLayout.unit != handwritten.unit || fromLayout.flags != handwritten.flags)
+            ++mismatches;
+    }
+    checks.expect("weight layout matches handwritten decoder", mismatches, 0);
+    Sample rejected;
+    checks.expect("weight layout rejects short payload", !layout.run(QByteArray::fromHex("0001"), rejected));
+}
+
+// --- Sample bus ---
+void checkSampleBus(Checks &checks)
+{
+    TimerService timers;
+    timers.setManualClock(true);
+    SampleBus bus(&timers);
+
+    // Every subscriber sees the one shared record; ChangeOnly skips repeated values
+    QList<const Sample *> seen;
+    for (int i = 0; i < 8; ++i)
+        bus.subscribe("check", {}, [&seen](const SampleRef &ref) { seen.append(&ref.sample()); });
+    int changes = 0;
+    SampleBus::Options changeOnly;
+    changeOnly.rate = SampleBus::ChangeOnly;
+    bus.subscribe("changes", changeOnly, [&changes](const SampleRef &) { ++changes; });
+
+    const SampleRef first(massSample(1, 100, -3, SigUnit::Kilogram), QByteArray::fromHex("006400"));
+    bus.publish(first);
+    bus.publish(SampleRef(massSample(1, 100, -3, SigUnit::Kilogram), QByteArray()));
+    bus.publish(SampleRef(massSample(1, 101, -3, SigUnit::Kilogram), QByteArray()));
+    checks.expect("bus delivers to every subscriber", seen.size(), 24);
+    checks.expect("bus shares the record", std::all_of(seen.cbegin(), seen.cbegin() + 8, [&first](const Sample *sample) {
+                      return sample == &first.sample();
+                  }));
+    checks.expect("ChangeOnly skips repeats", changes, 2);
+}
+
+// --- MQTT keep-alive ---
+// An in-process broker that accepts CONNECT and then goes silent, as the far end of a half-open
+// connection does: the publisher must give up on the missing PINGRESP and connect again. With a
+// 1 s keep-alive that takes about 2.5 s (ping after 0.5 s, deadline 1 s, reconnect delay 1 s).
+void checkMqttKeepAlive(Checks &checks)
+{
+    QTcpServer broker;
+    if (!broker.listen(QHostAddress::LocalHost, 0)) {
+        checks.expect("MQTT test broker listening", false);
+        return;
+    }
+    QEventLoop loop;
+    int connections = 0;
+    QObject::connect(&broker, &QTcpServer::newConnection, &loop, [&]() {
+        while (QTcpSocket *socket = broker.nextPendingConnection()) {
+            QObject::connect(socket, &QTcpSocket::readyRead, socket, [socket]() {
+                const QByteArray data = socket->readAll();
+                if (!data.isEmpty() && quint8(data.at(0)) == 0x10) // CONNECT; PINGREQ is never answered
+                    socket->write(QByteArray("\x20\x02\x00\x00", 4));
+            });
+            if (++connections == 2)
+                loop.quit();
+        }
+    });
+
+    MqttPublisher::Settings settings;
+    settings.port = broker.serverPort();
+    settings.keepAliveSecs = 1;
+    MqttPublisher publisher;
+    publisher.setSettings(settings);
+    publisher.start();
+    QTimer::singleShot(5000, &loop, &QEventLoop::quit);
+    loop.exec();
+    publisher.stop();
+    checks.expect("MQTT reconnects after a missing PINGRESP", connections, 2);
+}
+
+// --- Allocations ---
+// The steady state of MainWindow::decodeNotifications(): a batch decoded into a stack arena,
+// calibrated, wrapped in pooled records and published to every-sample, change-only and
+// rate-limited subscribers, with the rate-limited flush running on the timer. After a warm-up
+// (hashes, record pool, timer slab) none of it may touch the heap.
+void checkAllocations(Checks &checks)
+{
+    if (!AllocationCounter::isEnabled()) {
+        qDebug() << "Self-test: allocation check skipped; build with CONFIG+=alloccount to run it";
+        return;
+    }
+
+    TimerService timers;
+    timers.setManualClock(true);
+    SampleBus bus(&timers);
+    qint64 sum = 0;
+    bus.subscribe("every", {}, [&sum](const SampleRef &ref) { sum += ref.sample().mantissa; });
+    SampleBus::Options changeOnly;
+    changeOnly.rate = SampleBus::ChangeOnly;
+    bus.subscribe("changes", changeOnly, [&sum](const SampleRef &ref) { sum += ref.sample().mantissa; });
+    SampleBus::Options latest;
+    latest.rate = SampleBus::LatestOnly;
+    latest.maxHz = 10.0;
+    bus.subscribe("latest", latest, [&sum](const SampleRef &ref) { sum += ref.sample().mantissa; });
+
+    const QBluetoothUuid weight(QBluetoothUuid::CharacteristicType::WeightMeasurement);
+    const QBluetoothUuid vendor(QStringLiteral("0000fff1-0000-1000-8000-00805f9b34fb"));
+    SampleDecoder decoder;
+    SampleDecoder::DecodePlan plan;
+    plan.format = 0x16;
+    plan.unit = SigUnit::Kilogram;
+    decoder.setPlan(vendor, plan);
+    Calibration calibration(Calibration::Pound);
+    calibration.setCurve(1, Calibration::Curve(Points{{0, 250}}));
+
+    // A run of Weight Measurements, then a run of SFLOAT kilograms
+    QList<QBluetoothUuid> characteristics;
+    QList<QByteArray> payloads = weightPayloads(16);
+    for (int i = 0; i < 16; ++i) {
+        characteristics.append(weight);
+        payloads.append(QByteArray(1, char(i * 7)).append(char(0xF0)));
+    }
+    while (characteristics.size() < payloads.size())
+        characteristics.append(vendor);
+    const int count = int(payloads.size());
+
+    auto ingest = [&]() {
+        std::array<std::byte, 16 * 1024> buffer;
+        std::pmr::monotonic_buffer_resource arena(buffer.data(), buffer.size());
+        std::pmr::vector<Sample> samples(count, &arena);
+        bool *decoded = static_cast<bool *>(arena.allocate(count * sizeof(bool), alignof(bool)));
+        for (int i = 0; i < count; ++i) {
+            samples[i].device = 1;
+            samples[i].characteristic = characteristics.at(i);
+            samples[i].timestampUs = timers.nowMs() * 1000 + i;
+        }
+        decoder.decodeRun(weight, payloads.constData(), 16, samples.data(), decoded);
+        decoder.decodeRun(vendor, payloads.constData() + 16, count - 16, samples.data() + 16, decoded + 16);
+        calibration.apply(samples.data(), count);
+        for (int i = 0; i < count; ++i) {
+            if (decoded[i])
+                bus.publish(SampleRef(samples[i], payloads.at(i)));
+        }
+        timers.advanceBy(40);
+    };
+    for (int i = 0; i < 20; ++i)
+        ingest();
+    const quint64 before = AllocationCounter::count();
+    for (int i = 0; i < 200; ++i)
+        ingest();
+    checks.expect("heap allocations in steady-state ingestion", qint64(AllocationCounter::count() - before), 0);
+    g_sink = sum;
+}
+
+// Runs the event loop until done() holds or timeoutMs have passed; returns done()
+template<typename Done>
+bool waitUntil(Done done, int timeoutMs)
+{
+    QEventLoop loop;
+    QTimer poll;
+    QObject::connect(&poll, &QTimer::timeout, &loop, [&]() {
+        if (done())
+            loop.quit();
+    });
+    poll.start(1);
+    QTimer::singleShot(timeoutMs, &loop, &QEventLoop::quit);
+    if (!done())
+        loop.exec();
+    return done();
+}
+
+// Calls step(count) until kBenchmarkMs have passed; returns items per second
+template<typename Step>
+qint64 throughput(Step step)
+{
+    QElapsedTimer timer;
+    timer.start();
+    qint64 items = 0;
+    while (timer.elapsed() < kBenchmarkMs)
+        items += step();
+    return items * 1000000000 / qMax<qint64>(1, timer.nsecsElapsed());
+}
+
+qint64 benchmarkCalibration()
+{
+    // Runs of one device, as decodeNotifications produces them, through a three-point curve into lb
+    constexpr int batchSize = 1024;
+    Calibration calibration(Calibration::Pound);
+    QList<Sample> input;
+    input.reserve(batchSize);
+    for (quint64 device = 1; device <= 8; ++device) {
+        calibration.setCurve(device, Calibration::Curve(Points{{0, 120}, {50000000, 50100000}, {150000000, 150250000}}));
+        for (int i = 0; i < batchSize / 8; ++i)
+            input.append(massSample(device, 40000 + i * 37, -3, SigUnit::Kilogram));
+    }
+    QList<Sample> batch = input;
+    return throughput([&]() {
+        std::copy(input.cbegin(), input.cend(), batch.begin()); // apply() works in place
+        calibration.apply(batch.data(), batchSize);
+        return batchSize;
+    });
+}
+
+// Interpreted layout against the handwritten Weight Measurement decoder, same payloads
+QPair<qint64, qint64> benchmarkLayout()
+{
+    LayoutProgram layout;
+    QString error;
+    if (!LayoutProgram::compile(kWeightLayout, layout, error))
+        return {0, 0};
+    const QList<QByteArray> payloads = weightPayloads(1024);
+    const qint64 interpreted = throughput([&]() {
+        qint64 sum = 0;
+        for (const QByteArray &payload : payloads) {
+            Sample sample;
+            if (layout.run(payload, sample))
+                sum += sample.mantissa;
+        }
+        g_sink = sum;
+        return payloads.size();
+    });
+    const qint64 handwritten = throughput([&]() {
+        qint64 sum = 0;
+        for (const QByteArray &payload : payloads) {
+            Sample sample;
+            if (SampleDecoder::decodeWeightMeasurement(payload, sample))
+                sum += sample.mantissa;
+        }
+        g_sink = sum;
+        return payloads.size();
+    });
+    return {interpreted, handwritten};
+}
+
+// Cost of publish() with that many direct EverySample subscribers, in nanoseconds per sample
+qint64 benchmarkFanOut(int subscribers)
+{
+    TimerService timers;
+    timers.setManualClock(true);
+    SampleBus bus(&timers);
+    qint64 sum = 0;
+    for (int i = 0; i < subscribers; ++i)
+        bus.subscribe("benchmark", {}, [&sum](const SampleRef &ref) { sum += ref.sample().mantissa; });
+
+    QList<SampleRef> samples;
+    for (int i = 0; i < 256; ++i)
+        samples.append(SampleRef(massSample(1, i, -3, SigUnit::Kilogram), QByteArray::fromHex("000000")));
+    const qint64 perSecond = throughput([&]() {
+        for (const SampleRef &sample : std::as_const(samples))
+            bus.publish(sample);
+        return samples.size();
+    });
+    g_sink = sum;
+    return 1000000000 / qMax<qint64>(1, perSecond);
+}
+
+// Cost of one instant() trace event in nanoseconds, with tracing off and on. Leaves the tracer
+// as it was, minus any events recorded before.
+QPair<double, double> benchmarkTracer()
+{
+    Tracer &tracer = Tracer::instance();
+    const bool wasEnabled = tracer.isEnabled();
+    constexpr int eventsPerStep = 4096;
+    const auto nsPerEvent = [&]() {
+        const qint64 perSecond = throughput([&]() {
+            for (int i = 0; i < eventsPerStep; ++i)
+                tracer.instant("benchmark", quint64(i));
+            return eventsPerStep;
+        });
+        return 1e9 / double(qMax<qint64>(1, perSecond));
+    };
+    tracer.setEnabled(false);
+    const double off = nsPerEvent();
+    tracer.setEnabled(true);
+    const double on = nsPerEvent();
+    tracer.setEnabled(wasEnabled);
+    tracer.clear();
+    return {off, on};
+}
+
+// Publishes 1,000 samples/s for two seconds, catching up on every 1 ms timer tick however late
+// it comes; each sample carries its publish time on `clock` as timestampUs. Returns the count.
+template<typename Publish>
+qint64 publishAtRate(const QElapsedTimer &clock, Publish publish)
+{
+    constexpr qint64 samplesPerSecond = 1000;
+    constexpr qint64 durationMs = 2000;
+    Sample sample = massSample(1, 70000, -3, SigUnit::Kilogram);
+    qint64 published = 0;
+    QTimer publisher;
+    publisher.setTimerType(Qt::PreciseTimer);
+    const qint64 startMs = clock.elapsed();
+    QObject::connect(&publisher, &QTimer::timeout, &publisher, [&]() {
+        const qint64 due = qMin(durationMs, clock.elapsed() - startMs) * samplesPerSecond / 1000;
+        for (; published < due; ++published) {
+            sample.timestampUs = clock.nsecsElapsed() / 1000;
+            sample.sequence = quint32(published);
+            publish(sample);
+        }
+    });
+    publisher.start(1);
+    waitUntil([&]() { return clock.elapsed() - startMs >= durationMs; }, durationMs + 1000);
+    return published;
+}
+
+struct StreamFanOutResult
+{
+    qint64 published = 0;
+    qint64 delivered = 0;     // Samples received, summed over all clients
+    qint64 latencyAvgUs = 0;  // publish() to the client having parsed the sample
+    qint64 latencyMaxUs = 0;
+    double cpuPercent = 0.0;  // Whole process, so including the in-process clients
+    quint64 lost = 0;         // Evicted clients (binary stream) or dropped batches (SSE)
+
+    void received(qint64 nowUs, qint64 timestampUs)
+    {
+        const qint64 latencyUs = nowUs - timestampUs;
+        m_latencySumUs += latencyUs;
+        latencyMaxUs = qMax(latencyMaxUs, latencyUs);
+        ++delivered;
+    }
+    void finish(qint64 wallMs, std::clock_t cpu)
+    {
+        cpuPercent = 100.0 * 1000 * double(cpu) / CLOCKS_PER_SEC / qMax<qint64>(1, wallMs);
+        latencyAvgUs = m_latencySumUs / qMax<qint64>(1, delivered);
+    }
+    QByteArray toJson() const
+    {
+        return "{\"published\":" + QByteArray::number(published)
+               + ",\"delivered\":" + QByteArray::number(delivered)
+               + ",\"latency_avg_us\":" + QByteArray::number(latencyAvgUs)
+               + ",\"latency_max_us\":" + QByteArray::number(latencyMaxUs)
+               + ",\"cpu_percent\":" + QByteArray::number(cpuPercent, 'f', 1)
+               + ",\"lost\":" + QByteArray::number(lost) + '}';
+    }
+
+private:
+    qint64 m_latencySumUs = 0;
+};
+
+// The binary stream to 50 local socket clients, which run in this process and parse every frame
+StreamFanOutResult benchmarkStreamFanOut()
+{
+    constexpr int clientCount = 50;
+    StreamFanOutResult result;
+    QElapsedTimer clock;
+    clock.start();
+
+    StreamServer server;
+    const QString name = QString("blescale-stream-bench-%1").arg(QCoreApplication::applicationPid());
+    if (!server.listen(0, name))
+        return result;
+    std::vector<QByteArray> buffers(clientCount);
+    std::vector<std::unique_ptr<QLocalSocket>> clients;
+    for (int i = 0; i < clientCount; ++i) {
+        clients.push_back(std::make_unique<QLocalSocket>());
+        QLocalSocket *socket = clients.back().get();
+        QByteArray *buffer = &buffers[i];
+        QObject::connect(socket, &QLocalSocket::readyRead, socket, [&, socket, buffer]() {
+            buffer->append(socket->readAll());
+            const qint64 nowUs = clock.nsecsElapsed() / 1000;
+            qsizetype offset = 0;
+            while (buffer->size() - offset >= 8) {
+                const uchar *frame = reinterpret_cast<const uchar *>(buffer->constData()) + offset;
+                const qsizetype length = qsizetype(qFromLittleEndian<quint32>(frame)) + 4;
+                if (buffer->size() - offset < length)
+                    break;
+                const int count = qFromLittleEndian<quint16>(frame + 6);
+                for (int record = 0; record < count; ++record)
+                    result.received(nowUs, qFromLittleEndian<qint64>(frame + 8 + record * StreamServer::RecordSize + 24));
+                offset += length;
+            }
+            buffer->remove(0, offset);
+        });
+        socket->connectToServer(name);
+    }
+    if (!waitUntil([&]() { return server.clientCount() == clientCount; }, 2000))
+        qWarning() << "Stream benchmark:" << server.clientCount() << "of" << clientCount << "clients connected";
+
+    const qint64 startMs = clock.elapsed();
+    const std::clock_t cpuStart = std::clock();
+    result.published = publishAtRate(clock, [&server](const Sample &sample) { server.publish(sample); });
+    waitUntil([&]() { return result.delivered >= result.published * server.clientCount(); }, 1000);
+    result.finish(clock.elapsed() - startMs, std::clock() - cpuStart);
+    result.lost = server.evictedClients();
+    server.close();
+    return result;
+}
+
+// Server-Sent Events to 200 clients at the default rate cap. The clients send the request a
+// browser would and scan every event for the samples' "ts" fields.
+StreamFanOutResult benchmarkSseFanOut()
+{
+    constexpr int clientCount = 200;
+    StreamFanOutResult result;
+    QElapsedTimer clock;
+    clock.start();
+
+    HttpServer server;
+    if (!server.listen(0))
+        return result;
+    std::vector<QByteArray> buffers(clientCount);
+    std::vector<std::unique_ptr<QTcpSocket>> clients;
+    for (int i = 0; i < clientCount; ++i) {
+        clients.push_back(std::make_unique<QTcpSocket>());
+        QTcpSocket *socket = clients.back().get();
+        QByteArray *buffer = &buffers[i];
+        QObject::connect(socket, &QTcpSocket::connected, socket, [socket]() {
+            socket->write("GET /api/stream HTTP/1.1\r\nHost: 127.0.0.1\r\nAccept: text/event-stream\r\n\r\n");
+        });
+        QObject::connect(socket, &QTcpSocket::readyRead, socket, [&, socket, buffer]() {
+            buffer->append(socket->readAll());
+            const qint64 nowUs = clock.nsecsElapsed() / 1000;
+            const qsizetype end = buffer->lastIndexOf("\n\n");
+            if (end < 0)
+                return;
+            for (qsizetype ts = buffer->indexOf("\"ts\":"); ts >= 0 && ts < end; ts = buffer->indexOf("\"ts\":", ts + 5)) {
+                const qsizetype comma = buffer->indexOf(',', ts);
+                result.received(nowUs, buffer->mid(ts + 5, comma - ts - 5).toLongLong());
+            }
+            buffer->remove(0, end + 2);
+        });
+        socket->connectToHost(QHostAddress::LocalHost, server.serverPort());
+    }
+    if (!waitUntil([&]() { return server.streamClientCount() == clientCount; }, 5000))
+        qWarning() << "SSE benchmark:" << server.streamClientCount() << "of" << clientCount << "clients connected";
+
+    const qint64 startMs = clock.elapsed();
+    const std::clock_t cpuStart = std::clock();
+    result.published = publishAtRate(clock, [&server](const Sample &sample) { server.publish(sample); });
+    waitUntil([&]() { return result.delivered >= result.published * server.streamClientCount(); }, 1000);
+    result.finish(clock.elapsed() - startMs, std::clock() - cpuStart);
+    result.lost = server.droppedStreamBatches();
+    return result;
+}
+
+struct GattWorkflowResult
+{
+    bool available = false;    // False without a peripheral-role controller to host the services
+    qint64 chainUs = 0;        // Three services' details, one after the other
+    qint64 coroutineUs = 0;    // The same three at once, as openServices() discovers them
+    qint64 chainNsPerOp = 0;   // Zero link latency: the cost of each mechanism alone
+    qint64 coroutineNsPerOp = 0;
+};
+
+constexpr int kLinkLatencyMs = 30; // Per detail discovery
+
+// Stands in for the link: the service's details are reported discovered latencyMs from now,
+// independently of other requests, as a stack answering from its attribute cache does
+void answerDetails(QLowEnergyService *service, int latencyMs)
+{
+    QTimer::singleShot(latencyMs, Qt::PreciseTimer, service, [service]() {
+        emit service->stateChanged(QLowEnergyService::RemoteServiceDiscovered);
+    });
+}
+
+// The slot chain the coroutine workflow replaced: each discovery starts when the previous one ends
+qint64 discoverInChain(const QList<QLowEnergyService *> &services, int latencyMs)
+{
+    QObject receiver;
+    int next = 0;
+    std::function<void()> step = [&]() {
+        if (next == services.size())
+            return;
+        QLowEnergyService *service = services.at(next);
+        QObject::connect(service, &QLowEnergyService::stateChanged, &receiver, [&, service](QLowEnergyService::ServiceState state) {
+            if (state != QLowEnergyService::RemoteServiceDiscovered)
+                return;
+            QObject::disconnect(service, nullptr, &receiver, nullptr);
+            ++next;
+            step();
+        });
+        answerDetails(service, latencyMs);
+    };
+    QElapsedTimer timer;
+    timer.start();
+    step();
+    waitUntil([&]() { return next == services.size(); }, 10000);
+    return timer.nsecsElapsed();
+}
+
+Gatt::Task<> discoverSequentially(QList<QLowEnergyService *> services, int latencyMs)
+{
+    for (QLowEnergyService *service : services) {
+        answerDetails(service, latencyMs);
+        co_await Gatt::discoverDetails(service, Gatt::Context());
+    }
+}
+
+Gatt::Task<> discoverConcurrently(QList<QLowEnergyService *> services, int latencyMs)
+{
+    std::vector<Gatt::Task<Gatt::Result<>>> details;
+    for (QLowEnergyService *service : services) {
+        answerDetails(service, latencyMs);
+        details.push_back(Gatt::discoverDetails(service, Gatt::Context()));
+    }
+    co_await Gatt::whenAll(std::move(details));
+}
+
+template<typename Workflow>
+qint64 runWorkflow(Workflow workflow)
+{
+    QElapsedTimer timer;
+    timer.start();
+    Gatt::Task<> task = workflow();
+    waitUntil([&task]() { return task.isDone(); }, 10000);
+    return timer.nsecsElapsed();
+}
+
+// Detail discovery of the Weight Scale, Device Information and Battery services through the
+// coroutine API and through a slot chain, over a simulated link. Only detail discovery can be
+// simulated: the services are local services of a peripheral-role controller, on which reads and
+// descriptor writes fail at once, while their stateChanged signal can be emitted as a link would.
+GattWorkflowResult benchmarkGattWorkflow()
+{
+    GattWorkflowResult result;
+    std::unique_ptr<QLowEnergyController> peripheral(QLowEnergyController::createPeripheral());
+    QList<QLowEnergyService *> services;
+    const QBluetoothUuid uuids[] = {
+        QBluetoothUuid(QBluetoothUuid::ServiceClassUuid::WeightScale),
+        QBluetoothUuid(QBluetoothUuid::ServiceClassUuid::DeviceInformation),
+        QBluetoothUuid(QBluetoothUuid::ServiceClassUuid::BatteryService),
+    };
+    for (const QBluetoothUuid &uuid : uuids) {
+        QLowEnergyServiceData data;
+        data.setType(QLowEnergyServiceData::ServiceTypePrimary);
+        data.setUuid(uuid);
+        if (QLowEnergyService *service = peripheral ? peripheral->addService(data, peripheral.get()) : nullptr)
+            services.append(service);
+    }
+    if (services.size() != 3)
+        return result;
+    result.available = true;
+
+    result.chainUs = discoverInChain(services, kLinkLatencyMs) / 1000;
+    result.coroutineUs = runWorkflow([&]() { return discoverConcurrently(services, kLinkLatencyMs); }) / 1000;
+
+    constexpr int operations = 1000;
+    const QList<QLowEnergyService *> repeated(operations, services.first());
+    result.chainNsPerOp = discoverInChain(repeated, 0) / operations;
+    result.coroutineNsPerOp = runWorkflow([&]() { return discoverSequentially(repeated, 0); }) / operations;
+    return result;
+}
+
+struct TimerWheelResult
+{
+    qint64 scheduleNs; // Per timer, into a wheel filling up to 100k
+    qint64 cancelNs;   // Per timer, out of a wheel holding up to 100k
+    qint64 tickNs;     // Per 10 ms tick while 100k timers spread over 100 s fall due
+};
+
+// The TimingWheel alone, with 100k timers at random delays of up to 100 s
+TimerWheelResult benchmarkTimerWheel()
+{
+    constexpr int timers = 100000;
+    QRandomGenerator random(58); // Fixed seed: the same delays every run
+    std::vector<qint64> delays(timers);
+    for (qint64 &delay : delays)
+        delay = 10 + random.bounded(100000);
+    std::vector<TimingWheel::TimerId> ids(timers);
+
+    TimingWheel wheel;
+    qint64 fired = 0;
+    qint64 scheduleNs = 0;
+    qint64 cancelNs = 0;
+    qint64 rounds = 0;
+    QElapsedTimer total;
+    total.start();
+    QElapsedTimer timer;
+    while (total.elapsed() < kBenchmarkMs) {
+        timer.start();
+        for (int i = 0; i < timers; ++i)
+            ids[i] = wheel.schedule(delays[i], [&fired]() { ++fired; });
+        scheduleNs += timer.nsecsElapsed();
+        timer.start();
+        for (int i = timers - 1; i >= 0; --i)
+            wheel.cancel(ids[i]);
+        cancelNs += timer.nsecsElapsed();
+        ++rounds;
+    }
+
+    for (int i = 0; i < timers; ++i)
+        wheel.schedule(delays[i], [&fired]() { ++fired; });
+    const qint64 start = wheel.nowMs();
+    qint64 ticks = 0;
+    timer.start();
+    while (wheel.activeCount() > 0) {
+        wheel.advanceTo(wheel.nowMs() + wheel.tickMs());
+        ++ticks;
+    }
+    const qint64 tickNs = timer.nsecsElapsed() / qMax<qint64>(1, ticks);
+    g_sink = fired + wheel.nowMs() - start;
+    return {scheduleNs / (rounds * timers), cancelNs / (rounds * timers), tickNs};
+}
+
+#ifdef BLESCALE_HAVE_SHM
+struct SeqlockResult
+{
+    qint64 nsPerRead;
+    qint64 unavailable; // Reads that returned -EAGAIN
+};
+
+// A reader cycling over the slots that many writer threads keep updating, as an external reader
+// of the shared table sees them: one writer per slot, and the table on the heap instead of in
+// shared memory, which is the same memory to the seqlock
+SeqlockResult benchmarkSeqlockRead(int writers)
+{
+    auto table = std::make_unique<blescale_shm_table>(); // Zeroed: every slot unused, seq even
+    const int slots = qMax(1, writers);
+    for (int i = 0; i < slots; ++i)
+        table->slots[i].in_use = 1;
+
+    std::atomic<bool> stop{false};
+    QList<QThread *> threads;
+    for (int i = 0; i < writers; ++i) {
+        blescale_shm_slot *slot = &table->slots[i];
+        threads.append(QThread::create([slot, &stop]() {
+            for (quint32 update = 0; !stop.load(std::memory_order_relaxed); ++update) {
+                blescale_shm_write_begin(slot);
+                slot->value.mantissa = qint32(update & 0xffffff);
+                slot->value.timestamp_us = qint64(update) * 200000;
+                blescale_shm_write_end(slot);
+            }
+        }));
+        threads.last()->start();
+    }
+
+    constexpr int readsPerStep = 4096;
+    qint64 unavailable = 0;
+    qint64 sum = 0;
+    const qint64 perSecond = throughput([&]() {
+        blescale_shm_value value;
+        for (int i = 0; i < readsPerStep; ++i) {
+            if (blescale_shm_read_slot_value(&table->slots[i % slots], &value) == 0)
+                sum += value.mantissa;
+            else
+                ++unavailable;
+        }
+        return readsPerStep;
+    });
+    g_sink = sum;
+
+    stop = true;
+    for (QThread *thread : std::as_const(threads)) {
+        thread->wait();
+        delete thread;
+    }
+    return {1000000000 / qMax<qint64>(1, perSecond), unavailable};
+}
+#endif
+}
+
+bool SelfTest::run()
+{
+    Checks checks;
+    checkCalibration(checks);
+    checkDecoding(checks);
+    checkSampleBus(checks);
+    checkMqttKeepAlive(checks);
+    checkAllocations(checks);
+    if (checks.passed())
+        qDebug() << "Self-test:" << checks.count() << "checks passed";
+    else
+        qWarning() << "Self-test:" << checks.failed() << "of" << checks.count() << "checks failed";
+    return checks.passed();
+}
+
+QByteArray SelfTest::benchmark()
+{
+    const QPair<qint64, qint64> layout = benchmarkLayout();
+    QByteArray out = "{";
+    out += "\"calibration_samples_per_s\":" + QByteArray::number(benchmarkCalibration());
+    out += ",\"layout_samples_per_s\":" + QByteArray::number(layout.first);
+    out += ",\"handwritten_samples_per_s\":" + QByteArray::number(layout.second);
+    out += ",\"layout_slowdown\":" + QByteArray::number(double(layout.second) / qMax<qint64>(1, layout.first), 'f', 2); // Target: 2 or less
+    out += ",\"bus_fanout_ns_per_sample\":{";
+    const int subscriberCounts[] = {1, 8, 32};
+    for (int subscribers : subscriberCounts) {
+        if (subscribers != subscriberCounts[0])
+            out += ',';
+        out += '"' + QByteArray::number(subscribers) + "\":" + QByteArray::number(benchmarkFanOut(subscribers));
+    }
+    out += '}';
+    const QPair<double, double> trace = benchmarkTracer();
+    out += ",\"trace_event_ns\":{\"off\":" + QByteArray::number(trace.first, 'f', 2);
+    out += ",\"on\":" + QByteArray::number(trace.second, 'f', 2) + '}';
+    out += ",\"stream_fanout_50_clients_1000_per_s\":" + benchmarkStreamFanOut().toJson();
+    out += ",\"sse_fanout_200_clients_1000_per_s\":" + benchmarkSseFanOut().toJson();
+    const GattWorkflowResult gatt = benchmarkGattWorkflow();
+    if (gatt.available) {
+        out += ",\"gatt_details_3_services\":{\"link_latency_ms\":" + QByteArray::number(kLinkLatencyMs);
+        out += ",\"callback_chain_us\":" + QByteArray::number(gatt.chainUs);
+        out += ",\"coroutine_us\":" + QByteArray::number(gatt.coroutineUs);
+        out += ",\"callback_ns_per_op\":" + QByteArray::number(gatt.chainNsPerOp);
+        out += ",\"coroutine_ns_per_op\":" + QByteArray::number(gatt.coroutineNsPerOp) + '}';
+    } else {
+        qWarning() << "Benchmark: no peripheral-role controller, GATT workflow skipped";
+        out += ",\"gatt_details_3_services\":null";
+    }
+    const TimerWheelResult wheel = benchmarkTimerWheel();
+    out += ",\"timer_wheel_100k_ns\":{\"schedule\":" + QByteArray::number(wheel.scheduleNs);
+    out += ",\"cancel\":" + QByteArray::number(wheel.cancelNs);
+    out += ",\"tick\":" + QByteArray::number(wheel.tickNs) + '}';
+#ifdef BLESCALE_HAVE_SHM
+    QByteArray unavailable;
+    out += ",\"seqlock_read_ns\":{";
+    const int writerCounts[] = {0, 1, 4};
+    for (int writers : writerCounts) {
+        const SeqlockResult result = benchmarkSeqlockRead(writers);
+        if (writers != writerCounts[0]) {
+            out += ',';
+            unavailable += ',';
+        }
+        out += '"' + QByteArray::number(writers) + "\":" + QByteArray::number(result.nsPerRead);
+        unavailable += '"' + QByteArray::number(writers) + "\":" + QByteArray::number(result.unavailable);
+    }
+    out += "},\"seqlock_read_eagain\":{" + unavailable + '}';
+#endif
+    out += '}';
+    return out;
+}
@@ -0,0 +1,25 @@
+#ifndef SELFTEST_H
+#define SELFTEST_H
+
+#include <QByteArray>
+
+// Test modes that need neither Bluetooth nor a window, run from main() before the station starts.
+//
+// --self-test checks the integer and decoding paths against known values (fixed-point rounding,
+// unit boundaries, range limits) and the MQTT keep-alive against an in-process broker on
+// loopback, and logs every mismatch with the expected and actual value. In
+// CONFIG+=alloccount builds it also fails if steady-state ingestion makes any heap allocation.
+// --benchmark runs each sample path on synthetic input for a fixed wall time and reports its
+// throughput, so a change can be compared before and after on the same machine. It also times
+// trace events with tracing off and on and timing wheel operations with 100k timers pending,
+// streams 1,000 samples/s to 50 local socket clients and to 200 SSE clients, compares GATT detail
+// discovery through coroutines with a slot chain over a simulated link and, on Unix, reads the
+// shared-memory seqlock while 0, 1 and 4 writer threads update it.
+class SelfTest
+{
+public:
+    static bool run();             // True if every check passed
+    static QByteArray benchmark(); // JSON object, one figure per path
+};
+
+#endif // SELFTEST_H
@@ -0,0 +1,220 @@
+#include "soakharness.h"
+#include "mainwindow.h"
+#include "memoryaccounting.h"
+#include "syntheticstream.h"
+#include <QBluetoothAddress>
+#include <QDebug>
+#include <QDir>
+#include <QLowEnergyServiceData>
+#include <QTimer>
+
+namespace {
+const int kDevicePopulation = 200;            // Distinct synthetic advertisers
+const int kAdvertsPerScan = 60;
+const qint64 kScanMs = 180000;                // Longer than the device expiry, so some age out mid-scan
+const qint64 kConnectMs = 2000;
+const int kNotificationsPerCycle = 150;       // 30 s at 5 Hz
+const int kObjectSlack = 16;                  // Growth tolerated after warm-up
+const int kHandleSlack = 8;
+const quint64 kFirstAddress = Q_UINT64_C(0xC2B5CA000000); // Locally administered, random static
+}
+
+SoakHarness::SoakHarness(MainWindow *window, int cycles, qint64 thresholdBytes, QObject *parent)
+    : QObject(parent)
+    , m_window(window)
+    , m_cycles(cycles)
+    , m_cycle(0)
+    , m_checkpointInterval(qMax(1, cycles / 20))
+    , m_thresholdBytes(thresholdBytes)
+    , m_random(0x50a4)
+    , m_stream(new SyntheticStream(window, 0x5eed, this))
+    , m_peripheral(nullptr)
+    , m_servicesCreated(0)
+    , m_servicesLeaked(0)
+{
+    for (int i = 0; i < kDevicePopulation; ++i) {
+        QBluetoothDeviceInfo device(QBluetoothAddress(kFirstAddress + quint64(i)), QString("Soak %1").arg(i), 0);
+        device.setCoreConfigurations(QBluetoothDeviceInfo::LowEnergyCoreConfiguration);
+        device.setRssi(qint16(-40 - i % 50));
+        m_devices.append(device);
+    }
+}
+
+void SoakHarness::start()
+{
+    qDebug() << "Soak:" << m_cycles << "cycles, growth threshold" << m_thresholdBytes << "bytes";
+    m_window->m_timers->setManualClock(true);
+    m_window->m_serviceFactory = [this](const QBluetoothUuid &uuid) { return createService(uuid); };
+    m_elapsed.start();
+    QTimer::singleShot(0, this, &SoakHarness::runCycle);
+}
+
+void SoakHarness::runCycle()
+{
+    checkReleased();
+    if (m_cycle % m_checkpointInterval == 0 || m_cycle == m_cycles) {
+        const Checkpoint point = checkpoint();
+        m_checkpoints.append(point);
+        qDebug() << "Soak: cycle" << point.cycle << "objects" << point.objects << "handles" << point.handles
+                 << "RSS" << point.resident << "accounted" << point.accounted;
+    }
+    if (m_cycle == m_cycles) {
+        finish();
+        return;
+    }
+
+    scan();
+    expectReleased(); // The reset released whatever the last cycle left open
+    open(m_devices.at(m_cycle % m_devices.size()));
+    m_stream->run(kNotificationsPerCycle);
+    teardown();
+
+    ++m_cycle;
+    QTimer::singleShot(0, this, &SoakHarness::runCycle); // Through the event loop: deferred deletes run first
+}
+
+void SoakHarness::scan()
+{
+    MainWindow &window = *m_window;
+    window.resetScanState();
+    for (int i = 0; i < kAdvertsPerScan; ++i) {
+        window.deviceDiscovered(m_devices.at(int(m_random.bounded(quint32(m_devices.size())))));
+        window.m_timers->advanceBy(kScanMs / kAdvertsPerScan);
+    }
+    window.scanFinished();
+}
+
+// What the controller reports for a connected scale, then a selection from the combo box. No
+// controller is created: the services come from createService() below.
+void SoakHarness::open(const QBluetoothDeviceInfo &device)
+{
+    MainWindow &window = *m_window;
+    const QBluetoothUuid weightScale(QBluetoothUuid::ServiceClassUuid::WeightScale);
+    window.m_currentDevice = device;
+    window.m_timers->advanceBy(kConnectMs);
+    window.serviceDiscovered(QBluetoothUuid(QBluetoothUuid::ServiceClassUuid::DeviceInformation));
+    window.serviceDiscovered(QBluetoothUuid(QBluetoothUuid::ServiceClassUuid::BatteryService));
+    window.serviceDiscovered(weightScale);
+    window.serviceDiscoveryFinished();
+    window.deviceComboBox->setCurrentIndex(window.deviceComboBox->findText(weightScale.toString())); // onServiceSelected()
+}
+
+// A local service on a peripheral-role controller is a real QLowEnergyService without a link.
+// Its details never get discovered, so the GATT timeout runs every cycle as well. Parented to the
+// window rather than a controller, so a service that is not released stays in the object count.
+QLowEnergyService *SoakHarness::createService(const QBluetoothUuid &uuid)
+{
+    if (!m_peripheral)
+        m_peripheral = QLowEnergyController::createPeripheral(this);
+    QLowEnergyServiceData data;
+    data.setType(QLowEnergyServiceData::ServiceTypePrimary);
+    data.setUuid(uuid);
+    QLowEnergyService *service = m_peripheral->addService(data, m_window);
+    if (service) {
+        ++m_servicesCreated;
+        m_open.append(service);
+    }
+    return service;
+}
+
+void SoakHarness::expectReleased()
+{
+    m_releasing += m_open;
+    m_open.clear();
+    // Each peripheral's attribute table only grows; start a new one with the next service
+    if (m_peripheral) {
+        m_peripheral->deleteLater();
+        m_peripheral = nullptr;
+    }
+}
+
+// After a pass of the event loop, everything released with deleteLater() must be gone
+void SoakHarness::checkReleased()
+{
+    for (const QPointer<QLowEnergyService> &service : std::as_const(m_releasing)) {
+        if (service) {
+            ++m_servicesLeaked;
+            qWarning() << "Soak: service" << service->serviceUuid().toString() << "not deleted after release";
+        }
+    }
+    m_releasing.clear();
+}
+
+void SoakHarness::teardown()
+{
+    switch (m_cycle % 3) {
+    case 0:
+        m_window->deviceDisconnected();
+        expectReleased();
+        break;
+    case 1:
+        m_window->controllerError(QLowEnergyController::ConnectionError);
+        expectReleased();
+        break;
+    default:
+        break; // Still connected when the next scan starts, as after a rescan from the UI
+    }
+}
+
+SoakHarness::Checkpoint SoakHarness::checkpoint() const
+{
+    return {m_cycle, m_window->m_timers->nowMs(), int(m_window->findChildren<QObject *>().size()), openHandles(),
+            MemoryAccounting::residentBytes(), m_window->m_memory.total()};
+}
+
+int SoakHarness::openHandles()
+{
+#if defined(Q_OS_LINUX) || defined(Q_OS_ANDROID)
+    // Includes the one the listing itself holds open, which is the same at every checkpoint
+    return int(QDir(QStringLiteral("/proc/self/fd")).entryList(QDir::AllEntries | QDir::System | QDir::NoDotAndDotDot).size());
+#else
+    return -1;
+#endif
+}
+
+// Judged on the last checkpoint against the first one after warm-up, like MemoryCheck; the
+// checkpoint table shows whether growth is steady (a leak) or a step (a cache filling up)
+void SoakHarness::finish()
+{
+    const int warmupCycle = qMax(1, m_cycles / 10);
+    Checkpoint baseline = m_checkpoints.first();
+    for (const Checkpoint &point : std::as_const(m_checkpoints)) {
+        if (point.cycle >= warmupCycle) {
+            baseline = point;
+            break;
+        }
+    }
+    const Checkpoint &last = m_checkpoints.last();
+    const int objectGrowth = last.objects - baseline.objects;
+    const int handleGrowth = last.handles >= 0 && baseline.handles >= 0 ? last.handles - baseline.handles : 0;
+    const qint64 residentGrowth = last.resident >= 0 && baseline.resident >= 0 ? last.resident - baseline.resident : 0;
+    const qint64 accountedGrowth = last.accounted - baseline.accounted;
+    const bool passed = objectGrowth <= kObjectSlack && handleGrowth <= kHandleSlack
+                        && residentGrowth <= m_thresholdBytes && accountedGrowth <= m_thresholdBytes
+                        && m_servicesCreated > 0 && m_servicesLeaked == 0;
+
+    QString report = QString("Soak %1: %2 cycles, %3 h simulated in %4 s; after cycle %5: objects %6%7, handles %8%9, "
+                             "RSS %10%11 bytes, accounted %12%13 bytes (threshold %14); services %15 created, %16 not deleted")
+                         .arg(passed ? "passed" : "FAILED")
+                         .arg(m_cycles)
+                         .arg(double(last.virtualMs) / 3600000.0, 0, 'f', 1)
+                         .arg(double(m_elapsed.elapsed()) / 1000.0, 0, 'f', 1)
+                         .arg(baseline.cycle)
+                         .arg(objectGrowth >= 0 ? "+" : "").arg(objectGrowth)
+                         .arg(handleGrowth >= 0 ? "+" : "").arg(handleGrowth)
+                         .arg(residentGrowth >= 0 ? "+" : "").arg(residentGrowth)
+                         .arg(accountedGrowth >= 0 ? "+" : "").arg(accountedGrowth)
+                         .arg(m_thresholdBytes)
+                         .arg(m_servicesCreated)
+                         .arg(m_servicesLeaked);
+    for (const Checkpoint &point : std::as_const(m_checkpoints)) {
+        report += QString("\n  cycle %1: objects %2, handles %3, RSS %4, accounted %5")
+                      .arg(point.cycle).arg(point.objects).arg(point.handles).arg(point.resident).arg(point.accounted);
+    }
+
+    if (passed)
+        qDebug().noquote() << report;
+    else
+        qCritical().noquote() << report;
+    emit finished(passed, report);
+}
@@ -0,0 +1,311 @@
+#include "stationconfig.h"
+#include "gattuuid.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QFileInfo>
+#include <QSettings>
+
+namespace {
+bool parseUuids(const QStringList &values, QList<QBluetoothUuid> &out, const char *what, QString &error)
+{
+    out.clear();
+    for (const QString &value : values) {
+        if (value.trimmed().isEmpty())
+            continue;
+        QBluetoothUuid uuid;
+        if (!GattUuid::parse(value, uuid)) {
+            error = QString("Invalid %1 UUID: %2").arg(QLatin1String(what), value);
+            return false;
+        }
+        out.append(uuid);
+    }
+    return true;
+}
+
+bool parseAddresses(const QStringList &values, QList<QBluetoothAddress> &out, QString &error)
+{
+    out.clear();
+    for (const QString &value : values) {
+        if (value.trimmed().isEmpty())
+            continue;
+        const QBluetoothAddress address(value.trimmed());
+        if (address.isNull()) {
+            error = QString("Invalid target address: %1").arg(value);
+            return false;
+        }
+        out.append(address);
+    }
+    return true;
+}
+
+bool parsePort(const QString &value, quint16 &port, const char *what, QString &error)
+{
+    bool ok = false;
+    const uint parsed = value.toUInt(&ok);
+    if (!ok || parsed == 0 || parsed > 65535) {
+        error = QString("Invalid %1 port: %2").arg(QLatin1String(what), value);
+        return false;
+    }
+    port = quint16(parsed);
+    return true;
+}
+
+bool parseQos(const QString &value, int &qos, QString &error)
+{
+    bool ok = false;
+    const int parsed = value.toInt(&ok);
+    if (!ok || parsed < 0 || parsed > 1) {
+        error = QString("Invalid MQTT QoS (0 or 1): %1").arg(value);
+        return false;
+    }
+    qos = parsed;
+    return true;
+}
+}
+
+bool StationConfig::matches(const QBluetoothDeviceInfo &device) const
+{
+    if (targets.contains(device.address()))
+        return true;
+    for (const QString &filter : nameFilters) {
+        if (device.name().contains(filter, Qt::CaseInsensitive))
+            return true;
+    }
+    return false;
+}
+
+bool StationConfig::loadFile(const QString &path, QString &error)
+{
+    if (!QFileInfo::exists(path)) {
+        error = QString("Config file not found: %1").arg(path);
+        return false;
+    }
+    QSettings settings(path, QSettings::IniFormat);
+    if (settings.status() != QSettings::NoError) {
+        error = QString("Cannot parse config file: %1").arg(path);
+        return false;
+    }
+
+    settings.beginGroup(QStringLiteral("station"));
+    autostart = settings.value(QStringLiteral("autostart"), autostart).toBool();
+    if (settings.contains(QStringLiteral("targets"))
+        && !parseAddresses(settings.value(QStringLiteral("targets")).toStringList(), targets, error))
+        return false;
+    nameFilters = settings.value(QStringLiteral("nameFilters"), nameFilters).toStringList();
+    if (settings.contains(QStringLiteral("services"))
+        && !parseUuids(settings.value(QStringLiteral("services")).toStringList(), services, "service", error))
+        return false;
+    if (settings.contains(QStringLiteral("characteristics"))
+        && !parseUuids(settings.value(QStringLiteral("characteristics")).toStringList(), characteristics, "characteristic", error))
+        return false;
+    readCharacteristics = settings.value(QStringLiteral("readCharacteristics"), readCharacteristics).toBool();
+    fastConnect = settings.value(QStringLiteral("fastConnect"), fastConnect).toBool();
+    if (settings.contains(QStringLiteral("unit"))
+        && !Calibration::parseUnit(settings.value(QStringLiteral("unit")).toString(), unit)) {
+        error = QString("Invalid unit: %1").arg(settings.value(QStringLiteral("unit")).toString());
+        return false;
+    }
+    layoutDir = settings.value(QStringLiteral("layouts"), layoutDir).toString();
+    scriptDir = settings.value(QStringLiteral("scripts"), scriptDir).toString();
+    pluginDir = settings.value(QStringLiteral("plugins"), pluginDir).toString();
+    settings.endGroup();
+
+    const int deviceCount = settings.beginReadArray(QStringLiteral("devices"));
+    for (int i = 0; i < deviceCount; ++i) {
+        settings.setArrayIndex(i);
+        DeviceProfile profile;
+        profile.address = QBluetoothAddress(settings.value(QStringLiteral("address")).toString().trimmed());
+        if (profile.address.isNull()) {
+            error = QString("Invalid address in [devices] entry %1").arg(i + 1);
+            return false;
+        }
+        profile.alias = settings.value(QStringLiteral("alias")).toString();
+        profile.decoder = settings.value(QStringLiteral("decoder")).toString();
+        if (settings.contains(QStringLiteral("subscriptions"))
+            && !parseUuids(settings.value(QStringLiteral("subscriptions")).toStringList(), profile.subscriptions,
+                           "subscription", error))
+            return false;
+        devices.append(profile);
+    }
+    settings.endArray();
+
+    settings.beginGroup(QStringLiteral("stream"));
+    streamEnabled = settings.value(QStringLiteral("enabled"), streamEnabled).toBool();
+    if (settings.contains(QStringLiteral("tcpPort"))
+        && !parsePort(settings.value(QStringLiteral("tcpPort")).toString(), streamTcpPort, "stream", error))
+        return false;
+    streamLocalName = settings.value(QStringLiteral("localName"), streamLocalName).toString();
+    settings.endGroup();
+
+    settings.beginGroup(QStringLiteral("http"));
+    httpEnabled = settings.value(QStringLiteral("enabled"), httpEnabled).toBool();
+    if (settings.contains(QStringLiteral("port"))
+        && !parsePort(settings.value(QStringLiteral("port")).toString(), httpPort, "HTTP", error))
+        return false;
+    settings.endGroup();
+
+    settings.beginGroup(QStringLiteral("shm"));
+    shmEnabled = settings.value(QStringLiteral("enabled"), shmEnabled).toBool();
+    shmName = settings.value(QStringLiteral("name"), shmName).toString();
+    settings.endGroup();
+
+    settings.beginGroup(QStringLiteral("mqtt"));
+    mqttEnabled = settings.value(QStringLiteral("enabled"), mqttEnabled).toBool();
+    mqtt.host = settings.value(QStringLiteral("host"), mqtt.host).toString();
+    if (settings.contains(QStringLiteral("port"))
+        && !parsePort(settings.value(QStringLiteral("port")).toString(), mqtt.port, "MQTT", error))
+        return false;
+    mqtt.clientId = settings.value(QStringLiteral("clientId"), mqtt.clientId).toString();
+    mqtt.topicPrefix = settings.value(QStringLiteral("topicPrefix"), mqtt.topicPrefix).toString();
+    if (settings.contains(QStringLiteral("qos"))
+        && !parseQos(settings.value(QStringLiteral("qos")).toString(), mqtt.qos, error))
+        return false;
+    settings.endGroup();
+    return true;
+}
+
+bool StationConfig::fromCommandLine(const QCoreApplication &app, StationConfig &config, QString &error)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("BLE scale gateway"));
+    parser.addHelpOption();
+
+    const QCommandLineOption configOption("config", "Read station settings from the INI <file>.", "file");
+    const QCommandLineOption autostartOption("autostart", "Scan, connect and subscribe without UI interaction.");
+    const QCommandLineOption targetOption("target", "Connect to the scale with this <address> (repeatable).", "address");
+    const QCommandLineOption nameOption("name-filter", "Connect to a scale whose name contains <text> (repeatable).", "text");
+    const QCommandLineOption serviceOption("service", "Service to open, in order of preference (repeatable).", "uuid");
+    const QCommandLineOption characteristicOption("characteristic", "Only subscribe to this characteristic (repeatable).", "uuid");
+    const QCommandLineOption noReadOption("no-read", "Do not read characteristic values after subscribing.");
+    const QCommandLineOption fastOption("fast-connect", "Overlap scan and connect; open only the chosen service.");
+    const QCommandLineOption unitOption("unit", "Convert weights to <unit>: native, kg (0.1 g resolution) or lb.", "unit");
+    const QCommandLineOption layoutsOption("layouts", "Load vendor characteristic layouts from <dir>.", "dir");
+    const QCommandLineOption scriptsOption("scripts", "Load JavaScript characteristic decoders from <dir>.", "dir");
+    const QCommandLineOption pluginsOption("plugins", "Load decoder plugins from <dir>.", "dir");
+    const QCommandLineOption noStreamOption("no-stream", "Disable the binary TCP/local socket stream.");
+    const QCommandLineOption streamPortOption("stream-port", "Binary stream TCP <port>.", "port");
+    const QCommandLineOption noHttpOption("no-http", "Disable the HTTP API.");
+    const QCommandLineOption httpPortOption("http-port", "HTTP API <port>.", "port");
+    const QCommandLineOption noShmOption("no-shm", "Disable the shared-memory latest value table.");
+    const QCommandLineOption noMqttOption("no-mqtt", "Disable the MQTT publisher.");
+    const QCommandLineOption mqttHostOption("mqtt-host", "MQTT broker <host>.", "host");
+    const QCommandLineOption mqttPortOption("mqtt-port", "MQTT broker <port>.", "port");
+    const QCommandLineOption mqttPrefixOption("mqtt-topic-prefix", "MQTT topic <prefix>.", "prefix");
+    const QCommandLineOption mqttQosOption("mqtt-qos", "MQTT QoS <level> (0 or 1).", "level");
+    const QCommandLineOption benchmarkOption("startup-benchmark", "Print startup phases as JSON and exit once scanning is possible.");
+    const QCommandLineOption memoryCheckOption("memory-check", "Stream from a synthetic scale on a virtual clock, then exit 3 if memory grew more than <MiB> after warm-up.", "MiB");
+    const QCommandLineOption memoryCheckMinutesOption("memory-check-minutes", "Simulated length of the --memory-check run (default 60).", "minutes");
+    const QCommandLineOption soakOption("soak", "Run <cycles> scan/connect/stream/disconnect cycles on a virtual clock, then exit 3 on unbounded growth.", "cycles");
+    const QCommandLineOption soakThresholdOption("soak-threshold", "Memory growth allowed by --soak after warm-up (default 16).", "MiB");
+    const QCommandLineOption selfTestOption("self-test", "Run the built-in checks without Bluetooth, then exit 3 if any failed.");
+    const QCommandLineOption throughputOption("benchmark", "Print the throughput of the sample paths as JSON and exit.");
+    parser.addOptions({configOption, autostartOption, targetOption, nameOption, serviceOption, characteristicOption,
+                       noReadOption, fastOption, unitOption, layoutsOption, scriptsOption, pluginsOption, noStreamOption, streamPortOption, noHttpOption, httpPortOption,
+                       noShmOption, noMqttOption, mqttHostOption, mqttPortOption, mqttPrefixOption, mqttQosOption,
+                       benchmarkOption, memoryCheckOption, memoryCheckMinutesOption, soakOption, soakThresholdOption,
+                       selfTestOption, throughputOption});
+    parser.process(app); // Exits on --help and unknown options
+
+    if (parser.isSet(configOption) && !config.loadFile(parser.value(configOption), error))
+        return false;
+
+    // Command-line options override the file
+    if (parser.isSet(autostartOption))
+        config.autostart = true;
+    if (parser.isSet(targetOption) && !parseAddresses(parser.values(targetOption), config.targets, error))
+        return false;
+    if (parser.isSet(nameOption))
+        config.nameFilters = parser.values(nameOption);
+    if (parser.isSet(serviceOption) && !parseUuids(parser.values(serviceOption), config.services, "service", error))
+        return false;
+    if (parser.isSet(characteristicOption)
+        && !parseUuids(parser.values(characteristicOption), config.characteristics, "characteristic", error))
+        return false;
+    if (parser.isSet(noReadOption))
+        config.readCharacteristics = false;
+    if (parser.isSet(fastOption))
+        config.fastConnect = true;
+    if (parser.isSet(unitOption) && !Calibration::parseUnit(parser.value(unitOption), config.unit)) {
+        error = QString("Invalid unit: %1").arg(parser.value(unitOption));
+        return false;
+    }
+    if (parser.isSet(layoutsOption))
+        config.layoutDir = parser.value(layoutsOption);
+    if (parser.isSet(scriptsOption))
+        config.scriptDir = parser.value(scriptsOption);
+    if (parser.isSet(pluginsOption))
+        config.pluginDir = parser.value(pluginsOption);
+    if (parser.isSet(noStreamOption))
+        config.streamEnabled = false;
+    if (parser.isSet(streamPortOption) && !parsePort(parser.value(streamPortOption), config.streamTcpPort, "stream", error))
+        return false;
+    if (parser.isSet(noHttpOption))
+        config.httpEnabled = false;
+    if (parser.isSet(httpPortOption) && !parsePort(parser.value(httpPortOption), config.httpPort, "HTTP", error))
+        return false;
+    if (parser.isSet(noShmOption))
+        config.shmEnabled = false;
+    if (parser.isSet(noMqttOption))
+        config.mqttEnabled = false;
+    if (parser.isSet(mqttHostOption))
+        config.mqtt.host = parser.value(mqttHostOption);
+    if (parser.isSet(mqttPortOption) && !parsePort(parser.value(mqttPortOption), config.mqtt.port, "MQTT", error))
+        return false;
+    if (parser.isSet(mqttPrefixOption))
+        config.mqtt.topicPrefix = parser.value(mqttPrefixOption);
+    if (parser.isSet(mqttQosOption) && !parseQos(parser.value(mqttQosOption), config.mqtt.qos, error))
+        return false;
+    config.startupBenchmark = parser.isSet(benchmarkOption);
+    if (parser.isSet(memoryCheckOption)) {
+        bool ok = false;
+        config.memoryCheckMb = parser.value(memoryCheckOption).toDouble(&ok);
+        if (!ok || config.memoryCheckMb <= 0) {
+            error = QString("Invalid memory check threshold: %1").arg(parser.value(memoryCheckOption));
+            return false;
+        }
+    }
+    if (parser.isSet(memoryCheckMinutesOption)) {
+        bool ok = false;
+        config.memoryCheckMinutes = parser.value(memoryCheckMinutesOption).toInt(&ok);
+        if (!ok || config.memoryCheckMinutes <= 0) {
+            error = QString("Invalid memory check length: %1").arg(parser.value(memoryCheckMinutesOption));
+            return false;
+        }
+    }
+    if (parser.isSet(soakOption)) {
+        bool ok = false;
+        config.soakCycles = parser.value(soakOption).toInt(&ok);
+        if (!ok || config.soakCycles <= 0) {
+            error = QString("Invalid soak cycle count: %1").arg(parser.value(soakOption));
+            return false;
+        }
+    }
+    if (parser.isSet(soakThresholdOption)) {
+        bool ok = false;
+        config.soakThresholdMb = parser.value(soakThresholdOption).toDouble(&ok);
+        if (!ok || config.soakThresholdMb <= 0) {
+            error = QString("Invalid soak threshold: %1").arg(parser.value(soakThresholdOption));
+            return false;
+        }
+    }
+    config.selfTest = parser.isSet(selfTestOption);
+    config.throughputBenchmark = parser.isSet(throughputOption);
+
+    if (config.autostart && !config.hasTargetFilter() && !config.fastConnect) {
+        error = QStringLiteral("--autostart needs --target or --name-filter (or --fast-connect to take the first weight scale)");
+        return false;
+    }
+    if (config.autostart && config.memoryCheckMb > 0) {
+        error = QStringLiteral("--memory-check runs without Bluetooth and cannot be combined with --autostart");
+        return false;
+    }
+    if (config.autostart && config.soakCycles > 0) {
+        error = QStringLiteral("--soak runs without Bluetooth and cannot be combined with --autostart");
+        return false;
+    }
+    if (config.memoryCheckMb > 0 && config.soakCycles > 0) {
+        error = QStringLiteral("--memory-check and --soak both drive the virtual clock; run them separately");
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,87 @@
+#ifndef STATIONCONFIG_H
+#define STATIONCONFIG_H
+
+#include "calibration.h"
+#include "mqttpublisher.h"
+
+#include <QBluetoothAddress>
+#include <QBluetoothDeviceInfo>
+#include <QBluetoothUuid>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+class QCoreApplication;
+
+// Station settings for unattended operation, from an INI file (--config) overridden by
+// command-line options. With autostart the app scans, connects to the first matching scale, opens
+// the preferred service and subscribes without any UI interaction. A known target address is
+// connected directly, skipping the scan; the scan is only the fallback when that fails.
+//
+// INI layout (all keys optional):
+//   [station]  autostart, targets (addresses), nameFilters, services (preference order),
+//              characteristics (subscription profile; empty = every notifiable one),
+//              readCharacteristics, fastConnect, unit (native, kg or lb),
+//              layouts (directory of vendor layout *.json; default AppDataLocation/layouts),
+//              scripts (directory of <uuid>.js decoders; default AppDataLocation/scripts),
+//              plugins (directory of decoder plugins; default <application dir>/decoders)
+//   [stream]   enabled, tcpPort, localName
+//   [http]     enabled, port
+//   [shm]      enabled, name
+//   [mqtt]     enabled, host, port, clientId, topicPrefix, qos
+//   [devices]  QSettings array (size, 1\address, 1\alias, 1\decoder, 1\subscriptions, ...):
+//              per-scale display name, decoder (plugin or layout name) and subscription profile,
+//              stored in the device registry at startup
+struct StationConfig
+{
+    bool autostart = false;
+    QList<QBluetoothAddress> targets;
+    QStringList nameFilters; // Case-insensitive substrings of the advertised name
+    QList<QBluetoothUuid> services{QBluetoothUuid(QBluetoothUuid::ServiceClassUuid::WeightScale)};
+    QList<QBluetoothUuid> characteristics;
+    bool readCharacteristics = true;
+    bool fastConnect = false;
+    Calibration::Unit unit = Calibration::NativeUnit; // Weight unit every sink receives
+    QString layoutDir; // Empty: AppDataLocation/layouts
+    QString scriptDir; // Empty: AppDataLocation/scripts; only used in builds with QtQml
+    QString pluginDir; // Empty: <application dir>/decoders
+
+    struct DeviceProfile {
+        QBluetoothAddress address;
+        QString alias;
+        QString decoder;                     // Empty: automatic
+        QList<QBluetoothUuid> subscriptions; // Empty: the station's characteristics
+    };
+    QList<DeviceProfile> devices;
+
+    bool streamEnabled = true;
+    quint16 streamTcpPort = 47051;
+    QString streamLocalName = QStringLiteral("blescale-stream");
+    bool httpEnabled = true;
+    quint16 httpPort = 47080;
+    bool shmEnabled = true;
+    QString shmName; // Empty: the reader library's default
+    bool mqttEnabled = true;
+    MqttPublisher::Settings mqtt;
+
+    bool startupBenchmark = false;
+    double memoryCheckMb = 0; // Test mode: fail (exit 3) if memory grows more than this over the run; 0 = off
+    int memoryCheckMinutes = 60;
+    int soakCycles = 0; // Test mode: lifecycle cycles on a virtual clock, fail (exit 3) on growth; 0 = off
+    double soakThresholdMb = 16;
+    bool selfTest = false;           // Test mode: built-in checks (selftest.h), exit 3 on failure
+    bool throughputBenchmark = false; // Print sample path throughput as JSON and exit
+
+    bool hasTargetFilter() const { return !targets.isEmpty() || !nameFilters.isEmpty(); }
+    bool matches(const QBluetoothDeviceInfo &device) const;
+    bool subscribes(const QBluetoothUuid &characteristic) const
+    {
+        return characteristics.isEmpty() || characteristics.contains(characteristic);
+    }
+
+    // Handles --help itself; returns false with `error` set for unusable values
+    static bool fromCommandLine(const QCoreApplication &app, StationConfig &config, QString &error);
+    bool loadFile(const QString &path, QString &error);
+};
+
+#endif // STATIONCONFIG_H
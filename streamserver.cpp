@@ -0,0 +1,240 @@
+#include "streamserver.h"
+#include "memoryaccounting.h"
+#include <QDebug>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QtEndian>
+#include <cstring>
+
+namespace {
+constexpr int FrameHeaderSize = 8;   // u32 length + u8 version + u8 type + u16 count
+constexpr quint8 FrameTypeSamples = 1;
+constexpr int MaxSamplesPerFrame = 0xFFFF; // u16 count
+constexpr int FramesPerQueue = 4;          // A frame is at most this fraction of a client's queue bound
+}
+
+StreamServer::StreamServer(QObject *parent)
+    : QObject(parent)
+    , m_tcpServer(nullptr)
+    , m_localServer(nullptr)
+    , m_pendingCount(0)
+    , m_maxQueuedBytes(256 * 1024)
+    , m_evictedClients(0)
+{
+    m_flushTimer.setInterval(20);
+    m_flushTimer.setSingleShot(true);
+    connect(&m_flushTimer, &QTimer::timeout, this, &StreamServer::flush);
+}
+
+StreamServer::~StreamServer()
+{
+    close();
+}
+
+bool StreamServer::listen(quint16 tcpPort, const QString &localName)
+{
+    bool ok = true;
+
+    if (tcpPort != 0) {
+        m_tcpServer = new QTcpServer(this);
+        connect(m_tcpServer, &QTcpServer::newConnection, this, &StreamServer::onNewTcpConnection);
+        if (!m_tcpServer->listen(QHostAddress::LocalHost, tcpPort)) {
+            qWarning() << "Stream server: TCP listen failed:" << m_tcpServer->errorString();
+            ok = false;
+        } else {
+            qDebug() << "Stream server listening on 127.0.0.1:" << tcpPort;
+        }
+    }
+
+    if (!localName.isEmpty()) {
+        m_localServer = new QLocalServer(this);
+        connect(m_localServer, &QLocalServer::newConnection, this, &StreamServer::onNewLocalConnection);
+        // A socket file nobody answers on is left over from a crash; one that answers belongs to
+        // a running station, which keeps it
+        QLocalSocket probe;
+        probe.connectToServer(localName);
+        if (probe.waitForConnected(100)) {
+            probe.abort();
+            qWarning() << "Stream server: local socket" << localName << "is in use by another process";
+            ok = false;
+        } else {
+            QLocalServer::removeServer(localName);
+            if (!m_localServer->listen(localName)) {
+                qWarning() << "Stream server: local listen failed:" << m_localServer->errorString();
+                ok = false;
+            } else {
+                qDebug() << "Stream server listening on local socket" << m_localServer->fullServerName();
+            }
+        }
+    }
+
+    return ok;
+}
+
+void StreamServer::close()
+{
+    m_flushTimer.stop();
+    const QList<Client> clients = m_clients;
+    for (const Client &client : clients) {
+        client.socket->disconnect(this);
+        client.socket->close();
+        client.socket->deleteLater();
+    }
+    m_clients.clear();
+    if (m_tcpServer) {
+        m_tcpServer->close();
+        m_tcpServer->deleteLater();
+        m_tcpServer = nullptr;
+    }
+    if (m_localServer) {
+        m_localServer->close();
+        m_localServer->deleteLater();
+        m_localServer = nullptr;
+    }
+}
+
+void StreamServer::setFlushInterval(int msec)
+{
+    m_flushTimer.setInterval(qMax(0, msec));
+}
+
+void StreamServer::encodeSample(const Sample &sample, char *out)
+{
+    uchar *p = reinterpret_cast<uchar *>(out);
+    qToLittleEndian<quint64>(sample.device, p);
+    // UUID in RFC 4122 (big endian) byte order
+    const QUuid &uuid = sample.characteristic;
+    qToBigEndian<quint32>(uuid.data1, p + 8);
+    qToBigEndian<quint16>(uuid.data2, p + 12);
+    qToBigEndian<quint16>(uuid.data3, p + 14);
+    std::memcpy(p + 16, uuid.data4, 8);
+    qToLittleEndian<qint64>(sample.timestampUs, p + 24);
+    qToLittleEndian<qint32>(sample.mantissa, p + 32);
+    p[36] = quint8(sample.exponent);
+    p[37] = sample.flags;
+    qToLittleEndian<quint16>(sample.unit, p + 38);
+    qToLittleEndian<quint32>(sample.sequence, p + 40);
+}
+
+void StreamServer::publish(const Sample &sample)
+{
+    if (m_clients.isEmpty())
+        return; // Nobody listening, don't bother encoding
+
+    if (m_pending.isEmpty()) {
+        m_pending.reserve(FrameHeaderSize + 64 * RecordSize);
+        m_pending.resize(FrameHeaderSize); // Header is filled in at flush time
+    }
+
+    const qsizetype offset = m_pending.size();
+    m_pending.resize(offset + RecordSize);
+    encodeSample(sample, m_pending.data() + offset);
+    ++m_pendingCount;
+
+    if (m_pendingCount >= maxSamplesPerFrame())
+        flush(); // Larger batches go out as several frames
+    else if (!m_flushTimer.isActive())
+        m_flushTimer.start();
+}
+
+int StreamServer::maxSamplesPerFrame() const
+{
+    const qint64 bytes = m_maxQueuedBytes / FramesPerQueue - FrameHeaderSize;
+    return int(qBound<qint64>(1, bytes / RecordSize, MaxSamplesPerFrame));
+}
+
+void StreamServer::flush()
+{
+    m_flushTimer.stop();
+    if (m_pendingCount == 0)
+        return;
+
+    uchar *header = reinterpret_cast<uchar *>(m_pending.data());
+    qToLittleEndian<quint32>(quint32(m_pending.size() - 4), header);
+    header[4] = ProtocolVersion;
+    header[5] = FrameTypeSamples;
+    qToLittleEndian<quint16>(quint16(m_pendingCount), header + 6);
+
+    const QByteArray frame = m_pending;
+    m_pending = QByteArray(); // Detach so the shared frame is never written to again
+    m_pendingCount = 0;
+
+    // Iterate over a copy: evicting modifies m_clients
+    const QList<Client> clients = m_clients;
+    for (const Client &client : clients) {
+        if (client.socket->bytesToWrite() + frame.size() > m_maxQueuedBytes) {
+            evict(client);
+            continue;
+        }
+        client.socket->write(frame);
+    }
+}
+
+void StreamServer::onNewTcpConnection()
+{
+    while (QTcpSocket *socket = m_tcpServer->nextPendingConnection()) {
+        socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+        addClient(socket, QString("%1:%2").arg(socket->peerAddress().toString()).arg(socket->peerPort()));
+        connect(socket, &QTcpSocket::disconnected, this, [this, socket]() { removeClient(socket); });
+    }
+}
+
+void StreamServer::onNewLocalConnection()
+{
+    while (QLocalSocket *socket = m_localServer->nextPendingConnection()) {
+        addClient(socket, QString("local#%1").arg(socket->socketDescriptor()));
+        connect(socket, &QLocalSocket::disconnected, this, [this, socket]() { removeClient(socket); });
+    }
+}
+
+void StreamServer::addClient(QIODevice *socket, const QString &peer)
+{
+    // Subscribers have nothing to say; drain anything they send so buffers don't grow
+    connect(socket, &QIODevice::readyRead, socket, [socket]() { socket->readAll(); });
+    m_clients.append({socket, peer});
+    qDebug() << "Stream client connected:" << peer << "clients:" << m_clients.size();
+}
+
+void StreamServer::removeClient(QIODevice *socket)
+{
+    for (int i = 0; i < m_clients.size(); ++i) {
+        if (m_clients.at(i).socket == socket) {
+            qDebug() << "Stream client disconnected:" << m_clients.at(i).peer;
+            m_clients.removeAt(i);
+            break;
+        }
+    }
+    socket->deleteLater();
+}
+
+void StreamServer::evict(const Client &client)
+{
+    qWarning() << "Evicting slow stream client" << client.peer
+               << "queued bytes:" << client.socket->bytesToWrite();
+    ++m_evictedClients;
+    emit clientEvicted(client.peer);
+
+    QIODevice *socket = client.socket;
+    socket->disconnect(this);
+    for (int i = 0; i < m_clients.size(); ++i) {
+        if (m_clients.at(i).socket == socket) {
+            m_clients.removeAt(i);
+            break;
+        }
+    }
+    if (QTcpSocket *tcp = qobject_cast<QTcpSocket *>(socket))
+        tcp->abort();
+    else if (QLocalSocket *local = qobject_cast<QLocalSocket *>(socket))
+        local->abort();
+    socket->deleteLater();
+}
+
+qint64 StreamServer::memoryUsage() const
+{
+    qint64 bytes = MemoryAccounting::bytes(m_pending) + MemoryAccounting::containerBytes(m_clients);
+    for (const Client &client : m_clients)
+        bytes += MemoryAccounting::bytes(client.peer) + client.socket->bytesToWrite();
+    return bytes;
+}
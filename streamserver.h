@@ -0,0 +1,84 @@
+#ifndef STREAMSERVER_H
+#define STREAMSERVER_H
+
+#include "sample.h"
+
+#include <QObject>
+#include <QByteArray>
+#include <QList>
+#include <QTimer>
+
+class QIODevice;
+class QTcpServer;
+class QLocalServer;
+
+// Streams decoded samples to local subscribers over TCP (127.0.0.1) and/or a QLocalSocket.
+//
+// Wire format, all integers little endian:
+//   frame  := u32 length | u8 version (1) | u8 type (1 = samples) | u16 count | count * record
+//   record := u64 device | u8[16] characteristic uuid | i64 timestampUs | i32 mantissa
+//             | i8 exponent | u8 flags | u16 unit | u32 sequence              (44 bytes)
+// `length` counts the bytes following the length field itself.
+//
+// Samples published between flushes are batched into one frame which is encoded once and shared
+// by every client (QByteArray is implicitly shared). A frame holds at most a quarter of
+// maxQueuedBytes(); bigger bursts go out as several frames. A client whose socket buffer would
+// grow past maxQueuedBytes() is considered too slow and is disconnected.
+class StreamServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr quint8 ProtocolVersion = 1;
+    static constexpr int RecordSize = 44;
+
+    explicit StreamServer(QObject *parent = nullptr);
+    ~StreamServer();
+
+    // Either argument may be disabled (port 0 / empty name).
+    bool listen(quint16 tcpPort, const QString &localName);
+    void close();
+
+    void publish(const Sample &sample);
+
+    void setFlushInterval(int msec);
+    int flushInterval() const { return m_flushTimer.interval(); }
+    void setMaxQueuedBytes(qint64 bytes) { m_maxQueuedBytes = bytes; }
+    qint64 maxQueuedBytes() const { return m_maxQueuedBytes; }
+    int maxSamplesPerFrame() const; // Derived from maxQueuedBytes()
+
+    int clientCount() const { return m_clients.size(); }
+    quint64 evictedClients() const { return m_evictedClients; }
+    qint64 memoryUsage() const; // Pending records and unsent socket data, see MemoryAccounting
+
+    static void encodeSample(const Sample &sample, char *out);
+
+signals:
+    void clientEvicted(const QString &peer);
+
+private slots:
+    void onNewTcpConnection();
+    void onNewLocalConnection();
+    void flush();
+
+private:
+    struct Client {
+        QIODevice *socket;
+        QString peer;
+    };
+
+    void addClient(QIODevice *socket, const QString &peer);
+    void removeClient(QIODevice *socket);
+    void evict(const Client &client);
+
+    QTcpServer *m_tcpServer;
+    QLocalServer *m_localServer;
+    QList<Client> m_clients;
+    QTimer m_flushTimer;
+    QByteArray m_pending;     // Encoded records waiting for the next flush
+    int m_pendingCount;
+    qint64 m_maxQueuedBytes;
+    quint64 m_evictedClients;
+};
+
+#endif // STREAMSERVER_H
@@ -0,0 +1,59 @@
+#include "syntheticstream.h"
+#include "mainwindow.h"
+#include <QTimer>
+
+namespace {
+const qint64 kNotificationIntervalMs = 200;
+const size_t kBatchSize = 10;                 // Notifications per decode pass
+const int kNotificationsPerStep = 300;        // One simulated minute
+}
+
+SyntheticStream::SyntheticStream(MainWindow *window, quint32 seed, QObject *parent)
+    : QObject(parent)
+    , m_window(window)
+    , m_random(seed)
+    , m_weight(14000) // 70 kg in 5 g steps
+    , m_running(false)
+{
+}
+
+void SyntheticStream::run(int notifications)
+{
+    MainWindow &window = *m_window;
+    const QBluetoothUuid characteristic(QBluetoothUuid::CharacteristicType::WeightMeasurement);
+    for (int i = 0; i < notifications; ++i) {
+        // Weight Measurement: SI flags only, then the weight in 5 g steps (little endian)
+        m_weight = quint16(qBound(0, int(m_weight) + int(m_random.bounded(21u)) - 10, 40000));
+        QByteArray payload(3, '\0');
+        payload[1] = char(m_weight & 0xff);
+        payload[2] = char(m_weight >> 8);
+        window.m_pendingNotifications.push_back({characteristic, payload, window.m_timers->nowMs() * 1000});
+        if (window.m_pendingNotifications.size() >= kBatchSize)
+            window.decodeNotifications();
+        window.m_timers->advanceBy(kNotificationIntervalMs);
+    }
+    window.decodeNotifications();
+}
+
+void SyntheticStream::start()
+{
+    if (m_running)
+        return;
+    m_running = true;
+    QTimer::singleShot(0, this, &SyntheticStream::step);
+}
+
+void SyntheticStream::stop()
+{
+    m_running = false;
+}
+
+// Back to the event loop between steps, so queued deliveries and deferred deletes keep up
+void SyntheticStream::step()
+{
+    if (!m_running)
+        return;
+    run(kNotificationsPerStep);
+    if (m_running)
+        QTimer::singleShot(0, this, &SyntheticStream::step);
+}
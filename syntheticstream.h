@@ -0,0 +1,33 @@
+#ifndef SYNTHETICSTREAM_H
+#define SYNTHETICSTREAM_H
+
+#include <QObject>
+#include <QRandomGenerator>
+
+class MainWindow;
+
+// A weight scale for the test modes that run on the TimerService's manual clock (--memory-check,
+// --soak). Weight Measurement notifications, a random walk around 70 kg at 5 Hz, go through
+// MainWindow's batch decoder, the sample bus and every sink as if characteristicChanged() had
+// queued them; the clock advances with each one, so timers fire on simulated time.
+class SyntheticStream : public QObject
+{
+    Q_OBJECT
+
+public:
+    SyntheticStream(MainWindow *window, quint32 seed, QObject *parent = nullptr);
+
+    void run(int notifications); // Synchronously
+    void start(); // Until stop(): a simulated minute per pass of the event loop
+    void stop();
+
+private:
+    void step();
+
+    MainWindow *m_window;
+    QRandomGenerator m_random; // Fixed seed: a failing run can be replayed
+    quint16 m_weight;
+    bool m_running;
+};
+
+#endif // SYNTHETICSTREAM_H
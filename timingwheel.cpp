@@ -0,0 +1,247 @@
+#include "timingwheel.h"
+
+TimingWheel::TimingWheel(qint64 tickMs)
+    : m_tickMs(qMax<qint64>(1, tickMs))
+    , m_currentTick(0)
+    , m_heads(ExpiredList + 1, -1)
+    , m_freeHead(-1)
+    , m_active(0)
+{
+}
+
+int TimingWheel::nodeIndex(TimerId id) const
+{
+    const qint64 index = qint64(id & 0xFFFFFFFFu) - 1;
+    if (index < 0 || index >= qint64(m_nodes.size()))
+        return -1;
+    const Node &node = m_nodes[size_t(index)];
+    if (node.generation != quint32(id >> 32) || node.list == NoList)
+        return -1;
+    return int(index);
+}
+
+quint64 TimingWheel::expiryTick(qint64 delayMs) const
+{
+    // Round up so a timer never fires early; always at least the next tick
+    const qint64 ticks = delayMs <= 0 ? 1 : (delayMs + m_tickMs - 1) / m_tickMs;
+    return m_currentTick + quint64(qMax<qint64>(1, ticks));
+}
+
+int TimingWheel::allocateNode()
+{
+    if (m_freeHead >= 0) {
+        const int index = m_freeHead;
+        m_freeHead = m_nodes[size_t(index)].next;
+        return index;
+    }
+    m_nodes.emplace_back();
+    return int(m_nodes.size() - 1);
+}
+
+void TimingWheel::freeNode(int index)
+{
+    Node &node = m_nodes[size_t(index)];
+    node.callback = nullptr;
+    node.list = NoList;
+    node.prev = -1;
+    ++node.generation; // Invalidates outstanding ids
+    node.next = m_freeHead;
+    m_freeHead = index;
+    --m_active;
+}
+
+void TimingWheel::linkInto(int index, int list)
+{
+    Node &node = m_nodes[size_t(index)];
+    node.list = list;
+    node.prev = -1;
+    node.next = m_heads[size_t(list)];
+    if (node.next >= 0)
+        m_nodes[size_t(node.next)].prev = index;
+    m_heads[size_t(list)] = index;
+}
+
+void TimingWheel::link(int index)
+{
+    const quint64 expires = m_nodes[size_t(index)].expires;
+    quint64 delta = expires - m_currentTick;
+    quint64 slotTick = expires;
+
+    constexpr quint64 MaxDelta = (quint64(1) << (Bits * Levels)) - 1;
+    if (delta > MaxDelta) {
+        // Beyond the wheel's range: park in the furthest slot, re-cascaded later with its real expiry
+        delta = MaxDelta;
+        slotTick = m_currentTick + MaxDelta;
+    }
+
+    int level = 0;
+    while (level < Levels - 1 && delta >= (quint64(1) << (Bits * (level + 1))))
+        ++level;
+    const int slot = int((slotTick >> (Bits * level)) & Mask);
+    linkInto(index, level * SlotsPerLevel + slot);
+}
+
+void TimingWheel::unlink(int index)
+{
+    Node &node = m_nodes[size_t(index)];
+    if (node.prev >= 0)
+        m_nodes[size_t(node.prev)].next = node.next;
+    else
+        m_heads[size_t(node.list)] = node.next;
+    if (node.next >= 0)
+        m_nodes[size_t(node.next)].prev = node.prev;
+    node.prev = node.next = -1;
+}
+
+TimingWheel::TimerId TimingWheel::schedule(qint64 delayMs, Callback callback)
+{
+    const int index = allocateNode();
+    Node &node = m_nodes[size_t(index)];
+    node.expires = expiryTick(delayMs);
+    node.callback = std::move(callback);
+    ++m_active;
+    link(index);
+    return makeId(index);
+}
+
+bool TimingWheel::cancel(TimerId id)
+{
+    const int index = nodeIndex(id);
+    if (index < 0)
+        return false;
+    unlink(index);
+    freeNode(index);
+    return true;
+}
+
+bool TimingWheel::reschedule(TimerId id, qint64 delayMs)
+{
+    const int index = nodeIndex(id);
+    if (index < 0)
+        return false;
+    unlink(index);
+    m_nodes[size_t(index)].expires = expiryTick(delayMs);
+    link(index);
+    return true;
+}
+
+void TimingWheel::cascade(int level, int slot)
+{
+    qint32 index = m_heads[size_t(level * SlotsPerLevel + slot)];
+    m_heads[size_t(level * SlotsPerLevel + slot)] = -1;
+    while (index >= 0) {
+        const qint32 next = m_nodes[size_t(index)].next;
+        link(index); // Lands in a lower level now that it is closer
+        index = next;
+    }
+}
+
+void TimingWheel::processTick()
+{
+    ++m_currentTick;
+
+    const int slot = int(m_currentTick & Mask);
+    if (slot == 0) {
+        for (int level = 1; level < Levels; ++level) {
+            const int higherSlot = int((m_currentTick >> (Bits * level)) & Mask);
+            cascade(level, higherSlot);
+            if (higherSlot != 0)
+                break;
+        }
+    }
+
+    // Move the due slot to the expired list so callbacks may freely schedule or cancel timers,
+    // including ones from this same slot.
+    qint32 index = m_heads[size_t(slot)];
+    m_heads[size_t(slot)] = -1;
+    while (index >= 0) {
+        const qint32 next = m_nodes[size_t(index)].next;
+        linkInto(index, ExpiredList);
+        index = next;
+    }
+
+    while (m_heads[ExpiredList] >= 0) {
+        const int due = m_heads[ExpiredList];
+        unlink(due);
+        Callback callback = std::move(m_nodes[size_t(due)].callback);
+        freeNode(due);
+        if (callback)
+            callback();
+    }
+}
+
+void TimingWheel::advanceTo(qint64 nowMs)
+{
+    const quint64 target = quint64(qMax<qint64>(0, nowMs) / m_tickMs);
+    while (m_currentTick < target) {
+        if (m_active == 0) {
+            m_currentTick = target; // Nothing to fire; skip idle ticks
+            break;
+        }
+        processTick();
+    }
+}
+
+// --- TimerService ---
+TimerService::TimerService(qint64 tickMs, QObject *parent)
+    : QObject(parent)
+    , m_wheel(tickMs)
+    , m_virtualNowMs(0)
+    , m_manualClock(false)
+{
+    m_clock.start();
+    m_tickTimer.setInterval(int(tickMs));
+    m_tickTimer.setTimerType(Qt::PreciseTimer);
+    connect(&m_tickTimer, &QTimer::timeout, this, &TimerService::tick);
+}
+
+TimingWheel::TimerId TimerService::schedule(qint64 delayMs, TimingWheel::Callback callback)
+{
+    tickIfIdle();
+    const TimingWheel::TimerId id = m_wheel.schedule(delayMs, std::move(callback));
+    ensureRunning();
+    return id;
+}
+
+bool TimerService::reschedule(TimingWheel::TimerId id, qint64 delayMs)
+{
+    return m_wheel.reschedule(id, delayMs);
+}
+
+void TimerService::setManualClock(bool manual)
+{
+    if (manual && !m_manualClock)
+        m_virtualNowMs = m_clock.elapsed(); // Continue from now, so pending deadlines keep their meaning
+    m_manualClock = manual;
+    if (manual)
+        m_tickTimer.stop();
+    else
+        ensureRunning();
+}
+
+void TimerService::advanceBy(qint64 msec)
+{
+    m_virtualNowMs += msec;
+    m_wheel.advanceTo(m_virtualNowMs);
+}
+
+void TimerService::tickIfIdle()
+{
+    // The wheel's notion of "now" only moves while ticking; catch up before scheduling so a
+    // delay is measured from the real current time after an idle period.
+    if (!m_manualClock && !m_tickTimer.isActive())
+        m_wheel.advanceTo(m_clock.elapsed());
+}
+
+void TimerService::tick()
+{
+    m_wheel.advanceTo(m_clock.elapsed());
+    if (m_wheel.activeCount() == 0)
+        m_tickTimer.stop();
+}
+
+void TimerService::ensureRunning()
+{
+    if (!m_manualClock && !m_tickTimer.isActive() && m_wheel.activeCount() > 0)
+        m_tickTimer.start();
+}
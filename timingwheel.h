@@ -0,0 +1,104 @@
+#ifndef TIMINGWHEEL_H
+#define TIMINGWHEEL_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <functional>
+#include <vector>
+
+// Hierarchical timing wheel: 4 levels of 64 slots over a fixed tick (10 ms by default covers
+// about 46 hours; longer delays are re-cascaded). Timers live in a slab of intrusive doubly linked
+// list nodes, so schedule, cancel and reschedule are O(1) and allocation free once the slab has
+// grown to the working set. advanceTo() fires due callbacks in deadline order per tick.
+//
+// The wheel itself has no notion of wall time; TimerService drives it from a QTimer, and tests or
+// simulations can drive it from a virtual clock instead.
+class TimingWheel
+{
+public:
+    using TimerId = quint64; // 0 is never a valid id
+    using Callback = std::function<void()>;
+
+    explicit TimingWheel(qint64 tickMs = 10);
+
+    TimerId schedule(qint64 delayMs, Callback callback);
+    bool cancel(TimerId id);
+    bool reschedule(TimerId id, qint64 delayMs); // Keeps the callback
+    bool isActive(TimerId id) const { return nodeIndex(id) >= 0; }
+
+    void advanceTo(qint64 nowMs);
+    qint64 nowMs() const { return qint64(m_currentTick) * m_tickMs; }
+    qint64 tickMs() const { return m_tickMs; }
+    int activeCount() const { return m_active; }
+
+private:
+    static constexpr int Bits = 6;
+    static constexpr int SlotsPerLevel = 1 << Bits;
+    static constexpr int Levels = 4;
+    static constexpr quint64 Mask = SlotsPerLevel - 1;
+    static constexpr int ExpiredList = Levels * SlotsPerLevel; // Slot being run by advanceTo()
+    static constexpr int NoList = -1;
+
+    struct Node {
+        qint32 prev = -1;
+        qint32 next = -1;
+        qint32 list = NoList;
+        quint32 generation = 0;
+        quint64 expires = 0;   // Absolute tick
+        Callback callback;
+    };
+
+    int nodeIndex(TimerId id) const;
+    TimerId makeId(int index) const { return (quint64(m_nodes[index].generation) << 32) | quint64(index + 1); }
+    quint64 expiryTick(qint64 delayMs) const;
+    int allocateNode();
+    void freeNode(int index);
+    void link(int index);
+    void linkInto(int index, int list);
+    void unlink(int index);
+    void cascade(int level, int slot);
+    void processTick();
+
+    qint64 m_tickMs;
+    quint64 m_currentTick;  // Last processed tick
+    std::vector<Node> m_nodes;
+    std::vector<qint32> m_heads; // Levels * SlotsPerLevel slot lists + the expired list
+    qint32 m_freeHead;
+    int m_active;
+};
+
+// Drives a TimingWheel from a single periodic QTimer, which only runs while timers are pending.
+class TimerService : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit TimerService(qint64 tickMs = 10, QObject *parent = nullptr);
+
+    TimingWheel::TimerId schedule(qint64 delayMs, TimingWheel::Callback callback);
+    bool cancel(TimingWheel::TimerId id) { return m_wheel.cancel(id); }
+    bool reschedule(TimingWheel::TimerId id, qint64 delayMs);
+    bool isActive(TimingWheel::TimerId id) const { return m_wheel.isActive(id); }
+    int activeCount() const { return m_wheel.activeCount(); }
+    qint64 nowMs() const { return m_manualClock ? m_virtualNowMs : m_clock.elapsed(); }
+
+    // Virtual clock: stop the QTimer and advance time explicitly with advanceBy()
+    void setManualClock(bool manual);
+    void advanceBy(qint64 msec);
+
+private slots:
+    void tick();
+
+private:
+    void tickIfIdle();
+    void ensureRunning();
+
+    TimingWheel m_wheel;
+    QTimer m_tickTimer;
+    QElapsedTimer m_clock;
+    qint64 m_virtualNowMs;
+    bool m_manualClock;
+};
+
+#endif // TIMINGWHEEL_H
@@ -0,0 +1,75 @@
+#include "tracer.h"
+#include <QCoreApplication>
+
+Tracer &Tracer::instance()
+{
+    static Tracer tracer;
+    return tracer;
+}
+
+Tracer::Tracer()
+    : m_originNs(nowNs())
+{
+    if (qEnvironmentVariableIntValue("BLESCALE_TRACE") > 0)
+        setEnabled(true);
+}
+
+void Tracer::setEnabled(bool enabled)
+{
+    if (enabled && !m_events)
+        m_events.reset(new Event[Capacity]);
+    m_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void Tracer::clear()
+{
+    m_next.store(0, std::memory_order_relaxed);
+}
+
+void Tracer::record(char phase, const char *name, quint64 arg, qint64 timestampNs, qint64 durationNs)
+{
+    const quint64 index = m_next.fetch_add(1, std::memory_order_relaxed);
+    Event &event = m_events[index & (Capacity - 1)];
+    event.timestampNs = timestampNs;
+    event.durationNs = durationNs;
+    event.name = name;
+    event.arg = arg;
+    event.phase = phase;
+}
+
+QByteArray Tracer::toChromeJson() const
+{
+    const quint64 end = m_next.load(std::memory_order_relaxed);
+    const quint64 begin = end > quint64(Capacity) ? end - Capacity : 0;
+    const QByteArray pid = QByteArray::number(QCoreApplication::applicationPid());
+
+    QByteArray out;
+    out.reserve(int(end - begin) * 112 + 64);
+    out += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    for (quint64 i = begin; m_events && i < end; ++i) {
+        const Event &event = m_events[i & (Capacity - 1)];
+        if (i != begin)
+            out += ",\n";
+        out += "{\"name\":\"";
+        out += event.name;
+        out += "\",\"cat\":\"ble\",\"ph\":\"";
+        out += event.phase;
+        out += "\",\"pid\":" + pid + ",\"tid\":1,\"ts\":";
+        out += QByteArray::number((event.timestampNs - m_originNs) / 1000.0, 'f', 3);
+        switch (event.phase) {
+        case 'X':
+            out += ",\"dur\":" + QByteArray::number(event.durationNs / 1000.0, 'f', 3);
+            break;
+        case 'b':
+        case 'e':
+            out += ",\"id\":\"0x" + QByteArray::number(event.arg, 16) + '"';
+            break;
+        case 'i':
+            out += ",\"s\":\"t\",\"args\":{\"arg\":\"0x" + QByteArray::number(event.arg, 16) + "\"}";
+            break;
+        }
+        out += '}';
+    }
+    out += "]}\n";
+    return out;
+}
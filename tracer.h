@@ -0,0 +1,89 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <QByteArray>
+#include <atomic>
+#include <chrono>
+#include <memory>
+
+// In-memory ring of BLE lifecycle trace events, exported on demand in the Chrome trace event
+// JSON format (chrome://tracing, ui.perfetto.dev).
+//
+// Disabled, every call is one relaxed load and a branch. Enabled, an event is a timestamp read and
+// a 40 byte store into a preallocated ring (--benchmark reports both costs as trace_event_ns);
+// names must be string literals since only the pointer is recorded. The newest Capacity events
+// are kept. Tracing is switched on with the BLESCALE_TRACE environment variable or at runtime
+// through the HTTP /debug/trace endpoint.
+class Tracer
+{
+public:
+    static constexpr int Capacity = 1 << 16;
+
+    static Tracer &instance();
+
+    bool isEnabled() const { return m_enabled.load(std::memory_order_relaxed); }
+    void setEnabled(bool enabled);
+    void clear();
+
+    // Point in time, e.g. a discovered device or the first notification
+    void instant(const char *name, quint64 arg = 0) { if (isEnabled()) record('i', name, arg, nowNs(), 0); }
+    // Spans that start and finish in different callbacks. asyncBegin() returns a fresh id (0 while
+    // disabled) that asyncEnd() must be given, so overlapping spans of one name stay apart.
+    quint64 asyncBegin(const char *name)
+    {
+        if (!isEnabled())
+            return 0;
+        const quint64 id = m_nextAsyncId.fetch_add(1, std::memory_order_relaxed);
+        record('b', name, id, nowNs(), 0);
+        return id;
+    }
+    void asyncEnd(const char *name, quint64 id) { if (id && isEnabled()) record('e', name, id, nowNs(), 0); }
+    // Synchronous span, see TraceScope
+    void complete(const char *name, qint64 startNs, qint64 endNs) { if (isEnabled()) record('X', name, 0, startNs, endNs - startNs); }
+
+    QByteArray toChromeJson() const;
+    qint64 memoryUsage() const { return m_events ? qint64(Capacity) * qint64(sizeof(Event)) : 0; } // The ring, once enabled
+
+    static qint64 nowNs()
+    {
+        using namespace std::chrono;
+        return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+    }
+
+private:
+    struct Event {
+        qint64 timestampNs;
+        qint64 durationNs;
+        const char *name;
+        quint64 arg;
+        char phase;
+    };
+
+    Tracer();
+    void record(char phase, const char *name, quint64 arg, qint64 timestampNs, qint64 durationNs);
+
+    std::atomic<bool> m_enabled{false};
+    std::atomic<quint64> m_next{0};
+    std::atomic<quint64> m_nextAsyncId{1}; // 0 is "not traced"
+    std::unique_ptr<Event[]> m_events; // Allocated on first enable
+    qint64 m_originNs;
+};
+
+// Records a complete ("X") event for the enclosing scope
+class TraceScope
+{
+public:
+    explicit TraceScope(const char *name)
+        : m_name(name), m_startNs(Tracer::instance().isEnabled() ? Tracer::nowNs() : 0) {}
+    ~TraceScope()
+    {
+        if (m_startNs)
+            Tracer::instance().complete(m_name, m_startNs, Tracer::nowNs());
+    }
+
+private:
+    const char *m_name;
+    qint64 m_startNs;
+};
+
+#endif // TRACER_H